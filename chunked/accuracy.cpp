@@ -0,0 +1,228 @@
+#include "fft.h"
+
+// Backends that the suite runs, neither needs a device
+enum AccuracyBackend {
+    HOST_BACKEND = 0,
+    EMULATED_BACKEND = 1,
+};
+
+enum AccuracySignal {
+    RANDOM_SIGNAL = 0,
+    IMPULSE_SIGNAL = 1,
+    SINUSOID_SIGNAL = 2,
+    WHITE_NOISE_SIGNAL = 3,
+};
+
+/*
+ * The tolerance is the allowed relative error per stage, so the thresholds for a domain of n points are this
+ * multiplied by log2(n). The maximum error is allowed four times this, as it is a single worst bin
+ */
+struct AccuracyMode {
+    const char * name;
+    enum AccuracyBackend backend;
+    bool compact_twiddles, generate_twiddles, local_substages;
+    double tolerance;
+};
+
+struct AccuracyErrors {
+    double relative_l2, relative_max, parseval, round_trip;
+};
+
+static void fillSignal(float*, float*, uint32_t, enum AccuracySignal);
+static void runBackend(AccuracyMode*, float*, float*, float*, float*, uint32_t, enum FFTDirection);
+static AccuracyErrors measureErrors(AccuracyMode*, float*, float*, uint32_t);
+
+static const char * signal_names[]={"random", "impulse", "sinusoid", "white noise"};
+
+/*
+ * Checks each mode over power of two domains from 2 up to max_domain_size, with random, impulse, sinusoid and
+ * white noise inputs. The forward transform is compared against a double precision reference for the relative
+ * L2 and maximum errors, its energy against the input's (Parseval), and the input against the forward then
+ * backward round trip. Returns the number of checks that exceed their mode's thresholds
+ */
+int runAccuracySuite(uint32_t max_domain_size) {
+    // The full table is computed from single precision angles, so loses accuracy that the compact and seed tables do not
+    AccuracyMode modes[]={
+        {"host", HOST_BACKEND, false, false, false, 5e-8},
+        {"emulated", EMULATED_BACKEND, false, false, false, 1e-7},
+        {"emulated compact twiddles", EMULATED_BACKEND, true, false, false, 6e-8},
+        {"emulated generated twiddles", EMULATED_BACKEND, false, true, false, 6e-8},
+        {"emulated local substages", EMULATED_BACKEND, false, false, true, 1e-7},
+    };
+    uint32_t num_modes=sizeof(modes) / sizeof(modes[0]);
+
+    // Fixed so that any failure is reproducible
+    srand(1);
+    int failures=0;
+    for (uint32_t m=0;m<num_modes;m++) {
+        for (uint32_t domain_size=2;domain_size<=max_domain_size;domain_size<<=1) {
+            // As on the device, the compact and seed tables need the domain to divide into eighths
+            if ((modes[m].compact_twiddles || modes[m].generate_twiddles) && domain_size < 8) continue;
+            float * signal_r=(float*) malloc(sizeof(float) * domain_size);
+            float * signal_i=(float*) malloc(sizeof(float) * domain_size);
+            double threshold=modes[m].tolerance * log2((double) domain_size);
+
+            AccuracyErrors worst={0.0, 0.0, 0.0, 0.0};
+            for (int s=RANDOM_SIGNAL;s<=WHITE_NOISE_SIGNAL;s++) {
+                fillSignal(signal_r, signal_i, domain_size, (enum AccuracySignal) s);
+                AccuracyErrors errors=measureErrors(&modes[m], signal_r, signal_i, domain_size);
+                bool failed=errors.relative_l2 > threshold || errors.relative_max > threshold * 4 ||
+                                errors.parseval > threshold || errors.round_trip > threshold;
+                if (failed) {
+                    printf("FAILED %s with %s input of size %d: L2 %.3e, max %.3e, Parseval %.3e, round trip %.3e exceeds %.3e\n",
+                            modes[m].name, signal_names[s], domain_size, errors.relative_l2, errors.relative_max, errors.parseval,
+                            errors.round_trip, threshold);
+                    failures++;
+                }
+                worst.relative_l2=fmax(worst.relative_l2, errors.relative_l2);
+                worst.relative_max=fmax(worst.relative_max, errors.relative_max);
+                worst.parseval=fmax(worst.parseval, errors.parseval);
+                worst.round_trip=fmax(worst.round_trip, errors.round_trip);
+            }
+            printf("%s size %d: worst L2 %.3e, max %.3e, Parseval %.3e, round trip %.3e (threshold %.3e)\n", modes[m].name, domain_size,
+                    worst.relative_l2, worst.relative_max, worst.parseval, worst.round_trip, threshold);
+            free(signal_r);
+            free(signal_i);
+        }
+    }
+    printf("Accuracy suite complete with %d failures\n", failures);
+    return failures;
+}
+
+static AccuracyErrors measureErrors(AccuracyMode * mode, float * signal_r, float * signal_i, uint32_t domain_size) {
+    float * result_r=(float*) malloc(sizeof(float) * domain_size);
+    float * result_i=(float*) malloc(sizeof(float) * domain_size);
+    double * reference_r=(double*) malloc(sizeof(double) * domain_size);
+    double * reference_i=(double*) malloc(sizeof(double) * domain_size);
+    for (uint32_t i=0;i<domain_size;i++) {
+        reference_r[i]=signal_r[i];
+        reference_i[i]=signal_i[i];
+    }
+    referenceFFTDouble(reference_r, reference_i, domain_size);
+    runBackend(mode, signal_r, signal_i, result_r, result_i, domain_size, FFT_FORWARD);
+
+    double error_energy=0.0, reference_energy=0.0, result_energy=0.0, signal_energy=0.0;
+    double max_error=0.0, max_reference=0.0;
+    for (uint32_t i=0;i<domain_size;i++) {
+        double error_r=result_r[i] - reference_r[i], error_i=result_i[i] - reference_i[i];
+        double error=(error_r * error_r) + (error_i * error_i);
+        double reference=(reference_r[i] * reference_r[i]) + (reference_i[i] * reference_i[i]);
+        error_energy+=error;
+        reference_energy+=reference;
+        result_energy+=((double) result_r[i] * result_r[i]) + ((double) result_i[i] * result_i[i]);
+        signal_energy+=((double) signal_r[i] * signal_r[i]) + ((double) signal_i[i] * signal_i[i]);
+        max_error=fmax(max_error, sqrt(error));
+        max_reference=fmax(max_reference, sqrt(reference));
+    }
+
+    AccuracyErrors errors;
+    errors.relative_l2=sqrt(error_energy / reference_energy);
+    errors.relative_max=max_error / max_reference;
+    errors.parseval=fabs((result_energy / domain_size) - signal_energy) / signal_energy;
+
+    // The backwards transform is of the result, so this is the accumulated error of both directions
+    runBackend(mode, result_r, result_i, result_r, result_i, domain_size, FFT_BACKWARD);
+    descale(result_r, result_i, domain_size);
+    double round_trip_energy=0.0;
+    for (uint32_t i=0;i<domain_size;i++) {
+        double error_r=result_r[i] - signal_r[i], error_i=result_i[i] - signal_i[i];
+        round_trip_energy+=(error_r * error_r) + (error_i * error_i);
+    }
+    errors.round_trip=sqrt(round_trip_energy / signal_energy);
+
+    free(result_r);
+    free(result_i);
+    free(reference_r);
+    free(reference_i);
+    return errors;
+}
+
+// The result follows the convention of fft, and can be the same arrays as the input
+static void runBackend(AccuracyMode * mode, float * input_r, float * input_i, float * result_r, float * result_i, uint32_t domain_size,
+                        enum FFTDirection direction) {
+    float * conjugated_i=(float*) malloc(sizeof(float) * domain_size);
+    float * transformed_r=(float*) malloc(sizeof(float) * domain_size);
+    float * transformed_i=(float*) malloc(sizeof(float) * domain_size);
+    if (mode->backend == HOST_BACKEND) {
+        // The backwards transform is the forward transform of the conjugated input, as the device kernels do it
+        for (uint32_t i=0;i<domain_size;i++) conjugated_i[i]=direction == FFT_BACKWARD ? -input_i[i] : input_i[i];
+        referenceDFT(input_r, conjugated_i, transformed_r, transformed_i, domain_size);
+    } else {
+        uint32_t twiddle_seed_stride=mode->generate_twiddles ? getTwiddleSeedStride(domain_size) : 0;
+        float * twiddle_data;
+        if (mode->generate_twiddles) {
+            twiddle_data=computeTwiddleSeeds(domain_size, twiddle_seed_stride);
+        } else if (mode->compact_twiddles) {
+            twiddle_data=computeCompactTwiddleFactors(domain_size);
+        } else {
+            twiddle_data=computeTwiddleFactors(domain_size);
+        }
+        emulateFFT(input_r, input_i, twiddle_data, transformed_r, transformed_i, domain_size, direction, twiddle_seed_stride, mode->compact_twiddles,
+                    mode->local_substages);
+        free(twiddle_data);
+    }
+    memcpy(result_r, transformed_r, sizeof(float) * domain_size);
+    memcpy(result_i, transformed_i, sizeof(float) * domain_size);
+    free(conjugated_i);
+    free(transformed_r);
+    free(transformed_i);
+}
+
+static void fillSignal(float * signal_r, float * signal_i, uint32_t domain_size, enum AccuracySignal signal) {
+    for (uint32_t i=0;i<domain_size;i++) {
+        if (signal == RANDOM_SIGNAL) {
+            signal_r[i]=(float) rand()/(float) RAND_MAX;
+            signal_i[i]=(float) rand()/(float) RAND_MAX;
+        } else if (signal == IMPULSE_SIGNAL) {
+            signal_r[i]=i == 1 ? 1.0f : 0.0f;
+            signal_i[i]=0.0f;
+        } else if (signal == SINUSOID_SIGNAL) {
+            // One tone on a bin and one between bins, which leaks into every bin
+            double on_bin=(2.0 * PI * (domain_size/4) * i) / (double) domain_size;
+            double off_bin=(2.0 * PI * 1.5 * i) / (double) domain_size;
+            signal_r[i]=(float) (cos(on_bin) + (0.5 * cos(off_bin)));
+            signal_i[i]=(float) (0.5 * sin(off_bin));
+        } else {
+            // Gaussian with zero mean and unit variance, by the Box-Muller transform
+            double u1=((double) rand() + 1.0) / ((double) RAND_MAX + 1.0);
+            double u2=(double) rand() / (double) RAND_MAX;
+            signal_r[i]=(float) (sqrt(-2.0 * log(u1)) * cos(2.0 * PI * u2));
+            signal_i[i]=(float) (sqrt(-2.0 * log(u1)) * sin(2.0 * PI * u2));
+        }
+    }
+}
+
+// Forward radix 2 FFT in double precision and in place, with exactly rounded twiddles
+void referenceFFTDouble(double * data_r, double * data_i, uint32_t domain_size) {
+    uint32_t j=0;
+    for (uint32_t i=0;i<domain_size-1;i++) {
+        if (i < j) {
+            double temp_r=data_r[i], temp_i=data_i[i];
+            data_r[i]=data_r[j];
+            data_i[i]=data_i[j];
+            data_r[j]=temp_r;
+            data_i[j]=temp_i;
+        }
+        uint32_t k=domain_size >> 1;
+        while (k <= j) {
+            j -= k;
+            k >>= 1;
+        }
+        j+=k;
+    }
+
+    for (uint32_t span=1;span<domain_size;span<<=1) {
+        for (uint32_t k=0;k<span;k++) {
+            double base_factor=(PI * k) / (double) span;
+            double w_r=cos(base_factor), w_i=-sin(base_factor);
+            for (uint32_t point=k;point<domain_size;point+=span*2) {
+                double f_r=(data_r[point+span] * w_r) - (data_i[point+span] * w_i);
+                double f_i=(data_r[point+span] * w_i) + (data_i[point+span] * w_r);
+                data_r[point+span]=data_r[point] - f_r;
+                data_i[point+span]=data_i[point] - f_i;
+                data_r[point]+=f_r;
+                data_i[point]+=f_i;
+            }
+        }
+    }
+}
@@ -0,0 +1,120 @@
+#include "fft.h"
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+// Timed launches of each backend at each domain size, after an untimed launch that compiles the kernels
+#define BACKEND_BENCHMARK_RUNS 10
+
+static double timePlannedFFT(CommandQueue&, TTExecution*, FFTPlan*, uint32_t);
+static void printBackendResult(CommandQueue&, TTExecution*, const char*, double, float*, float*, double*, double*, uint32_t);
+static double relativeL2Error(float*, float*, double*, double*, uint32_t);
+
+// Indexed by FFTComputeBackend
+static const char * compute_backend_names[]={"fpu", "sfpu", "hybrid"};
+
+const char* getComputeBackendName(enum FFTComputeBackend compute_backend) {
+    return compute_backend_names[compute_backend];
+}
+
+// Returns the compute backend named, or -1 if there is no such backend
+int parseComputeBackend(const char * name) {
+    for (int i=0;i<(int) (sizeof(compute_backend_names) / sizeof(compute_backend_names[0]));i++) {
+        if (strcmp(name, compute_backend_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/*
+ * For power of two domains from 2 up to max_domain_size, times forward transforms of a random signal through each
+ * compute backend and measures the relative L2 error of the result against a double precision reference. The
+ * backends are plans of one execution per domain size, so the signal and twiddles are uploaded once for all of them.
+ * The FPU plan is then timed again with the reader computing the local stages (see --local-substages), as a runtime
+ * argument of the same program, so the row labelled local is directly comparable with the fpu row
+ */
+void runBackendBenchmark(IDevice* device, CommandQueue& cq, uint32_t max_domain_size) {
+    uint32_t num_backends=sizeof(compute_backend_names) / sizeof(compute_backend_names[0]);
+
+    // Fixed so that the errors are reproducible
+    srand(1);
+    printf("%10s %8s %14s %14s %12s\n", "Size", "Backend", "Sec/transform", "Points/sec", "Relative L2");
+    for (uint32_t domain_size=2;domain_size<=max_domain_size;domain_size<<=1) {
+        TTExecution * exec=createTTExecution(device, domain_size, 0, false, false, false, false, false, FPU_BACKEND);
+        float * twiddle_factors=computeTwiddleFactors(domain_size);
+        float * signal_r=allocateHostBuffer(domain_size);
+        float * signal_i=allocateHostBuffer(domain_size);
+        float * result_r=allocateHostBuffer(domain_size);
+        float * result_i=allocateHostBuffer(domain_size);
+        double * reference_r=(double*) malloc(sizeof(double) * domain_size);
+        double * reference_i=(double*) malloc(sizeof(double) * domain_size);
+        for (uint32_t i=0;i<domain_size;i++) {
+            signal_r[i]=(float) rand()/(float) RAND_MAX;
+            signal_i[i]=(float) rand()/(float) RAND_MAX;
+            reference_r[i]=signal_r[i];
+            reference_i[i]=signal_i[i];
+        }
+        referenceFFTDouble(reference_r, reference_i, domain_size);
+
+        uploadTwiddleFactors(cq, exec, twiddle_factors);
+        EnqueueWriteBuffer(cq, exec->in_data_r_dram_buffer, signal_r, false);
+        EnqueueWriteBuffer(cq, exec->in_data_i_dram_buffer, signal_i, false);
+        Finish(cq);
+
+        for (uint32_t b=0;b<num_backends;b++) {
+            FFTPlan * plan=getFFTPlan(exec, domain_size, FFT_FORWARD, CHUNKED_STRATEGY, (enum FFTComputeBackend) b);
+            double transform_time=timePlannedFFT(cq, exec, plan, domain_size);
+            printBackendResult(cq, exec, getComputeBackendName((enum FFTComputeBackend) b), transform_time, result_r, result_i, reference_r,
+                                reference_i, domain_size);
+        }
+        exec->local_substages=true;
+        double local_time=timePlannedFFT(cq, exec, getFFTPlan(exec, domain_size, FFT_FORWARD, CHUNKED_STRATEGY, FPU_BACKEND), domain_size);
+        printBackendResult(cq, exec, "local", local_time, result_r, result_i, reference_r, reference_i, domain_size);
+        exec->local_substages=false;
+
+        destroyTTExecution(exec);
+        releaseHostBuffer(signal_r);
+        releaseHostBuffer(signal_i);
+        releaseHostBuffer(result_r);
+        releaseHostBuffer(result_i);
+        free(reference_r);
+        free(reference_i);
+        free(twiddle_factors);
+    }
+    freeHostBuffers();
+}
+
+// Seconds per transform through the plan, after an untimed launch that compiles its kernels
+static double timePlannedFFT(CommandQueue& cq, TTExecution * exec, FFTPlan * plan, uint32_t domain_size) {
+    enqueuePlannedFFT(cq, exec, plan, exec->in_data_r_dram_buffer, exec->in_data_i_dram_buffer, exec->result_data_r_dram_buffer,
+                        exec->result_data_i_dram_buffer, domain_size, FFT_FORWARD, false, NULL);
+    Finish(cq);
+
+    struct timeval start_time;
+    gettimeofday(&start_time, NULL);
+    for (int run=0;run<BACKEND_BENCHMARK_RUNS;run++) {
+        enqueuePlannedFFT(cq, exec, plan, exec->in_data_r_dram_buffer, exec->in_data_i_dram_buffer, exec->result_data_r_dram_buffer,
+                            exec->result_data_i_dram_buffer, domain_size, FFT_FORWARD, false, NULL);
+    }
+    Finish(cq);
+    return getElapsedTime(start_time) / BACKEND_BENCHMARK_RUNS;
+}
+
+// Reads back the result of the last timed launch and prints its row of the table
+static void printBackendResult(CommandQueue& cq, TTExecution * exec, const char * name, double transform_time, float * result_r, float * result_i,
+                                double * reference_r, double * reference_i, uint32_t domain_size) {
+    EnqueueReadBuffer(cq, exec->result_data_r_dram_buffer, result_r, false);
+    EnqueueReadBuffer(cq, exec->result_data_i_dram_buffer, result_i, false);
+    Finish(cq);
+    printf("%10d %8s %14.6f %14.0f %12e\n", domain_size, name, transform_time, transform_time > 0.0 ? domain_size / transform_time : 0.0,
+            relativeL2Error(result_r, result_i, reference_r, reference_i, domain_size));
+}
+
+static double relativeL2Error(float * result_r, float * result_i, double * reference_r, double * reference_i, uint32_t domain_size) {
+    double error_energy=0.0, reference_energy=0.0;
+    for (uint32_t i=0;i<domain_size;i++) {
+        double error_r=result_r[i] - reference_r[i], error_i=result_i[i] - reference_i[i];
+        error_energy+=(error_r * error_r) + (error_i * error_i);
+        reference_energy+=(reference_r[i] * reference_r[i]) + (reference_i[i] * reference_i[i]);
+    }
+    return sqrt(error_energy / reference_energy);
+}
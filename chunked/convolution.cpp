@@ -0,0 +1,150 @@
+#include "fft.h"
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+/*
+ * Transforms the filter on the device into the filter DRAM buffers, where it stays resident for each
+ * subsequent convolve call. For correlation (matched filtering) the taps are conjugated and reversed,
+ * so the output peaks at the delay plus filter_length-1. The twiddles are also uploaded here, as
+ * convolve chains transforms on the device and does not upload them itself
+ */
+void createConvolutionFilter(CommandQueue& cq, TTExecution * device_descriptor, float * filter_r, float * filter_i, float * twiddle_factors,
+                                uint32_t filter_length, uint32_t domain_size, bool correlate) {
+    float * taps_r=(float*) calloc(domain_size, sizeof(float));
+    float * taps_i=(float*) calloc(domain_size, sizeof(float));
+    for (uint32_t i=0;i<filter_length;i++) {
+        if (correlate) {
+            taps_r[i]=filter_r[filter_length-1-i];
+            taps_i[i]=-filter_i[filter_length-1-i];
+        } else {
+            taps_r[i]=filter_r[i];
+            taps_i[i]=filter_i[i];
+        }
+    }
+
+    EnqueueWriteBuffer(cq, device_descriptor->in_data_r_dram_buffer, taps_r, false);
+    EnqueueWriteBuffer(cq, device_descriptor->in_data_i_dram_buffer, taps_i, false);
+    if (device_descriptor->twiddle_seed_stride == 0) {
+        EnqueueWriteBuffer(cq, device_descriptor->twiddle_dram_buffer, twiddle_factors, false);
+    }
+    enqueueFFT(cq, device_descriptor, device_descriptor->in_data_r_dram_buffer, device_descriptor->in_data_i_dram_buffer,
+                device_descriptor->filter_r_dram_buffer, device_descriptor->filter_i_dram_buffer, domain_size, FFT_FORWARD, false, NULL);
+    Finish(cq);
+
+    free(taps_r);
+    free(taps_i);
+}
+
+/*
+ * Overlap-save convolution of a signal of any length with the resident filter, giving the first
+ * signal_length points of the linear convolution. Each block of domain_size points overlaps the
+ * previous one by filter_length-1 points, which are discarded as they are polluted by the circular
+ * wrap around. Per block the forward FFT, filter multiply and inverse FFT all run on the device, only
+ * the block itself is transferred
+ */
+void convolve(CommandQueue& cq, TTExecution * device_descriptor, float * signal_r, float * signal_i, float * result_r, float * result_i,
+                uint32_t signal_length, uint32_t filter_length, uint32_t domain_size) {
+    uint32_t overlap=filter_length-1;
+    uint32_t block_step=domain_size-overlap;
+
+    float * block_r=(float*) malloc(sizeof(float) * domain_size);
+    float * block_i=(float*) malloc(sizeof(float) * domain_size);
+
+    for (uint32_t block_start=0; block_start < signal_length; block_start+=block_step) {
+        // The block starts overlap points before the first output, with zeros before the signal starts
+        for (uint32_t i=0;i<domain_size;i++) {
+            int64_t signal_index=(int64_t) block_start + i - overlap;
+            bool in_signal=signal_index >= 0 && signal_index < signal_length;
+            block_r[i]=in_signal ? signal_r[signal_index] : 0.0f;
+            block_i[i]=in_signal ? signal_i[signal_index] : 0.0f;
+        }
+
+        EnqueueWriteBuffer(cq, device_descriptor->in_data_r_dram_buffer, block_r, false);
+        EnqueueWriteBuffer(cq, device_descriptor->in_data_i_dram_buffer, block_i, false);
+        // Forward transform multiplied by the filter spectrum, then the inverse back into the input buffers
+        enqueueFFT(cq, device_descriptor, device_descriptor->in_data_r_dram_buffer, device_descriptor->in_data_i_dram_buffer,
+                    device_descriptor->result_data_r_dram_buffer, device_descriptor->result_data_i_dram_buffer, domain_size, FFT_FORWARD, true, NULL);
+        enqueueFFT(cq, device_descriptor, device_descriptor->result_data_r_dram_buffer, device_descriptor->result_data_i_dram_buffer,
+                    device_descriptor->in_data_r_dram_buffer, device_descriptor->in_data_i_dram_buffer, domain_size, FFT_BACKWARD, false, NULL);
+        EnqueueReadBuffer(cq, device_descriptor->in_data_r_dram_buffer, block_r, false);
+        EnqueueReadBuffer(cq, device_descriptor->in_data_i_dram_buffer, block_i, false);
+        Finish(cq);
+
+        descale(block_r, block_i, domain_size);
+        for (uint32_t i=overlap;i<domain_size && block_start+i-overlap < signal_length;i++) {
+            result_r[block_start+i-overlap]=block_r[i];
+            result_i[block_start+i-overlap]=block_i[i];
+        }
+    }
+
+    free(block_r);
+    free(block_i);
+}
+
+// Direct linear convolution on the host, giving the first signal_length points
+void referenceConvolution(float * signal_r, float * signal_i, float * filter_r, float * filter_i, float * result_r, float * result_i,
+                            uint32_t signal_length, uint32_t filter_length) {
+    for (uint32_t n=0;n<signal_length;n++) {
+        double sum_r=0.0, sum_i=0.0;
+        for (uint32_t k=0;k<filter_length && k<=n;k++) {
+            sum_r+=((double) filter_r[k] * signal_r[n-k]) - ((double) filter_i[k] * signal_i[n-k]);
+            sum_i+=((double) filter_r[k] * signal_i[n-k]) + ((double) filter_i[k] * signal_r[n-k]);
+        }
+        result_r[n]=(float) sum_r;
+        result_i[n]=(float) sum_i;
+    }
+}
+
+/*
+ * Convolves (or correlates) a random signal of four blocks with a random filter on the device and
+ * checks the result against the direct convolution on the host
+ */
+void runConvolution(CommandQueue& cq, TTExecution * device_descriptor, float * twiddle_factors, uint32_t domain_size, uint32_t filter_length, bool correlate) {
+    uint32_t signal_length=domain_size * 4;
+    float * signal_r=(float*) malloc(sizeof(float) * signal_length);
+    float * signal_i=(float*) malloc(sizeof(float) * signal_length);
+    float * filter_r=(float*) malloc(sizeof(float) * filter_length);
+    float * filter_i=(float*) malloc(sizeof(float) * filter_length);
+    for (uint32_t i=0;i<signal_length;i++) {
+        signal_r[i]=(float) rand()/(float) RAND_MAX;
+        signal_i[i]=(float) rand()/(float) RAND_MAX;
+    }
+    for (uint32_t i=0;i<filter_length;i++) {
+        filter_r[i]=(float) rand()/(float) RAND_MAX;
+        filter_i[i]=(float) rand()/(float) RAND_MAX;
+    }
+
+    createConvolutionFilter(cq, device_descriptor, filter_r, filter_i, twiddle_factors, filter_length, domain_size, correlate);
+
+    float * result_r=(float*) malloc(sizeof(float) * signal_length);
+    float * result_i=(float*) malloc(sizeof(float) * signal_length);
+    struct timeval start_time;
+    gettimeofday(&start_time, NULL);
+    convolve(cq, device_descriptor, signal_r, signal_i, result_r, result_i, signal_length, filter_length, domain_size);
+    printf("%s of %d points with a filter of %d points using blocks of %d: %.6f sec\n", correlate ? "Correlation" : "Convolution",
+            signal_length, filter_length, domain_size, getElapsedTime(start_time));
+
+    // The reference uses the same taps as the device, so for correlation these are conjugated and reversed
+    float * taps_r=(float*) malloc(sizeof(float) * filter_length);
+    float * taps_i=(float*) malloc(sizeof(float) * filter_length);
+    for (uint32_t i=0;i<filter_length;i++) {
+        taps_r[i]=correlate ? filter_r[filter_length-1-i] : filter_r[i];
+        taps_i[i]=correlate ? -filter_i[filter_length-1-i] : filter_i[i];
+    }
+    float * reference_r=(float*) malloc(sizeof(float) * signal_length);
+    float * reference_i=(float*) malloc(sizeof(float) * signal_length);
+    referenceConvolution(signal_r, signal_i, taps_r, taps_i, reference_r, reference_i, signal_length, filter_length);
+    checkAgainstReference(result_r, result_i, reference_r, reference_i, signal_length);
+
+    free(signal_r);
+    free(signal_i);
+    free(filter_r);
+    free(filter_i);
+    free(taps_r);
+    free(taps_i);
+    free(result_r);
+    free(result_i);
+    free(reference_r);
+    free(reference_i);
+}
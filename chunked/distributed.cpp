@@ -0,0 +1,311 @@
+#include "fft.h"
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+static void transformRows(DistributedBackend*, float**, float**, uint32_t, uint32_t);
+static void transformRowsOnDevices(DistributedBackend*, float**, float**, uint32_t, uint32_t);
+static void allToAllTranspose(uint32_t, float**, float**, float**, float**, uint32_t, uint32_t);
+static void referenceDFT2D(float*, float*, float*, float*, uint32_t, uint32_t);
+static float** allocateSlabs(uint32_t, uint32_t);
+static void freeSlabs(float**, uint32_t);
+
+/*
+ * Opens num_devices devices, each with an execution for rows of up to max_row_length points. If simulated then
+ * no devices are opened and each simulated device transforms its rows on the host, with the data still held
+ * in separate per device slabs and only moved between them by the all to all exchange
+ */
+DistributedBackend* createDistributedBackend(uint32_t num_devices, uint32_t max_row_length, bool simulated) {
+    DistributedBackend * backend=new DistributedBackend();
+    backend->num_devices=num_devices;
+    backend->max_row_length=max_row_length;
+    backend->simulated=simulated;
+    if (!simulated) {
+        for (uint32_t i=0;i<num_devices;i++) {
+            IDevice * device=CreateDevice(i);
+            backend->devices.push_back(device);
+            backend->device_descriptors.push_back(createTTExecution(device, max_row_length, 0, false, false, false, false, false, FPU_BACKEND));
+        }
+    }
+    return backend;
+}
+
+void destroyDistributedBackend(DistributedBackend * backend) {
+    for (uint32_t i=0;i<backend->devices.size();i++) {
+        destroyTTExecution(backend->device_descriptors[i]);
+        CloseDevice(backend->devices[i]);
+    }
+    delete backend;
+}
+
+// The smaller factor n1 of the domain for the four step decomposition n = n1 * n2, with n2 either n1 or 2*n1
+uint32_t getDistributedSplit(uint32_t domain_size) {
+    uint32_t n1=1;
+    while ((n1 * n1 * 4) <= domain_size) n1 <<= 1;
+    return n1;
+}
+
+/*
+ * 1D FFT of n1*n2 points by the four step method. Viewing the input as n2 rows of n1 points, where row r holds
+ * points r, r+n2, r+2*n2..., each device is given a slab of n2/P rows and transforms them. The row r, column k1
+ * result is multiplied by the twiddle W_n^(r*k1) and an all to all exchange transposes the slabs so each device
+ * holds n1/P rows of n2 points, which are transformed again. Row k1, column k2 is then result point k1 + n1*k2
+ */
+void distributedFFT(DistributedBackend * backend, float * input_r, float * input_i, float * result_r, float * result_i, uint32_t n1, uint32_t n2) {
+    uint32_t num_devices=backend->num_devices;
+    uint32_t domain_size=n1 * n2;
+    uint32_t rows_per_device=n2 / num_devices, columns_per_device=n1 / num_devices;
+
+    float ** slab_r=allocateSlabs(num_devices, rows_per_device * n1);
+    float ** slab_i=allocateSlabs(num_devices, rows_per_device * n1);
+    for (uint32_t d=0;d<num_devices;d++) {
+        for (uint32_t r=0;r<rows_per_device;r++) {
+            uint32_t row=(d * rows_per_device) + r;
+            for (uint32_t j=0;j<n1;j++) {
+                slab_r[d][(r*n1)+j]=input_r[(j*n2)+row];
+                slab_i[d][(r*n1)+j]=input_i[(j*n2)+row];
+            }
+        }
+    }
+
+    transformRows(backend, slab_r, slab_i, n1, rows_per_device);
+
+    // The slabs pass through the host for the exchange, so the twiddles are applied by the host as part of it
+    for (uint32_t d=0;d<num_devices;d++) {
+        for (uint32_t r=0;r<rows_per_device;r++) {
+            uint32_t row=(d * rows_per_device) + r;
+            for (uint32_t k1=0;k1<n1;k1++) {
+                double base_factor=(2.0 * PI * (double) (((uint64_t) row * k1) % domain_size))/(double) domain_size;
+                float w_r=(float) cos(base_factor), w_i=(float) -sin(base_factor);
+                float d_r=slab_r[d][(r*n1)+k1], d_i=slab_i[d][(r*n1)+k1];
+                slab_r[d][(r*n1)+k1]=(d_r * w_r) - (d_i * w_i);
+                slab_i[d][(r*n1)+k1]=(d_r * w_i) + (d_i * w_r);
+            }
+        }
+    }
+
+    float ** transposed_r=allocateSlabs(num_devices, columns_per_device * n2);
+    float ** transposed_i=allocateSlabs(num_devices, columns_per_device * n2);
+    allToAllTranspose(num_devices, slab_r, slab_i, transposed_r, transposed_i, n2, n1);
+
+    transformRows(backend, transposed_r, transposed_i, n2, columns_per_device);
+
+    for (uint32_t d=0;d<num_devices;d++) {
+        for (uint32_t c=0;c<columns_per_device;c++) {
+            uint32_t k1=(d * columns_per_device) + c;
+            for (uint32_t k2=0;k2<n2;k2++) {
+                result_r[k1+(n1*k2)]=transposed_r[d][(c*n2)+k2];
+                result_i[k1+(n1*k2)]=transposed_i[d][(c*n2)+k2];
+            }
+        }
+    }
+
+    freeSlabs(slab_r, num_devices);
+    freeSlabs(slab_i, num_devices);
+    freeSlabs(transposed_r, num_devices);
+    freeSlabs(transposed_i, num_devices);
+}
+
+/*
+ * 2D FFT of a row major domain, each device is given a slab of rows/P consecutive rows which it transforms, then
+ * after the all to all exchange each device holds cols/P of the columns and transforms those
+ */
+void distributedFFT2D(DistributedBackend * backend, float * input_r, float * input_i, float * result_r, float * result_i, uint32_t rows, uint32_t cols) {
+    uint32_t num_devices=backend->num_devices;
+    uint32_t rows_per_device=rows / num_devices, columns_per_device=cols / num_devices;
+
+    float ** slab_r=allocateSlabs(num_devices, rows_per_device * cols);
+    float ** slab_i=allocateSlabs(num_devices, rows_per_device * cols);
+    for (uint32_t d=0;d<num_devices;d++) {
+        memcpy(slab_r[d], &input_r[d * rows_per_device * cols], sizeof(float) * rows_per_device * cols);
+        memcpy(slab_i[d], &input_i[d * rows_per_device * cols], sizeof(float) * rows_per_device * cols);
+    }
+
+    transformRows(backend, slab_r, slab_i, cols, rows_per_device);
+
+    float ** transposed_r=allocateSlabs(num_devices, columns_per_device * rows);
+    float ** transposed_i=allocateSlabs(num_devices, columns_per_device * rows);
+    allToAllTranspose(num_devices, slab_r, slab_i, transposed_r, transposed_i, rows, cols);
+
+    transformRows(backend, transposed_r, transposed_i, rows, columns_per_device);
+
+    // The columns are transposed back into the row major result as they are gathered
+    for (uint32_t d=0;d<num_devices;d++) {
+        for (uint32_t c=0;c<columns_per_device;c++) {
+            uint32_t column=(d * columns_per_device) + c;
+            for (uint32_t r=0;r<rows;r++) {
+                result_r[(r*cols)+column]=transposed_r[d][(c*rows)+r];
+                result_i[(r*cols)+column]=transposed_i[d][(c*rows)+r];
+            }
+        }
+    }
+
+    freeSlabs(slab_r, num_devices);
+    freeSlabs(slab_i, num_devices);
+    freeSlabs(transposed_r, num_devices);
+    freeSlabs(transposed_i, num_devices);
+}
+
+/*
+ * Runs the 1D and 2D distributed FFTs of a random domain and checks both against the host reference, the 2D
+ * domain being the same points viewed as n1 rows of n2
+ */
+void runDistributedFFT(uint32_t num_devices, bool simulated, uint32_t domain_size) {
+    uint32_t n1=getDistributedSplit(domain_size);
+    uint32_t n2=domain_size / n1;
+    DistributedBackend * backend=createDistributedBackend(num_devices, n2, simulated);
+
+    float * data_r=(float*) malloc(sizeof(float) * domain_size);
+    float * data_i=(float*) malloc(sizeof(float) * domain_size);
+    for (uint32_t i=0;i<domain_size;i++) {
+        data_r[i]=(float) rand()/(float) RAND_MAX;
+        data_i[i]=(float) rand()/(float) RAND_MAX;
+    }
+    float * result_r=(float*) malloc(sizeof(float) * domain_size);
+    float * result_i=(float*) malloc(sizeof(float) * domain_size);
+    float * reference_r=(float*) malloc(sizeof(float) * domain_size);
+    float * reference_i=(float*) malloc(sizeof(float) * domain_size);
+
+    struct timeval start_time;
+    gettimeofday(&start_time, NULL);
+    distributedFFT(backend, data_r, data_i, result_r, result_i, n1, n2);
+    printf("Distributed FFT of size %d (%d x %d) over %d %sdevices: %.6f sec\n", domain_size, n1, n2, num_devices,
+            simulated ? "simulated " : "", getElapsedTime(start_time));
+    referenceDFT(data_r, data_i, reference_r, reference_i, domain_size);
+    checkAgainstReference(result_r, result_i, reference_r, reference_i, domain_size);
+
+    gettimeofday(&start_time, NULL);
+    distributedFFT2D(backend, data_r, data_i, result_r, result_i, n1, n2);
+    printf("Distributed 2D FFT of %d x %d over %d %sdevices: %.6f sec\n", n1, n2, num_devices,
+            simulated ? "simulated " : "", getElapsedTime(start_time));
+    referenceDFT2D(data_r, data_i, reference_r, reference_i, n1, n2);
+    checkAgainstReference(result_r, result_i, reference_r, reference_i, domain_size);
+
+    destroyDistributedBackend(backend);
+    free(data_r);
+    free(data_i);
+    free(result_r);
+    free(result_i);
+    free(reference_r);
+    free(reference_i);
+}
+
+// Forward transform in place of the num_rows rows of row_length points in each device's slab
+static void transformRows(DistributedBackend * backend, float ** slab_r, float ** slab_i, uint32_t row_length, uint32_t num_rows) {
+    if (!backend->simulated) {
+        transformRowsOnDevices(backend, slab_r, slab_i, row_length, num_rows);
+        return;
+    }
+    float * row_result_r=(float*) malloc(sizeof(float) * row_length);
+    float * row_result_i=(float*) malloc(sizeof(float) * row_length);
+    for (uint32_t d=0;d<backend->num_devices;d++) {
+        for (uint32_t r=0;r<num_rows;r++) {
+            referenceDFT(&slab_r[d][r*row_length], &slab_i[d][r*row_length], row_result_r, row_result_i, row_length);
+            memcpy(&slab_r[d][r*row_length], row_result_r, sizeof(float) * row_length);
+            memcpy(&slab_i[d][r*row_length], row_result_i, sizeof(float) * row_length);
+        }
+    }
+    free(row_result_r);
+    free(row_result_i);
+}
+
+/*
+ * Each device transforms all of its rows as one batch, the transforms are enqueued on every device before
+ * any results are read back so the devices run concurrently
+ */
+static void transformRowsOnDevices(DistributedBackend * backend, float ** slab_r, float ** slab_i, uint32_t row_length, uint32_t num_rows) {
+    // The twiddle buffers were sized for the longest row, so the table for this row length is padded to that
+    float * twiddle_factors=(float*) calloc(backend->max_row_length, sizeof(float));
+    float * row_twiddle_factors=computeTwiddleFactors(row_length);
+    memcpy(twiddle_factors, row_twiddle_factors, sizeof(float) * row_length);
+    free(row_twiddle_factors);
+
+    FFTBatch batch={num_rows, row_length};
+    std::vector<std::shared_ptr<Buffer>> rows_r, rows_i, results_r, results_i;
+    for (uint32_t d=0;d<backend->num_devices;d++) {
+        TTExecution * device_descriptor=backend->device_descriptors[d];
+        CommandQueue& cq=backend->devices[d]->command_queue();
+        tt_metal::InterleavedBufferConfig slab_dram_config{
+            .device = backend->devices[d],
+            .size = num_rows * row_length * 4,
+            .page_size = num_rows * row_length * 4,
+            .buffer_type = tt_metal::BufferType::DRAM};
+        rows_r.push_back(CreateBuffer(slab_dram_config));
+        rows_i.push_back(CreateBuffer(slab_dram_config));
+        results_r.push_back(CreateBuffer(slab_dram_config));
+        results_i.push_back(CreateBuffer(slab_dram_config));
+
+        EnqueueWriteBuffer(cq, rows_r[d], slab_r[d], false);
+        EnqueueWriteBuffer(cq, rows_i[d], slab_i[d], false);
+        EnqueueWriteBuffer(cq, device_descriptor->twiddle_dram_buffer, twiddle_factors, false);
+        enqueueFFT(cq, device_descriptor, rows_r[d], rows_i[d], results_r[d], results_i[d], row_length, FFT_FORWARD, false, &batch);
+    }
+    for (uint32_t d=0;d<backend->num_devices;d++) {
+        CommandQueue& cq=backend->devices[d]->command_queue();
+        EnqueueReadBuffer(cq, results_r[d], slab_r[d], false);
+        EnqueueReadBuffer(cq, results_i[d], slab_i[d], false);
+        Finish(cq);
+    }
+    free(twiddle_factors);
+}
+
+/*
+ * Each device s holds rows/P rows of cols points, and sends device t the block of those rows in t's cols/P
+ * columns. Device t holds its columns as rows, so each block is transposed as it is received
+ */
+static void allToAllTranspose(uint32_t num_devices, float ** source_r, float ** source_i, float ** target_r, float ** target_i, uint32_t rows, uint32_t cols) {
+    uint32_t rows_per_device=rows / num_devices, columns_per_device=cols / num_devices;
+    for (uint32_t s=0;s<num_devices;s++) {
+        for (uint32_t t=0;t<num_devices;t++) {
+            for (uint32_t r=0;r<rows_per_device;r++) {
+                for (uint32_t c=0;c<columns_per_device;c++) {
+                    uint32_t source_index=(r*cols) + (t*columns_per_device) + c;
+                    uint32_t target_index=(c*rows) + (s*rows_per_device) + r;
+                    target_r[t][target_index]=source_r[s][source_index];
+                    target_i[t][target_index]=source_i[s][source_index];
+                }
+            }
+        }
+    }
+}
+
+// 2D DFT on the host, rows then columns
+static void referenceDFT2D(float * input_r, float * input_i, float * result_r, float * result_i, uint32_t rows, uint32_t cols) {
+    float * line_r=(float*) malloc(sizeof(float) * rows);
+    float * line_i=(float*) malloc(sizeof(float) * rows);
+    float * line_result_r=(float*) malloc(sizeof(float) * rows);
+    float * line_result_i=(float*) malloc(sizeof(float) * rows);
+    for (uint32_t r=0;r<rows;r++) {
+        referenceDFT(&input_r[r*cols], &input_i[r*cols], &result_r[r*cols], &result_i[r*cols], cols);
+    }
+    for (uint32_t c=0;c<cols;c++) {
+        for (uint32_t r=0;r<rows;r++) {
+            line_r[r]=result_r[(r*cols)+c];
+            line_i[r]=result_i[(r*cols)+c];
+        }
+        referenceDFT(line_r, line_i, line_result_r, line_result_i, rows);
+        for (uint32_t r=0;r<rows;r++) {
+            result_r[(r*cols)+c]=line_result_r[r];
+            result_i[(r*cols)+c]=line_result_i[r];
+        }
+    }
+    free(line_r);
+    free(line_i);
+    free(line_result_r);
+    free(line_result_i);
+}
+
+static float** allocateSlabs(uint32_t num_devices, uint32_t slab_size) {
+    float ** slabs=(float**) malloc(sizeof(float*) * num_devices);
+    for (uint32_t d=0;d<num_devices;d++) {
+        slabs[d]=(float*) malloc(sizeof(float) * slab_size);
+    }
+    return slabs;
+}
+
+static void freeSlabs(float ** slabs, uint32_t num_devices) {
+    for (uint32_t d=0;d<num_devices;d++) {
+        free(slabs[d]);
+    }
+    free(slabs);
+}
@@ -0,0 +1,202 @@
+#include "fft.h"
+
+// Matches CHUNK_SIZE in kernels/constants.h, the butterflies are gathered and computed in chunks of this size
+#define EMULATED_CHUNK_SIZE 512
+
+static void emulateStage(float*, float*, float*, float*, float*, uint32_t, uint32_t, uint32_t, bool, bool, bool);
+static enum EmulatedTwiddleKind emulateTwiddleKind(uint32_t, uint32_t);
+static void emulateCompactTwiddle(float*, uint32_t, uint32_t, float*, float*);
+static uint32_t emulateGetLog(uint32_t);
+
+/*
+ * Runs the transform on the host as the chunked reader, compute and writer kernels do, so that accuracy can
+ * be checked without a device. twiddle_data is the table as uploaded to the device, so the full table, the
+ * first octant if compact_twiddles is set, or the seed tables if twiddle_seed_stride is non-zero. Arithmetic
+ * is in single precision in the same order as the compute kernel, and the result follows the same
+ * convention as fft so a backwards transform is the forward transform of the conjugated input. If
+ * local_substages is set then the first stages are computed as the reader does in L1
+ */
+void emulateFFT(float * input_r, float * input_i, float * twiddle_data, float * result_r, float * result_i, uint32_t domain_size,
+                    enum FFTDirection direction, uint32_t twiddle_seed_stride, bool compact_twiddles, bool local_substages) {
+    float * twiddles=twiddle_data;
+    if (twiddle_seed_stride > 0) {
+        // Expanded as the reader does, each twiddle the product of a coarse and a fine seed
+        uint32_t num_coarse_seeds=(domain_size/2) / twiddle_seed_stride;
+        float * coarse_seeds=&twiddle_data[twiddle_seed_stride*2];
+        twiddles=(float*) malloc(sizeof(float) * domain_size);
+        for (uint32_t i=0;i<num_coarse_seeds;i++) {
+            for (uint32_t j=0;j<twiddle_seed_stride;j++) {
+                uint32_t twiddle_index=(i*twiddle_seed_stride)+j;
+                twiddles[twiddle_index*2]=(coarse_seeds[i*2] * twiddle_data[j*2]) - (coarse_seeds[(i*2)+1] * twiddle_data[(j*2)+1]);
+                twiddles[(twiddle_index*2)+1]=(coarse_seeds[i*2] * twiddle_data[(j*2)+1]) + (coarse_seeds[(i*2)+1] * twiddle_data[j*2]);
+            }
+        }
+    }
+
+    // The reader's input buffer and the writer's staging page, which alternate as the source of each stage
+    float * stage_r=(float*) malloc(sizeof(float) * domain_size);
+    float * stage_i=(float*) malloc(sizeof(float) * domain_size);
+    memcpy(stage_r, input_r, sizeof(float) * domain_size);
+    memcpy(stage_i, input_i, sizeof(float) * domain_size);
+    emulateBitreverse(stage_r, domain_size);
+    emulateBitreverse(stage_i, domain_size);
+
+    uint32_t num_steps=emulateGetLog(domain_size);
+    // As get_first_pipelined_step, the last step always goes through the compute kernel
+    uint32_t local_block_steps=31 - __builtin_clz(2 * EMULATED_CHUNK_SIZE);
+    uint32_t first_step=local_substages ? (local_block_steps < num_steps ? local_block_steps : num_steps) : 0;
+    if (first_step > 0) {
+        // The reader conjugates the input itself, then runs the local stages. It does so block by block, but the
+        // butterflies of a stage are independent so the result is the same as running each stage over the domain
+        if (direction == FFT_BACKWARD) {
+            for (uint32_t i=0;i<domain_size;i++) stage_i[i]=-stage_i[i];
+        }
+        for (uint32_t step=0; step < first_step; step++) {
+            emulateStage(stage_r, stage_i, stage_r, stage_i, twiddles, domain_size, num_steps, step, false, compact_twiddles && twiddle_seed_stride == 0,
+                            true);
+        }
+    }
+    for (uint32_t step=first_step; step <= num_steps; step++) {
+        // The final stage is scattered to the result, each earlier one back in place as the writer pushes the whole page
+        float * out_r=step == num_steps ? result_r : stage_r;
+        float * out_i=step == num_steps ? result_i : stage_i;
+        emulateStage(stage_r, stage_i, out_r, out_i, twiddles, domain_size, num_steps, step,
+                        direction == FFT_BACKWARD && step == 0, compact_twiddles && twiddle_seed_stride == 0, false);
+    }
+
+    free(stage_r);
+    free(stage_i);
+    if (twiddles != twiddle_data) free(twiddles);
+}
+
+/*
+ * One stage, gathered a chunk of butterflies at a time in the order of read_stage_data, computed as by the
+ * compute kernel and then scattered as by write_stage_data. A chunk is computed before it is scattered, so
+ * in and out can be the same arrays. The multiply is skipped for the unit and -j twiddles as by the compute
+ * kernel for whole chunks of them, or for each butterfly if local as by the reader's local stages
+ */
+static void emulateStage(float * in_r, float * in_i, float * out_r, float * out_i, float * twiddles, uint32_t domain_size,
+                            uint32_t num_steps, uint32_t step, bool negate_imaginary, bool compact_twiddles, bool local) {
+    float d0_r[EMULATED_CHUNK_SIZE], d0_i[EMULATED_CHUNK_SIZE], d1_r[EMULATED_CHUNK_SIZE], d1_i[EMULATED_CHUNK_SIZE];
+    float twiddle_r[EMULATED_CHUNK_SIZE], twiddle_i[EMULATED_CHUNK_SIZE];
+    uint32_t d0_index[EMULATED_CHUNK_SIZE];
+    enum EmulatedTwiddleKind twiddle_kind[EMULATED_CHUNK_SIZE];
+
+    uint32_t num_spectra_in_step=step == 0 ? 1 : 2 << (step-1);
+    uint32_t increment_next_point_in_step=2 << step;
+    uint32_t matching_second_point=increment_next_point_in_step/2;
+    uint32_t num_butterflies=domain_size/2;
+
+    uint32_t tgt_data_idx=0, butterflies_gathered=0;
+    for (uint32_t spectra=0; spectra < num_spectra_in_step; spectra++) {
+        uint32_t twiddle_index=spectra << (num_steps-step);
+        float spectra_twiddle_r, spectra_twiddle_i;
+        if (compact_twiddles) {
+            emulateCompactTwiddle(twiddles, twiddle_index, domain_size, &spectra_twiddle_r, &spectra_twiddle_i);
+        } else {
+            spectra_twiddle_r=twiddles[twiddle_index*2];
+            spectra_twiddle_i=twiddles[(twiddle_index*2)+1];
+        }
+        for (uint32_t point=0; point < domain_size; point+=increment_next_point_in_step) {
+            uint32_t d0_data_index=spectra + point;
+            uint32_t d1_data_index=spectra + point + matching_second_point;
+            d0_index[tgt_data_idx]=d0_data_index;
+            d0_r[tgt_data_idx]=in_r[d0_data_index];
+            d0_i[tgt_data_idx]=in_i[d0_data_index];
+            d1_r[tgt_data_idx]=in_r[d1_data_index];
+            d1_i[tgt_data_idx]=in_i[d1_data_index];
+            twiddle_r[tgt_data_idx]=spectra_twiddle_r;
+            twiddle_i[tgt_data_idx]=spectra_twiddle_i;
+            twiddle_kind[tgt_data_idx]=local ? emulateTwiddleKind(twiddle_index, domain_size) :
+                                        emulateChunkTwiddleKind(step, butterflies_gathered / EMULATED_CHUNK_SIZE, domain_size, num_steps);
+            tgt_data_idx++;
+            butterflies_gathered++;
+
+            if (tgt_data_idx == EMULATED_CHUNK_SIZE || butterflies_gathered == num_butterflies) {
+                for (uint32_t i=0;i<tgt_data_idx;i++) {
+                    float a0_i=negate_imaginary ? -d0_i[i] : d0_i[i];
+                    float a1_i=negate_imaginary ? -d1_i[i] : d1_i[i];
+                    float f0, f1;
+                    if (twiddle_kind[i] == UNIT_TWIDDLE) {
+                        f0=d1_r[i];
+                        f1=a1_i;
+                    } else if (twiddle_kind[i] == MINUS_J_TWIDDLE) {
+                        f0=a1_i;
+                        f1=-d1_r[i];
+                    } else {
+                        f0=(d1_r[i] * twiddle_r[i]) - (a1_i * twiddle_i[i]);
+                        f1=(d1_r[i] * twiddle_i[i]) + (a1_i * twiddle_r[i]);
+                    }
+                    uint32_t d1_out_index=d0_index[i] + matching_second_point;
+                    out_r[d1_out_index]=d0_r[i] - f0;
+                    out_i[d1_out_index]=a0_i - f1;
+                    out_r[d0_index[i]]=d0_r[i] + f0;
+                    out_i[d0_index[i]]=a0_i + f1;
+                }
+                tgt_data_idx=0;
+            }
+        }
+    }
+}
+
+// As get_twiddle_kind in the kernels
+static enum EmulatedTwiddleKind emulateTwiddleKind(uint32_t twiddle_index, uint32_t domain_size) {
+    if (twiddle_index == 0) return UNIT_TWIDDLE;
+    return twiddle_index == domain_size/4 ? MINUS_J_TWIDDLE : GENERAL_TWIDDLE;
+}
+
+// As get_chunk_twiddle_kind in the kernels
+enum EmulatedTwiddleKind emulateChunkTwiddleKind(uint32_t step, uint32_t chunk, uint32_t domain_size, uint32_t num_steps) {
+    if (step == 0) return UNIT_TWIDDLE;
+    uint32_t butterflies_per_spectra=(domain_size/2) >> step;
+    if (butterflies_per_spectra % EMULATED_CHUNK_SIZE != 0) return GENERAL_TWIDDLE;
+    uint32_t spectra=(chunk * EMULATED_CHUNK_SIZE) / butterflies_per_spectra;
+    return emulateTwiddleKind(spectra << (num_steps-step), domain_size);
+}
+
+// As get_compact_twiddle in the reader
+static void emulateCompactTwiddle(float * twiddle_data, uint32_t twiddle_index, uint32_t domain_size, float * twiddle_r, float * twiddle_i) {
+    uint32_t eighth=domain_size/8, quarter=domain_size/4;
+    if (twiddle_index <= eighth) {
+        *twiddle_r=twiddle_data[twiddle_index*2];
+        *twiddle_i=twiddle_data[(twiddle_index*2)+1];
+    } else if (twiddle_index <= quarter) {
+        uint32_t idx=quarter-twiddle_index;
+        *twiddle_r=-twiddle_data[(idx*2)+1];
+        *twiddle_i=-twiddle_data[idx*2];
+    } else if (twiddle_index <= quarter+eighth) {
+        uint32_t idx=twiddle_index-quarter;
+        *twiddle_r=twiddle_data[(idx*2)+1];
+        *twiddle_i=-twiddle_data[idx*2];
+    } else {
+        uint32_t idx=(domain_size/2)-twiddle_index;
+        *twiddle_r=-twiddle_data[idx*2];
+        *twiddle_i=twiddle_data[(idx*2)+1];
+    }
+}
+
+void emulateBitreverse(float * data, uint32_t n) {
+  uint32_t j=0;
+  for (uint32_t i=0;i<n-1;i++) {
+    if (i < j) {
+      float temp_val=data[i];
+      data[i]=data[j];
+      data[j]=temp_val;
+    }
+    uint32_t k=n >> 1;
+    while (k <= j) {
+      j -= k;
+      k >>= 1;
+    }
+    j+=k;
+  }
+}
+
+static uint32_t emulateGetLog(uint32_t n) {
+   uint32_t logn=0;
+   n >>= 1;
+   while ((n >>=1) > 0) {
+      logn++;
+   }
+   return logn;
+}
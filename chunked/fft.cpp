@@ -1,143 +1,274 @@
-#include "host_api.hpp"
-#include "device.hpp"
+#include "fft.h"
 #include <sys/time.h>
 #include <time.h>
 
-#define PI 3.14159265358979323846264338327950288
-
 using namespace tt;
 using namespace tt::tt_metal;
 
-enum FFTDirection {
-    FFT_FORWARD=0,
-    FFT_BACKWARD=1
-};
-
-struct TTExecution {
-    Program *program;
-    CoreCoord *core;
-    KernelHandle *read_kernel, *write_kernel, *compute_kernel;
-    std::shared_ptr<tt::tt_metal::Buffer> in_data_r_dram_buffer, in_data_i_dram_buffer, twiddle_dram_buffer, result_data_r_dram_buffer, result_data_i_dram_buffer;
-    std::shared_ptr<tt::tt_metal::Buffer> read_in_r_buffer, read_in_i_buffer, twiddle_buffer;
-};
-
-void fft(CommandQueue&, TTExecution*, float*, float*, float*, float*, float*, uint32_t, enum FFTDirection);
-void compare(float*, float*, float*, float*, int);
-void moveorigin(float*, float*, int);
-void descale(float*, float*, int);
-int checkIfPowerOfTwo(int);
-CBHandle createCB(Program&, CoreCoord&, uint32_t, uint32_t, uint32_t);
-float* computeTwiddleFactors(int);
-static double getElapsedTime(struct timeval);
-
+// The shared library is built from the same sources, without the executable's entry point
+#ifndef TTFFT_LIBRARY
 int main(int argc, char** argv) {
-    if (argc != 2) {
+    if (argc < 2) {
       fprintf(stderr, "You must provide the size of the domain as an argument\n");
       return -1;
     }
 
+    bool generate_twiddles=false, compact_twiddles=false, correlate=false, pipeline_stages=false, specialise_kernels=false;
+    bool simulate_devices=false, accuracy_suite=false, local_substages=false, benchmark_backends=false, dry_run=false, emulate=false;
+    int filter_length=0, stft_hop=0, distribute_devices=0, input_length=0, trace_replays=0;
+    // Clients of the scheduler's load generator, and the devices their requests are spread over
+    int schedule_clients=0, schedule_devices=0;
+    // A negative component is all of them, and the chunk size defaults to CHUNK_SIZE in kernels/constants.h
+    int microbenchmark_component=-2, microbenchmark_chunk_size=512;
+    enum FFTStrategy strategy=CHUNKED_STRATEGY;
+    enum FFTComputeBackend compute_backend=FPU_BACKEND;
+    enum FFTPostStage post_stage=NO_POST_STAGE;
+    enum FFTReduction reduction=NO_REDUCTION;
+    int reduction_capacity=0;
+    float reduction_threshold=0.0f;
+    for (int i=2;i<argc;i++) {
+      if (strcmp(argv[i], "--generate-twiddles") == 0) {
+        generate_twiddles=true;
+      } else if (strcmp(argv[i], "--compact-twiddles") == 0) {
+        compact_twiddles=true;
+      } else if (strcmp(argv[i], "--convolve") == 0 && i+1 < argc) {
+        filter_length=atoi(argv[++i]);
+      } else if (strcmp(argv[i], "--correlate") == 0) {
+        correlate=true;
+      } else if (strcmp(argv[i], "--stft") == 0 && i+1 < argc) {
+        stft_hop=atoi(argv[++i]);
+      } else if (strcmp(argv[i], "--pipeline-stages") == 0) {
+        pipeline_stages=true;
+      } else if (strcmp(argv[i], "--specialise-kernels") == 0) {
+        specialise_kernels=true;
+      } else if (strcmp(argv[i], "--distribute") == 0 && i+1 < argc) {
+        distribute_devices=atoi(argv[++i]);
+      } else if (strcmp(argv[i], "--simulate-devices") == 0) {
+        simulate_devices=true;
+      } else if (strcmp(argv[i], "--accuracy-suite") == 0) {
+        accuracy_suite=true;
+      } else if (strcmp(argv[i], "--local-substages") == 0) {
+        local_substages=true;
+      } else if (strcmp(argv[i], "--strategy") == 0 && i+1 < argc) {
+        int parsed_strategy=parseFFTStrategy(argv[++i]);
+        if (parsed_strategy < 0) {
+          fprintf(stderr, "Unknown strategy '%s', this must be chunked, whole-domain or auto\n", argv[i]);
+          return -1;
+        }
+        strategy=(enum FFTStrategy) parsed_strategy;
+      } else if (strcmp(argv[i], "--compute-backend") == 0 && i+1 < argc) {
+        int parsed_backend=parseComputeBackend(argv[++i]);
+        if (parsed_backend < 0) {
+          fprintf(stderr, "Unknown compute backend '%s', this must be fpu, sfpu or hybrid\n", argv[i]);
+          return -1;
+        }
+        compute_backend=(enum FFTComputeBackend) parsed_backend;
+      } else if (strcmp(argv[i], "--benchmark-backends") == 0) {
+        benchmark_backends=true;
+      } else if (strcmp(argv[i], "--spectrum") == 0 && i+1 < argc) {
+        int parsed_post_stage=parsePostStage(argv[++i]);
+        if (parsed_post_stage <= NO_POST_STAGE) {
+          fprintf(stderr, "Unknown spectrum '%s', this must be power or db\n", argv[i]);
+          return -1;
+        }
+        post_stage=(enum FFTPostStage) parsed_post_stage;
+      } else if (strcmp(argv[i], "--input-length") == 0 && i+1 < argc) {
+        input_length=atoi(argv[++i]);
+      } else if (strcmp(argv[i], "--dry-run") == 0) {
+        dry_run=true;
+      } else if (strcmp(argv[i], "--trace") == 0 && i+1 < argc) {
+        trace_replays=atoi(argv[++i]);
+      } else if (strcmp(argv[i], "--emulate") == 0) {
+        emulate=true;
+      } else if (strcmp(argv[i], "--microbenchmark") == 0 && i+1 < argc) {
+        microbenchmark_component=strcmp(argv[++i], "all") == 0 ? -1 : parseFFTComponent(argv[i]);
+        if (microbenchmark_component < 0 && strcmp(argv[i], "all") != 0) {
+          fprintf(stderr, "Unknown component '%s', this must be bitreverse, gather, twiddle, butterfly, scatter or all\n", argv[i]);
+          return -1;
+        }
+      } else if (strcmp(argv[i], "--chunk-size") == 0 && i+1 < argc) {
+        microbenchmark_chunk_size=atoi(argv[++i]);
+      } else if (strcmp(argv[i], "--schedule") == 0 && i+2 < argc) {
+        schedule_clients=atoi(argv[++i]);
+        schedule_devices=atoi(argv[++i]);
+      } else if (strcmp(argv[i], "--top-k") == 0 && i+1 < argc) {
+        reduction=TOP_K_REDUCTION;
+        reduction_capacity=atoi(argv[++i]);
+      } else if (strcmp(argv[i], "--threshold") == 0 && i+2 < argc) {
+        // The threshold is of the power, or of the spectrum's values with --spectrum, and at most capacity points are returned
+        reduction=THRESHOLD_REDUCTION;
+        reduction_threshold=(float) atof(argv[++i]);
+        reduction_capacity=atoi(argv[++i]);
+      } else {
+        fprintf(stderr, "Unknown option '%s'\n", argv[i]);
+        return -1;
+      }
+    }
+
     int domain_size=atoi(argv[1]);
-    if (!checkIfPowerOfTwo(domain_size)) {
-      fprintf(stderr, "%d provided as domain size, but this must be a power of two\n", domain_size);
+    if (domain_size < 2) {
+      fprintf(stderr, "%d provided as domain size, but this must be at least two\n", domain_size);
+      return -1;
+    }
+    // Non power of two domains are built from power of two transforms on the device
+    uint32_t device_domain_size=getDeviceDomainSize(domain_size);
+    // The seed tables are staged in an input buffer on the device, which is too small for them below eight points
+    uint32_t twiddle_seed_stride=generate_twiddles && device_domain_size >= 8 ? getTwiddleSeedStride(device_domain_size) : 0;
+    // The compact table holds the first octant of twiddles, so the domain must divide into eighths
+    if (compact_twiddles && (generate_twiddles || device_domain_size < 8)) {
+      fprintf(stderr, "Compact twiddles require a domain of at least eight points and can not be combined with generated twiddles\n");
+      return -1;
+    }
+    // Overlap-save needs each block to advance by at least one point, and the filter multiply is fused into the power of two pipeline
+    if (filter_length > 0 && (filter_length >= domain_size || device_domain_size != (uint32_t) domain_size)) {
+      fprintf(stderr, "Convolution requires a power of two domain size larger than the filter length of %d\n", filter_length);
+      return -1;
+    }
+    // Frames are read straight from DRAM at multiples of the hop, which must keep the 64 byte DRAM read alignment
+    if (stft_hop != 0 && (stft_hop < 0 || stft_hop % 16 != 0 || domain_size < 16 || device_domain_size != (uint32_t) domain_size || filter_length > 0)) {
+      fprintf(stderr, "STFT requires a power of two domain size of at least 16 and a positive hop that is a multiple of 16, without convolution\n");
+      return -1;
+    }
+    // The signal is read straight from DRAM into the start of the domain, so its length keeps the same alignment as the STFT hop
+    if (input_length != 0 && (post_stage == NO_POST_STAGE || reduction != NO_REDUCTION)) {
+      fprintf(stderr, "An input length is only used with --spectrum, without a reduction\n");
+      return -1;
+    }
+    // Frames are held one after another so keep the DRAM read alignment, and each record is built in a page of the writer's staging buffer
+    if (reduction != NO_REDUCTION && (domain_size < 16 || device_domain_size != (uint32_t) domain_size || filter_length > 0 || stft_hop > 0 ||
+          reduction_capacity < 1 || reduction_capacity > MAX_REDUCTION_CAPACITY)) {
+      fprintf(stderr, "A reduction requires a power of two domain size of at least 16 and a capacity from 1 to %d, without convolution or STFT\n",
+              MAX_REDUCTION_CAPACITY);
+      return -1;
+    }
+    if (post_stage != NO_POST_STAGE && (domain_size < 16 || device_domain_size != (uint32_t) domain_size || filter_length > 0 || stft_hop > 0 ||
+          input_length < 0 || input_length > domain_size || input_length % 16 != 0)) {
+      fprintf(stderr, "A spectrum requires a power of two domain size of at least 16 and an input length that is a multiple of 16 no larger than this, "
+                      "without convolution or STFT\n");
+      return -1;
+    }
+    // A trace holds a single launch between the execution's own buffers
+    if (trace_replays != 0 && (trace_replays < 0 || device_domain_size != (uint32_t) domain_size || filter_length > 0 || stft_hop > 0 ||
+          post_stage != NO_POST_STAGE || reduction != NO_REDUCTION)) {
+      fprintf(stderr, "A trace requires a power of two domain size and a positive number of replays, without convolution, STFT, spectrum or reduction\n");
+      return -1;
+    }
+    bool microbenchmark=microbenchmark_component >= -1;
+    if (emulate && trace_replays == 0 && !microbenchmark && schedule_clients == 0) {
+      fprintf(stderr, "Emulation is only used with --trace, --microbenchmark or --schedule, the accuracy suite always emulates\n");
+      return -1;
+    }
+    // The domain size is the largest submitted, and each device holds a batch of frames of it in one DRAM bank
+    if (schedule_clients != 0 && (schedule_clients < 0 || schedule_devices < 1 || !checkIfPowerOfTwo(domain_size) || domain_size > 65536 ||
+          (!emulate && (std::size_t) schedule_devices > GetNumAvailableDevices()))) {
+      fprintf(stderr, "Scheduling requires a positive number of clients, a positive number of devices no more than are available unless "
+                      "emulated, and a power of two domain size of at most 65536\n");
+      return -1;
+    }
+    // The harness holds the domain, its imaginary part and the twiddles in L1 together, and a stage is domain_size/2 butterflies
+    if (microbenchmark && (!checkIfPowerOfTwo(domain_size) || domain_size > 65536 || !checkIfPowerOfTwo(microbenchmark_chunk_size) ||
+          microbenchmark_chunk_size > domain_size/2)) {
+      fprintf(stderr, "The microbenchmarks require a power of two domain size of at most 65536, which is the largest size timed, and a "
+                      "power of two chunk size of at most half of it\n");
+      return -1;
+    }
+    if (correlate && filter_length == 0) {
+      fprintf(stderr, "Correlation requires a filter length to be provided with --convolve\n");
       return -1;
     }
 
-    /* Silicon accelerator setup */
-    IDevice* device = CreateDevice(0);
-
-    /* Setup program to execute along with its buffers and kernels to use */
-    CommandQueue& cq = device->command_queue();
-    Program program = CreateProgram();
-    CoreCoord core = {0, 0};
-
-    uint32_t problem_mem_size = 4 * domain_size;
-    tt_metal::InterleavedBufferConfig dram_config{
-        .device = device,
-        .size = problem_mem_size,
-        .page_size = problem_mem_size,
-        .buffer_type = tt_metal::BufferType::DRAM};
-
-    std::shared_ptr<tt::tt_metal::Buffer> in_data_r_dram_buffer = CreateBuffer(dram_config);
-    std::shared_ptr<tt::tt_metal::Buffer> in_data_i_dram_buffer = CreateBuffer(dram_config);
-    std::shared_ptr<tt::tt_metal::Buffer> result_data_r_dram_buffer = CreateBuffer(dram_config);
-    std::shared_ptr<tt::tt_metal::Buffer> result_data_i_dram_buffer = CreateBuffer(dram_config);
-    std::shared_ptr<tt::tt_metal::Buffer> twiddle_dram_buffer = CreateBuffer(dram_config);
-
-    /* Use L1 circular buffers to set input and output buffers that the compute engine will use */
-    uint32_t cb_tile_size=1024 * 2;
-    uint32_t cb_total_size=problem_mem_size > cb_tile_size ? problem_mem_size: cb_tile_size;
-    uint32_t num_chunks=4; //cb_total_size / cb_tile_size;
-    // Data 0 into compute
-    createCB(program, core, CBIndex::c_0, num_chunks, cb_tile_size);
-    createCB(program, core, CBIndex::c_1, num_chunks, cb_tile_size);
-    // Data 1 into compute
-    createCB(program, core, CBIndex::c_2, num_chunks, cb_tile_size);
-    createCB(program, core, CBIndex::c_3, num_chunks, cb_tile_size);
-    // Twiddle factors
-    createCB(program, core, CBIndex::c_4, num_chunks, cb_tile_size);
-    createCB(program, core, CBIndex::c_5, num_chunks, cb_tile_size);
-    // Data 0 out from compute
-    createCB(program, core, CBIndex::c_6, num_chunks, cb_tile_size);
-    createCB(program, core, CBIndex::c_7, num_chunks, cb_tile_size);
-    // Data 1 out from compute
-    createCB(program, core, CBIndex::c_8, num_chunks, cb_tile_size);
-    createCB(program, core, CBIndex::c_9, num_chunks, cb_tile_size);
-    // Data 0 rearranged from writer
-    // This must be two as when we pipeline the writer is writing the current iteration to
-    // the next CB and reader is reading from the current CB. The same applies to the 
-    // data 1 CB (next one) too
-    createCB(program, core, CBIndex::c_10, 2, cb_total_size);
-    // Data 1 rearranged from writer
-    createCB(program, core, CBIndex::c_11, 2, cb_total_size);
-    // Intermediate results
-    // The CB size is all one below here as these are used internally by the compute core
-    // as intermediate results
-    createCB(program, core, CBIndex::c_12, 1, cb_tile_size);
-    createCB(program, core, CBIndex::c_13, 1, cb_tile_size);
-    createCB(program, core, CBIndex::c_14, 1, cb_tile_size);
-    // f0
-    createCB(program, core, CBIndex::c_15, 1, cb_tile_size);
-    // f1
-    createCB(program, core, CBIndex::c_16, 1, cb_tile_size);
-
-    tt::tt_metal::InterleavedBufferConfig l1_read_buffer_config{
-        .device= device,
-        .size = problem_mem_size,
-        .page_size = problem_mem_size,
-        .buffer_type = tt::tt_metal::BufferType::L1};
-
-    std::shared_ptr<tt::tt_metal::Buffer> read_in_r_buffer = CreateBuffer(l1_read_buffer_config);
-    std::shared_ptr<tt::tt_metal::Buffer> read_in_i_buffer = CreateBuffer(l1_read_buffer_config);
-    // Whilst we have n/2 twiddle factors, pack real and imaginary in so the data size is the same
-    std::shared_ptr<tt::tt_metal::Buffer> twiddle_buffer = CreateBuffer(l1_read_buffer_config);
+    // The window of an STFT or spectrum plan is held in L1 alongside the execution's own buffers
+    uint32_t window_length=0;
+    if (stft_hop > 0) window_length=domain_size;
+    if (post_stage != NO_POST_STAGE && reduction == NO_REDUCTION) window_length=input_length != 0 ? input_length : domain_size;
+    FFTFootprint footprint;
+    if (dry_run) {
+      // Sized as a Wormhole core without opening a device, the exit status is whether the configuration fits
+      bool fits=planFFTFootprint(&footprint, NULL, device_domain_size, &compact_twiddles, twiddle_seed_stride > 0, filter_length > 0, window_length, 0);
+      printFFTFootprint(&footprint);
+      return fits ? 0 : -1;
+    }
 
-    /* Specify data movement kernels for reading/writing data to/from DRAM */
-    KernelHandle reader_kernel_id = CreateKernel(
-        program,
-        "kernels/dataflow/reader.cpp",
-        core,
-        DataMovementConfig{.processor = DataMovementProcessor::RISCV_1, .noc = NOC::RISCV_1_default});
+    if (accuracy_suite) {
+      // Runs on the host and the emulated kernels, the domain size is the largest checked
+      if (!checkIfPowerOfTwo(domain_size)) {
+        fprintf(stderr, "The accuracy suite requires a power of two domain size, which is the largest size checked\n");
+        return -1;
+      }
+      return runAccuracySuite(domain_size) == 0 ? 0 : -1;
+    }
+    if (schedule_clients > 0) {
+      // The scheduler opens its own devices, or runs its mock devices on the host when emulated
+      runSchedulerLoad(schedule_devices, domain_size, schedule_clients, emulate);
+      return 0;
+    }
+    if (microbenchmark && emulate) {
+      // Just the host equivalents of the harness kernels
+      runMicrobenchmarks(NULL, NULL, microbenchmark_component, domain_size, microbenchmark_chunk_size, compute_backend);
+      return 0;
+    }
+    if (emulate) {
+      // The trace is replayed on the host, with the table that would have been uploaded
+      float * twiddle_data;
+      if (twiddle_seed_stride > 0) {
+        twiddle_data=computeTwiddleSeeds(device_domain_size, twiddle_seed_stride);
+      } else if (compact_twiddles) {
+        twiddle_data=computeCompactTwiddleFactors(device_domain_size);
+      } else {
+        twiddle_data=computeTwiddleFactors(device_domain_size);
+      }
+      runTrace(NULL, NULL, NULL, twiddle_data, domain_size, twiddle_seed_stride, compact_twiddles, local_substages, trace_replays);
+      free(twiddle_data);
+      freeHostBuffers();
+      return 0;
+    }
+    if (benchmark_backends && !checkIfPowerOfTwo(domain_size)) {
+      fprintf(stderr, "The backend benchmark requires a power of two domain size, which is the largest size timed\n");
+      return -1;
+    }
 
-    KernelHandle writer_kernel_id = CreateKernel(
-        program,
-        "kernels/dataflow/writer.cpp",
-        core,
-        DataMovementConfig{.processor = DataMovementProcessor::RISCV_0, .noc = NOC::RISCV_0_default});
+    if (distribute_devices != 0 || simulate_devices) {
+      // Each device gets a whole number of rows in both passes, which are batched so rows must keep the DRAM read alignment
+      uint32_t n1=getDistributedSplit(domain_size);
+      if (distribute_devices <= 0 || !checkIfPowerOfTwo(domain_size) || !checkIfPowerOfTwo(distribute_devices) || (uint32_t) distribute_devices > n1 ||
+            (!simulate_devices && (n1 < 16 || (std::size_t) distribute_devices > GetNumAvailableDevices()))) {
+        fprintf(stderr, "Distributing requires a power of two number of devices, no more than %d for this domain size, and a power of two domain size "
+                        "of at least 256 unless the devices are simulated\n", n1);
+        return -1;
+      }
+      // The distributed FFT opens its own devices, or none when they are simulated
+      runDistributedFFT(distribute_devices, simulate_devices, domain_size);
+      return 0;
+    }
 
-    /* Set the parameters that the compute kernel will use */
-    std::vector<uint32_t> compute_kernel_args = {};
+    /* Silicon accelerator setup */
+    // Traces are held in their own region of DRAM, which is only reserved when tracing
+    IDevice* device = CreateDevice(0, 1, DEFAULT_L1_SMALL_SIZE, trace_replays > 0 ? FFT_TRACE_REGION_SIZE : 0);
 
-    /* Use the add_tiles operation in the compute kernel */
-    KernelHandle compute_kernel_id = CreateKernel(
-        program,
-        "kernels/compute/compute.cpp",
-        core,
-        ComputeConfig{
-            .math_fidelity = MathFidelity::HiFi4,
-            .fp32_dest_acc_en = false,
-            .math_approx_mode = false,
-            .compile_args = compute_kernel_args,
-        });
+    /* Setup program to execute along with its buffers and kernels to use */
+    CommandQueue& cq = device->command_queue();
+    if (benchmark_backends) {
+      // Each domain size has its own execution, with a plan per backend
+      runBackendBenchmark(device, cq, domain_size);
+      CloseDevice(device);
+      return 0;
+    }
+    if (microbenchmark) {
+      // Each component has its own harness program, rather than an execution
+      runMicrobenchmarks(device, &cq, microbenchmark_component, domain_size, microbenchmark_chunk_size, compute_backend);
+      CloseDevice(device);
+      return 0;
+    }
+    if (!planFFTFootprint(&footprint, device, device_domain_size, &compact_twiddles, twiddle_seed_stride > 0, filter_length > 0, window_length, 0)) {
+      printFFTFootprint(&footprint);
+      fprintf(stderr, "The configuration does not fit on the device, even with compact twiddles where these are possible\n");
+      CloseDevice(device);
+      return -1;
+    }
+    if (footprint.downgraded) printf("Using compact twiddles so that domain size %d fits in L1\n", device_domain_size);
+    TTExecution * exec=createTTExecution(device, device_domain_size, twiddle_seed_stride, compact_twiddles, filter_length > 0,
+                                            pipeline_stages, specialise_kernels, local_substages, compute_backend);
+    exec->strategy=strategy;
 
     /* Create source data and write to DRAM */
     float * golden_r=(float*) malloc(sizeof(float) * domain_size);
@@ -149,147 +280,230 @@ int main(int argc, char** argv) {
     golden_r[domain_size/2]=(float) domain_size;
     golden_i[domain_size/2]=(float) domain_size*2;
 
-    float * twiddle_factors=computeTwiddleFactors(domain_size);
+    // When twiddles are generated on the device they are not needed on the host at all
+    float * twiddle_factors=NULL;
+    if (compact_twiddles) {
+        twiddle_factors=computeCompactTwiddleFactors(device_domain_size);
+    } else if (twiddle_seed_stride == 0) {
+        twiddle_factors=computeTwiddleFactors(device_domain_size);
+    }
 
-    float * data_r=(float*) malloc(sizeof(float) * domain_size);
-    float * data_i=(float*) malloc(sizeof(float) * domain_size);
+    float * data_r=allocateHostBuffer(domain_size);
+    float * data_i=allocateHostBuffer(domain_size);
 
     memcpy(data_r, golden_r, sizeof(float) * domain_size);
     memcpy(data_i, golden_i, sizeof(float) * domain_size);
 
-    /* Configure program and runtime kernel arguments, then execute */
-
-    TTExecution exec={
-        .program=&program,
-        .core=&core,
-        .read_kernel=&reader_kernel_id,
-        .write_kernel=&writer_kernel_id,
-        .compute_kernel=&compute_kernel_id,
-        .in_data_r_dram_buffer=in_data_r_dram_buffer,
-        .in_data_i_dram_buffer=in_data_i_dram_buffer,
-        .twiddle_dram_buffer=twiddle_dram_buffer,
-        .result_data_r_dram_buffer=result_data_r_dram_buffer,
-        .result_data_i_dram_buffer=result_data_i_dram_buffer,
-        .read_in_r_buffer=read_in_r_buffer,
-        .read_in_i_buffer=read_in_i_buffer,
-        .twiddle_buffer=twiddle_buffer
-    };
-
-    //for (int i=0;i<1;i++) {
-    //    printf("Iteration %d:\n", i);
+    if (filter_length > 0) {
+        // Convolution is checked against its own reference instead of the round trip
+        runConvolution(cq, exec, twiddle_factors, domain_size, filter_length, correlate);
+    } else if (stft_hop > 0) {
+        runSTFT(device, cq, exec, twiddle_factors, domain_size, stft_hop);
+    } else if (trace_replays > 0) {
+        runTrace(device, &cq, exec, twiddle_factors, domain_size, twiddle_seed_stride, compact_twiddles, local_substages, trace_replays);
+    } else if (reduction != NO_REDUCTION) {
+        runReduction(device, cq, exec, twiddle_factors, domain_size, post_stage, reduction, reduction_capacity, reduction_threshold);
+    } else if (post_stage != NO_POST_STAGE) {
+        // Without an input length the signal fills the domain, so there is no zero padding
+        runSpectrum(device, cq, exec, twiddle_factors, domain_size, input_length != 0 ? input_length : domain_size, post_stage);
+    } else if (domain_size == device_domain_size) {
+        // The spectrum stays on the device between the forward and backward transforms
+        fftRoundTrip(device, cq, exec, data_r, data_i, twiddle_factors, domain_size);
+        descale(data_r, data_i, domain_size);
+        // The round trip returns the original data, up to rounding
+        checkAgainstReference(data_r, data_i, golden_r, golden_i, domain_size);
+    } else {
         // We reuse the data arrays for the results
-        fft(cq, &exec, data_r, data_i, twiddle_factors, data_r, data_i, domain_size, FFT_FORWARD);
-        fft(cq, &exec, data_r, data_i, twiddle_factors, data_r, data_i, domain_size, FFT_BACKWARD);
-    //}
-
-    moveorigin(data_r, data_i, domain_size);
-    descale(data_r, data_i, domain_size);
-
-    //compare(data_r, data_i, golden_r, golden_i, domain_size);
+        fftAnySize(cq, exec, data_r, data_i, twiddle_factors, data_r, data_i, domain_size, device_domain_size, FFT_FORWARD);
+        if (!checkIfPowerOfTwo(domain_size)) {
+            // The host combination steps are checked against a reference DFT of the original data
+            float * reference_r=(float*) malloc(sizeof(float) * domain_size);
+            float * reference_i=(float*) malloc(sizeof(float) * domain_size);
+            referenceDFT(golden_r, golden_i, reference_r, reference_i, domain_size);
+            checkAgainstReference(data_r, data_i, reference_r, reference_i, domain_size);
+            free(reference_r);
+            free(reference_i);
+        }
+        fftAnySize(cq, exec, data_r, data_i, twiddle_factors, data_r, data_i, domain_size, device_domain_size, FFT_BACKWARD);
+        descale(data_r, data_i, domain_size);
+        checkAgainstReference(data_r, data_i, golden_r, golden_i, domain_size);
+    }
 
+    destroyTTExecution(exec);
     CloseDevice(device);
 
-    free(data_r);
-    free(data_i);
+    releaseHostBuffer(data_r);
+    releaseHostBuffer(data_i);
+    freeHostBuffers();
     free(twiddle_factors);
     free(golden_r);
     free(golden_i);
 }
+#endif
 
+/*
+ * The input and result can be any host memory, but buffers from allocateHostBuffer are page aligned and locked
+ * in memory so the transfers never fault on them, and are reused between calls rather than allocated afresh
+ */
 void fft(CommandQueue& cq, TTExecution * device_descriptor, float * input_r, float * input_i, float * twiddle_factors, float * result_r, float * result_i, uint32_t domain_size, enum FFTDirection direction) {        
+    struct timeval start_time;
+
+    gettimeofday(&start_time, NULL);
+    EnqueueWriteBuffer(cq, device_descriptor->in_data_r_dram_buffer, input_r, false);
+    EnqueueWriteBuffer(cq, device_descriptor->in_data_i_dram_buffer, input_i, false);
+    if (device_descriptor->twiddle_seed_stride == 0) {
+        EnqueueWriteBuffer(cq, device_descriptor->twiddle_dram_buffer, twiddle_factors, false);
+    }
+    Finish(cq);
+    double xfer_on_time=getElapsedTime(start_time);
+
+    gettimeofday(&start_time, NULL);
+    enqueueFFT(cq, device_descriptor, device_descriptor->in_data_r_dram_buffer, device_descriptor->in_data_i_dram_buffer,
+                device_descriptor->result_data_r_dram_buffer, device_descriptor->result_data_i_dram_buffer, domain_size, direction, false, NULL);
+    Finish(cq);
+    double exec_time=getElapsedTime(start_time);
+    gettimeofday(&start_time, NULL);
+    EnqueueReadBuffer(cq, device_descriptor->result_data_r_dram_buffer, result_r, false);
+    EnqueueReadBuffer(cq, device_descriptor->result_data_i_dram_buffer, result_i, false);
+    Finish(cq);
+    double xfer_off_time=getElapsedTime(start_time);
+
+    double total_time=xfer_on_time+exec_time+xfer_off_time;
+    printf("%s FFT of size %d: total time %.6f sec. %.6f sec transfer on, %.6f sec execution, %.6f sec transfer off\n", 
+            direction == 0 ? "Forwards" : "Backwards", domain_size, total_time, xfer_on_time, exec_time, xfer_off_time);
+}
+
+/*
+ * Sets the runtime arguments and enqueues the program without waiting, reading from and writing to the
+ * provided DRAM buffers so transforms can be chained on the device. If pointwise_multiply is set then
+ * the final stage multiplies the result by the filter spectrum held in the filter DRAM buffers. If batch
+ * is not NULL then its frames are all transformed by this one launch, otherwise there is a single frame
+ */
+void enqueueFFT(CommandQueue& cq, TTExecution * device_descriptor, std::shared_ptr<Buffer> in_data_r_dram_buffer, std::shared_ptr<Buffer> in_data_i_dram_buffer,
+                    std::shared_ptr<Buffer> result_data_r_dram_buffer, std::shared_ptr<Buffer> result_data_i_dram_buffer, uint32_t domain_size,
+                    enum FFTDirection direction, bool pointwise_multiply, FFTBatch * batch) {
+    enum FFTStrategy strategy=selectFFTStrategy(cq, device_descriptor, in_data_r_dram_buffer, in_data_i_dram_buffer, result_data_r_dram_buffer,
+                                                    result_data_i_dram_buffer, domain_size, direction, pointwise_multiply, batch);
+    FFTPlan * plan=getStrategyPlan(device_descriptor, domain_size, direction, strategy);
+    enqueuePlannedFFT(cq, device_descriptor, plan, in_data_r_dram_buffer, in_data_i_dram_buffer, result_data_r_dram_buffer, result_data_i_dram_buffer,
+                        domain_size, direction, pointwise_multiply, batch);
+}
+
+// As enqueueFFT, but runs the program of the provided plan, or the generic chunked program if this is NULL
+void enqueuePlannedFFT(CommandQueue& cq, TTExecution * device_descriptor, FFTPlan * plan, std::shared_ptr<Buffer> in_data_r_dram_buffer,
+                        std::shared_ptr<Buffer> in_data_i_dram_buffer, std::shared_ptr<Buffer> result_data_r_dram_buffer,
+                        std::shared_ptr<Buffer> result_data_i_dram_buffer, uint32_t domain_size, enum FFTDirection direction,
+                        bool pointwise_multiply, FFTBatch * batch) {
+    Program * program=device_descriptor->program;
+    KernelHandle read_kernel=*(device_descriptor->read_kernel);
+    KernelHandle write_kernel=*(device_descriptor->write_kernel);
+    KernelHandle compute_kernel=*(device_descriptor->compute_kernel);
+    uint32_t stage_progress_semaphore=device_descriptor->stage_progress_semaphore;
+    enum FFTStrategy strategy=CHUNKED_STRATEGY;
+    if (plan != NULL) {
+        program=&plan->program;
+        read_kernel=plan->read_kernel;
+        write_kernel=plan->write_kernel;
+        compute_kernel=plan->compute_kernel;
+        stage_progress_semaphore=plan->stage_progress_semaphore;
+        strategy=plan->strategy;
+    }
+
+    getFFTStrategy(strategy)->set_runtime_args(device_descriptor, *program, read_kernel, write_kernel, compute_kernel, stage_progress_semaphore,
+                                                in_data_r_dram_buffer, in_data_i_dram_buffer, result_data_r_dram_buffer, result_data_i_dram_buffer,
+                                                domain_size, direction, pointwise_multiply, batch);
+
+    EnqueueProgram(cq, *program, false);
+}
+
+// Runtime arguments of the chunked kernels, which support every option of the execution
+void setChunkedRuntimeArgs(TTExecution * device_descriptor, Program & program, KernelHandle read_kernel, KernelHandle write_kernel,
+                            KernelHandle compute_kernel, uint32_t stage_progress_semaphore, std::shared_ptr<Buffer> in_data_r_dram_buffer,
+                            std::shared_ptr<Buffer> in_data_i_dram_buffer, std::shared_ptr<Buffer> result_data_r_dram_buffer,
+                            std::shared_ptr<Buffer> result_data_i_dram_buffer, uint32_t domain_size, enum FFTDirection direction,
+                            bool pointwise_multiply, FFTBatch * batch) {
     // Since all interleaved buffers have size == page_size, they are entirely contained in the first DRAM bank
     uint32_t in_data_r_dram_bank_id = 0;
     uint32_t in_data_i_dram_bank_id = 0;
     uint32_t result_data_r_dram_bank_id = 0;
     uint32_t result_data_i_dram_bank_id = 0;
     uint32_t twiddle_dram_bank_id = 0;
+    // The threshold is passed to the writer as its bits
+    uint32_t reduction_threshold_bits = 0;
+    if (batch != NULL) memcpy(&reduction_threshold_bits, &batch->reduction_threshold, sizeof(uint32_t));
 
     const std::vector<uint32_t> read_kernel_runtime_args = {
-            device_descriptor->in_data_r_dram_buffer->address(),
-            device_descriptor->in_data_i_dram_buffer->address(),
+            in_data_r_dram_buffer->address(),
+            in_data_i_dram_buffer->address(),
             device_descriptor->twiddle_dram_buffer->address(),
             in_data_r_dram_bank_id,
             in_data_i_dram_bank_id,
             twiddle_dram_bank_id,
-            device_descriptor->read_in_r_buffer->address(),
-            device_descriptor->read_in_i_buffer->address(),
+            device_descriptor->staging_r_buffer->address(),
+            device_descriptor->staging_i_buffer->address(),
             device_descriptor->twiddle_buffer->address(),
-            domain_size};
+            domain_size,
+            device_descriptor->twiddle_seed_stride,
+            device_descriptor->compact_twiddles,
+            pointwise_multiply ? device_descriptor->filter_r_dram_buffer->address() : 0,
+            pointwise_multiply ? device_descriptor->filter_i_dram_buffer->address() : 0,
+            pointwise_multiply,
+            batch != NULL ? batch->num_frames : 1,
+            batch != NULL ? batch->frame_stride : 0,
+            batch != NULL && batch->window_dram_buffer ? batch->window_dram_buffer->address() : 0,
+            batch != NULL && batch->window_buffer ? batch->window_buffer->address() : 0,
+            device_descriptor->pipeline_stages,
+            stage_progress_semaphore,
+            device_descriptor->local_substages,
+            direction,
+            batch != NULL && batch->input_length != 0 ? batch->input_length : domain_size,
+            (uint32_t) device_descriptor->staging_r_buffer->size() / 2};
 
     const std::vector<uint32_t> write_kernel_runtime_args = {
-            device_descriptor->result_data_r_dram_buffer->address(),
-            device_descriptor->result_data_i_dram_buffer->address(),
+            result_data_r_dram_buffer->address(),
+            result_data_i_dram_buffer->address(),
             result_data_r_dram_bank_id,
             result_data_i_dram_bank_id,
-            domain_size};
+            domain_size,
+            batch != NULL ? batch->num_frames : 1,
+            device_descriptor->pipeline_stages,
+            stage_progress_semaphore,
+            device_descriptor->local_substages,
+            batch != NULL ? batch->post_stage : NO_POST_STAGE,
+            batch != NULL ? batch->reduction : NO_REDUCTION,
+            batch != NULL ? batch->reduction_capacity : 0,
+            reduction_threshold_bits};
 
     SetRuntimeArgs(
-        *(device_descriptor->program),
-        *(device_descriptor->read_kernel),
+        program,
+        read_kernel,
         *(device_descriptor->core),
         read_kernel_runtime_args);
 
     SetRuntimeArgs(
-        *(device_descriptor->program),
-        *(device_descriptor->compute_kernel),
+        program,
+        compute_kernel,
         *(device_descriptor->core),
-        {direction, domain_size});
+        {direction, domain_size, pointwise_multiply, batch != NULL ? batch->num_frames : 1, device_descriptor->local_substages,
+            batch != NULL ? batch->post_stage : NO_POST_STAGE});
 
     SetRuntimeArgs(
-        *(device_descriptor->program),
-        *(device_descriptor->write_kernel),
+        program,
+        write_kernel,
         *(device_descriptor->core),
         write_kernel_runtime_args);
-
-    struct timeval start_time;
-
-    gettimeofday(&start_time, NULL);
-    EnqueueWriteBuffer(cq, device_descriptor->in_data_r_dram_buffer, input_r, false);
-    EnqueueWriteBuffer(cq, device_descriptor->in_data_i_dram_buffer, input_i, false);
-    EnqueueWriteBuffer(cq, device_descriptor->twiddle_dram_buffer, twiddle_factors, false);
-    Finish(cq);
-    double xfer_on_time=getElapsedTime(start_time);
-
-    gettimeofday(&start_time, NULL);
-    EnqueueProgram(cq, *(device_descriptor->program), false);
-    Finish(cq);
-    double exec_time=getElapsedTime(start_time);
-
-    gettimeofday(&start_time, NULL);
-    EnqueueReadBuffer(cq, device_descriptor->result_data_r_dram_buffer, result_r, false);
-    EnqueueReadBuffer(cq, device_descriptor->result_data_i_dram_buffer, result_i, false);
-    Finish(cq);
-    double xfer_off_time=getElapsedTime(start_time);
-
-    double total_time=xfer_on_time+exec_time+xfer_off_time;
-    printf("%s FFT of size %d: total time %.6f sec. %.6f sec transfer on, %.6f sec execution, %.6f sec transfer off\n", 
-            direction == 0 ? "Forwards" : "Backwards", domain_size, total_time, xfer_on_time, exec_time, xfer_off_time);
-}
-
-void compare(float * a_data_r, float * a_data_i, float * b_data_r, float * b_data_i, int domain_size) {
-  int matching, missmatching;
-  matching=missmatching=0;
-  for (int i=0; i<domain_size;i++) {
-    float a_r=a_data_r[i];
-    float a_i=a_data_i[i];
-    float b_r=b_data_r[i];
-    float b_i=b_data_i[i];
-
-    if (a_r != b_r || a_i != b_i) {
-      printf("Miss match index %d: (%.2f, %.2f) vs (%.2f, %.2f)\n", i, a_r, a_i, b_r, b_i);
-      missmatching++;
-    } else {
-      matching++;
-    }
-  }
-  printf("Checked %d elements: %d match and %d missmatched\n", domain_size, matching, missmatching);
 }
 
-void moveorigin(float* data_r, float* data_i, int domain_size) {
+void checkAgainstReference(float * data_r, float * data_i, float * reference_r, float * reference_i, int domain_size) {
+  float max_error=0.0f, max_magnitude=0.0f;
   for (int i=0;i<domain_size;i++) {
-    data_r[i]=data_r[i] * pow(-1, i);
-    data_i[i]=data_i[i] * pow(-1, i);
+    float error=fmaxf(fabsf(data_r[i] - reference_r[i]), fabsf(data_i[i] - reference_i[i]));
+    float magnitude=fmaxf(fabsf(reference_r[i]), fabsf(reference_i[i]));
+    if (error > max_error) max_error=error;
+    if (magnitude > max_magnitude) max_magnitude=magnitude;
   }
+  printf("Checked %d elements against reference DFT: maximum error %e, relative to largest magnitude %e\n",
+          domain_size, max_error, max_magnitude > 0.0f ? max_error / max_magnitude : max_error);
 }
 
 void descale(float* data_r, float* data_i, int domain_size) {
@@ -303,6 +517,234 @@ int checkIfPowerOfTwo(int v) {
   return (v != 0) && ((v & (v - 1)) == 0);
 }
 
+/*
+ * Creates the buffers and generic program for transforms of up to device_domain_size points on the device,
+ * released with destroyTTExecution. If twiddle_seed_stride is non-zero then the seed tables are uploaded here
+ */
+TTExecution* createTTExecution(IDevice* device, uint32_t device_domain_size, uint32_t twiddle_seed_stride, bool compact_twiddles, bool convolve,
+                                bool pipeline_stages, bool specialise_kernels, bool local_substages, enum FFTComputeBackend compute_backend) {
+    uint32_t problem_mem_size = 4 * device_domain_size;
+    tt_metal::InterleavedBufferConfig dram_config{
+        .device = device,
+        .size = problem_mem_size,
+        .page_size = problem_mem_size,
+        .buffer_type = tt_metal::BufferType::DRAM};
+
+    std::shared_ptr<tt::tt_metal::Buffer> in_data_r_dram_buffer = CreateBuffer(dram_config);
+    std::shared_ptr<tt::tt_metal::Buffer> in_data_i_dram_buffer = CreateBuffer(dram_config);
+    std::shared_ptr<tt::tt_metal::Buffer> result_data_r_dram_buffer = CreateBuffer(dram_config);
+    std::shared_ptr<tt::tt_metal::Buffer> result_data_i_dram_buffer = CreateBuffer(dram_config);
+
+    // Whilst we have n/2 twiddle factors, pack real and imaginary in so the data size is the same as the domain,
+    // the compact table is only n/8+1 twiddles
+    uint32_t twiddle_mem_size = compact_twiddles ? ((device_domain_size/8)+1) * 8 : problem_mem_size;
+    tt_metal::InterleavedBufferConfig twiddle_dram_config{
+        .device = device,
+        .size = twiddle_mem_size,
+        .page_size = twiddle_mem_size,
+        .buffer_type = tt_metal::BufferType::DRAM};
+    std::shared_ptr<tt::tt_metal::Buffer> twiddle_dram_buffer = CreateBuffer(twiddle_dram_config);
+
+    // The arena of the writer's two staging pages for each of real and imaginary, which the input is also read into
+    uint32_t staging_mem_size = 2 * getStagingPageSize(device_domain_size);
+    tt::tt_metal::InterleavedBufferConfig l1_staging_buffer_config{
+        .device= device,
+        .size = staging_mem_size,
+        .page_size = staging_mem_size,
+        .buffer_type = tt::tt_metal::BufferType::L1};
+
+    std::shared_ptr<tt::tt_metal::Buffer> staging_r_buffer = CreateBuffer(l1_staging_buffer_config);
+    std::shared_ptr<tt::tt_metal::Buffer> staging_i_buffer = CreateBuffer(l1_staging_buffer_config);
+
+    tt::tt_metal::InterleavedBufferConfig l1_twiddle_buffer_config{
+        .device= device,
+        .size = twiddle_mem_size,
+        .page_size = twiddle_mem_size,
+        .buffer_type = tt::tt_metal::BufferType::L1};
+
+    std::shared_ptr<tt::tt_metal::Buffer> twiddle_buffer = CreateBuffer(l1_twiddle_buffer_config);
+
+    /* Circular buffers and kernels, these are generic with the domain size and direction given as runtime arguments */
+    Program * program=new Program(CreateProgram());
+    CoreCoord * core=new CoreCoord({0, 0});
+    KernelHandle * reader_kernel_id=new KernelHandle();
+    KernelHandle * writer_kernel_id=new KernelHandle();
+    KernelHandle * compute_kernel_id=new KernelHandle();
+    uint32_t stage_progress_semaphore=0;
+    createFFTProgram(*program, *core, device_domain_size, convolve, pipeline_stages, compute_backend, staging_r_buffer, staging_i_buffer, {0, 0},
+                        reader_kernel_id, writer_kernel_id, compute_kernel_id, &stage_progress_semaphore);
+
+    TTExecution * exec=new TTExecution{
+        .program=program,
+        .core=core,
+        .read_kernel=reader_kernel_id,
+        .write_kernel=writer_kernel_id,
+        .compute_kernel=compute_kernel_id,
+        .in_data_r_dram_buffer=in_data_r_dram_buffer,
+        .in_data_i_dram_buffer=in_data_i_dram_buffer,
+        .twiddle_dram_buffer=twiddle_dram_buffer,
+        .result_data_r_dram_buffer=result_data_r_dram_buffer,
+        .result_data_i_dram_buffer=result_data_i_dram_buffer,
+        .staging_r_buffer=staging_r_buffer,
+        .staging_i_buffer=staging_i_buffer,
+        .twiddle_buffer=twiddle_buffer,
+        .twiddle_seed_stride=twiddle_seed_stride,
+        .compact_twiddles=compact_twiddles,
+        .pipeline_stages=pipeline_stages,
+        .stage_progress_semaphore=stage_progress_semaphore,
+        .specialise_kernels=specialise_kernels,
+        .local_substages=local_substages,
+        .compute_backend=compute_backend
+    };
+
+    if (convolve) {
+        // The transformed filter stays resident on the device for every block that is convolved
+        exec->filter_r_dram_buffer=CreateBuffer(dram_config);
+        exec->filter_i_dram_buffer=CreateBuffer(dram_config);
+    }
+
+    if (twiddle_seed_stride > 0) {
+        // The seeds only depend on the domain size, so are uploaded once rather than on every FFT
+        float * twiddle_seeds=computeTwiddleSeeds(device_domain_size, twiddle_seed_stride);
+        EnqueueWriteBuffer(device->command_queue(), twiddle_dram_buffer, twiddle_seeds, true);
+        free(twiddle_seeds);
+    }
+    return exec;
+}
+
+// Must be called before the device is closed, as the cached programs are released here
+void destroyTTExecution(TTExecution * exec) {
+    destroyFFTPlans(exec);
+    free(exec->bluestein_filter_r);
+    free(exec->bluestein_filter_i);
+    delete exec->program;
+    delete exec->core;
+    delete exec->read_kernel;
+    delete exec->write_kernel;
+    delete exec->compute_kernel;
+    delete exec;
+}
+
+/*
+ * Creates the circular buffers and kernels of an FFT program for domains of up to domain_size points. The
+ * compile arguments are the domain size and direction, if the domain size is zero then the kernels are
+ * generic and read these from their runtime arguments instead. The compute backend is a define of the
+ * compute kernel, so each backend is a separate kernel binary. The writer's staging CBs are held in the
+ * execution's staging buffers, which are sized for its largest domain, rather than in the program's CB region
+ */
+void createFFTProgram(Program & program, CoreCoord & core, uint32_t domain_size, bool convolve, bool pipeline_stages,
+                        enum FFTComputeBackend compute_backend, std::shared_ptr<Buffer> staging_r_buffer, std::shared_ptr<Buffer> staging_i_buffer,
+                        std::vector<uint32_t> compile_args, KernelHandle * reader_kernel_id, KernelHandle * writer_kernel_id,
+                        KernelHandle * compute_kernel_id, uint32_t * stage_progress_semaphore) {
+    uint32_t num_pages[NUM_CHUNKED_CBS], page_sizes[NUM_CHUNKED_CBS];
+    getChunkedCBLayout(domain_size, convolve, num_pages, page_sizes);
+    for (uint32_t cb=0; cb < NUM_CHUNKED_CBS; cb++) {
+        if (cb == CBIndex::c_10 || cb == CBIndex::c_11 || num_pages[cb] == 0) continue;
+        createCB(program, core, cb, num_pages[cb], page_sizes[cb]);
+    }
+    createArenaCB(program, core, CBIndex::c_10, num_pages[CBIndex::c_10], staging_r_buffer);
+    createArenaCB(program, core, CBIndex::c_11, num_pages[CBIndex::c_11], staging_i_buffer);
+
+    /* Specify data movement kernels for reading/writing data to/from DRAM */
+    *reader_kernel_id = CreateKernel(
+        program,
+        "kernels/dataflow/reader.cpp",
+        core,
+        DataMovementConfig{.processor = DataMovementProcessor::RISCV_1, .noc = NOC::RISCV_1_default, .compile_args = compile_args});
+
+    *writer_kernel_id = CreateKernel(
+        program,
+        "kernels/dataflow/writer.cpp",
+        core,
+        DataMovementConfig{.processor = DataMovementProcessor::RISCV_0, .noc = NOC::RISCV_0_default, .compile_args = compile_args});
+
+    /* Use the add_tiles operation in the compute kernel */
+    *compute_kernel_id = CreateKernel(
+        program,
+        "kernels/compute/compute.cpp",
+        core,
+        ComputeConfig{
+            .math_fidelity = MathFidelity::HiFi4,
+            .fp32_dest_acc_en = false,
+            .math_approx_mode = false,
+            .compile_args = compile_args,
+            .defines = {{"COMPUTE_BACKEND", std::to_string(compute_backend)}},
+        });
+
+    if (pipeline_stages) {
+        // Shared in L1 between the reader and writer, the writer counts the chunks it has scattered
+        *stage_progress_semaphore=CreateSemaphore(program, core, 0);
+    }
+}
+
+/*
+ * The pages and page size of each circular buffer of the chunked program, for domains of up to domain_size points. A
+ * CB with no pages is not created. This is also what the footprint planner sizes L1 from, so is the one place these are set
+ */
+void getChunkedCBLayout(uint32_t domain_size, bool convolve, uint32_t * num_pages, uint32_t * page_sizes) {
+    /* Use L1 circular buffers to set input and output buffers that the compute engine will use */
+    uint32_t cb_tile_size=1024 * 2;
+    uint32_t num_chunks=4;
+    for (uint32_t cb=0; cb < NUM_CHUNKED_CBS; cb++) {
+        num_pages[cb]=0;
+        page_sizes[cb]=cb_tile_size;
+    }
+    // Data 0 into compute
+    num_pages[CBIndex::c_0]=num_pages[CBIndex::c_1]=num_chunks;
+    // Data 1 into compute
+    num_pages[CBIndex::c_2]=num_pages[CBIndex::c_3]=num_chunks;
+    // Twiddle factors
+    num_pages[CBIndex::c_4]=num_pages[CBIndex::c_5]=num_chunks;
+    // Data 0 out from compute
+    num_pages[CBIndex::c_6]=num_pages[CBIndex::c_7]=num_chunks;
+    // Data 1 out from compute
+    num_pages[CBIndex::c_8]=num_pages[CBIndex::c_9]=num_chunks;
+    // Data 0 rearranged from writer
+    // This must be two as when we pipeline the writer is writing the current iteration to
+    // the next CB and reader is reading from the current CB. The same applies to the 
+    // data 1 CB (next one) too
+    num_pages[CBIndex::c_10]=2;
+    page_sizes[CBIndex::c_10]=getStagingPageSize(domain_size);
+    // Data 1 rearranged from writer
+    num_pages[CBIndex::c_11]=2;
+    page_sizes[CBIndex::c_11]=getStagingPageSize(domain_size);
+    // Intermediate results
+    // The CB size is all one below here as these are used internally by the compute core
+    // as intermediate results
+    num_pages[CBIndex::c_12]=num_pages[CBIndex::c_13]=num_pages[CBIndex::c_14]=1;
+    // f0
+    num_pages[CBIndex::c_15]=1;
+    // f1
+    num_pages[CBIndex::c_16]=1;
+    if (convolve) {
+        // Filter spectrum for data 0 and data 1, read alongside the data in the final stage
+        num_pages[CBIndex::c_17]=num_pages[CBIndex::c_18]=num_chunks;
+        num_pages[CBIndex::c_19]=num_pages[CBIndex::c_20]=num_chunks;
+    }
+    // Final stage butterfly results, before they are multiplied by the filter or reduced by a post stage. Whether a
+    // launch has a post stage is only known from its runtime arguments, so these are always present
+    num_pages[CBIndex::c_21]=num_pages[CBIndex::c_22]=1;
+}
+
+// A staging page holds a whole stage of the domain, and is at least a chunk
+uint32_t getStagingPageSize(uint32_t domain_size) {
+    uint32_t cb_tile_size=1024 * 2;
+    return 4 * domain_size > cb_tile_size ? 4 * domain_size : cb_tile_size;
+}
+
+/*
+ * A circular buffer held in an L1 buffer of the execution rather than the program's CB region, whose halves (or
+ * num_pages parts) are the pages. This is how the staging pages share the arena with the input of each frame
+ */
+CBHandle createArenaCB(Program & program, CoreCoord & core, uint32_t cb_index, uint32_t num_pages, std::shared_ptr<Buffer> buffer) {
+    uint32_t page_size=buffer->size() / num_pages;
+    CircularBufferConfig cb_config =
+        CircularBufferConfig(num_pages * page_size, {{cb_index, tt::DataFormat::Float32}})
+            .set_page_size(cb_index, page_size)
+            .set_globally_allocated_address(*buffer);
+    return tt_metal::CreateCircularBuffer(program, core, cb_config);
+}
+
 CBHandle createCB(Program & program, CoreCoord & core, uint32_t cb_index, uint32_t num_tiles, uint32_t tile_size) {
     CircularBufferConfig cb_config = 
         CircularBufferConfig(num_tiles * tile_size, {{cb_index, tt::DataFormat::Float32}})
@@ -324,7 +766,55 @@ float* computeTwiddleFactors(int n) {
    return twiddle_factors;
 }
 
-static double getElapsedTime(struct timeval start_time) {
+/*
+ * Seed tables for generating twiddles on the device, twiddle i*stride+j is coarse[i] * fine[j]. Every
+ * twiddle is a single product of two exactly rounded seeds, so unlike a running recurrence the error
+ * does not grow with the domain size. The fine seeds (stride of them) are stored first, followed by
+ * the (n/2)/stride coarse seeds, with real and imaginary interleaved as for the full table
+ */
+float* computeTwiddleSeeds(int n, int stride) {
+   int num_coarse_seeds=(n/2)/stride;
+   float * twiddle_seeds=(float*) malloc(sizeof(float) * (stride + num_coarse_seeds) * 2);
+
+   for (int i=0;i<stride;i++) {
+     double base_factor=(2.0 * PI * i)/(double) n;
+     twiddle_seeds[i*2]=(float) cos(base_factor);
+     twiddle_seeds[(i*2)+1]=(float) -sin(base_factor);
+   }
+   for (int i=0;i<num_coarse_seeds;i++) {
+     double base_factor=(2.0 * PI * i * stride)/(double) n;
+     twiddle_seeds[(stride+i)*2]=(float) cos(base_factor);
+     twiddle_seeds[((stride+i)*2)+1]=(float) -sin(base_factor);
+   }
+
+   return twiddle_seeds;
+}
+
+/*
+ * The first octant of twiddles, i.e. for indexes 0 to n/8 inclusive. The rest of the n/2 twiddles
+ * are reconstructed from these on the device using the symmetries of sin and cos
+ */
+float* computeCompactTwiddleFactors(int n) {
+   int num_twiddle_factors=(n/8)+1;
+   float * twiddle_factors=(float*) malloc(sizeof(float) * num_twiddle_factors * 2);
+
+   for (int i=0;i<num_twiddle_factors;i++) {
+     double base_factor=(2.0 * PI * i)/(double) n;
+     twiddle_factors[i*2]=(float) cos(base_factor);
+     twiddle_factors[(i*2)+1]=(float) -sin(base_factor);
+   }
+
+   return twiddle_factors;
+}
+
+// The seed stride is the power of two closest to the square root of n/2, which minimises the seed table size
+uint32_t getTwiddleSeedStride(uint32_t n) {
+   uint32_t stride=1;
+   while (stride * stride < n/2) stride <<= 1;
+   return stride;
+}
+
+double getElapsedTime(struct timeval start_time) {
   struct timeval curr_time;
   gettimeofday(&curr_time, NULL);
   long int elapsedtime = (curr_time.tv_sec * 1000000 + curr_time.tv_usec) - (start_time.tv_sec * 1000000 + start_time.tv_usec);
@@ -0,0 +1,431 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include "host_api.hpp"
+#include "device.hpp"
+#include <sys/time.h>
+#include <vector>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+#define PI 3.14159265358979323846264338327950288
+
+// Circular buffer indices c_0 to c_22 of the chunked program
+#define NUM_CHUNKED_CBS 23
+
+// L1 below the allocator's base, held by firmware, mailboxes and kernel binaries. This is approximate, so is rounded up
+#define L1_RESERVED_SIZE (104 * 1024)
+
+// The sub transforms of a mixed radix FFT are one batched launch, so each must keep the 64 byte DRAM read alignment. Sizes
+// with a smaller power of two part are transformed with Bluestein's algorithm instead
+#define MIN_MIXED_RADIX_DEVICE_SIZE 16
+
+enum FFTDirection {
+    FFT_FORWARD=0,
+    FFT_BACKWARD=1
+};
+
+/*
+ * The ways a transform is laid out over the core's kernels, described in strategy.cpp. With auto the strategies
+ * that support a launch are timed against each other on the first transform of each domain size
+ */
+enum FFTStrategy {
+    CHUNKED_STRATEGY=0,
+    WHOLE_DOMAIN_STRATEGY=1,
+    AUTO_STRATEGY=2
+};
+
+// The engine that the compute kernel's element-wise ops run on, the hybrid backend multiplies on the FPU and adds on the SFPU
+enum FFTComputeBackend {
+    FPU_BACKEND=0,
+    SFPU_BACKEND=1,
+    HYBRID_BACKEND=2
+};
+
+// Reductions of each spectrum fused into the final compute stage, after which only the real result is written
+enum FFTPostStage {
+    NO_POST_STAGE=0,
+    // |X|^2
+    POWER_POST_STAGE=1,
+    // 10*log10(|X|^2)
+    DECIBEL_POST_STAGE=2
+};
+
+// The decibel post stage clamps the power to this floor, so a bin with no energy is -200 dB rather than -inf
+#define SPECTRUM_POWER_FLOOR 1e-20f
+
+// Reductions of each frame by the writer to a record of (index, value) peaks, so only the record is downloaded
+enum FFTReduction {
+    NO_REDUCTION=0,
+    // The capacity largest values, with max and argmax being a capacity of one
+    TOP_K_REDUCTION=1,
+    // The points whose value is at least the threshold, the lowest capacity indices of these are held
+    THRESHOLD_REDUCTION=2
+};
+
+// Largest capacity of a reduction record, which is built in one page of the writer's staging buffer
+#define MAX_REDUCTION_CAPACITY 255
+
+// Components of the pipeline that the microbenchmarks time alone, as the COMPONENT values in kernels/constants.h
+enum FFTComponent {
+    BITREVERSE_COMPONENT=0,
+    // The reader's gather of each stage's butterflies into chunks
+    GATHER_COMPONENT=1,
+    // The reader's replication of each spectra's twiddle across its butterflies
+    TWIDDLE_COMPONENT=2,
+    // The compute kernel's butterflies
+    BUTTERFLY_COMPONENT=3,
+    // The writer's scatter of each chunk of results back into the stage
+    SCATTER_COMPONENT=4
+};
+
+// The twiddles that a chunk's butterflies share, as get_chunk_twiddle_kind in kernels/constants.h
+enum EmulatedTwiddleKind {
+    GENERAL_TWIDDLE = 0,
+    UNIT_TWIDDLE = 1,
+    MINUS_J_TWIDDLE = 2,
+};
+
+// DRAM reserved on the device for captured traces when tracing, each launch's commands take a few KB of this
+#define FFT_TRACE_REGION_SIZE (1024 * 1024)
+
+// A program whose kernels are compiled for one domain size and direction, held in the plan cache of the TTExecution
+struct FFTPlan {
+    uint32_t domain_size;
+    enum FFTDirection direction;
+    enum FFTStrategy strategy;
+    enum FFTComputeBackend compute_backend;
+    tt::tt_metal::Program program;
+    tt::tt_metal::KernelHandle read_kernel, write_kernel, compute_kernel;
+    uint32_t stage_progress_semaphore;
+    struct TTExecution * device_descriptor;
+
+    // Transforms through this plan's program, the inputs and results are host arrays of domain_size points
+    void execute(tt::tt_metal::CommandQueue&, float*, float*, float*, float*, float*);
+};
+
+struct TTExecution {
+    tt::tt_metal::Program *program;
+    tt::tt_metal::CoreCoord *core;
+    tt::tt_metal::KernelHandle *read_kernel, *write_kernel, *compute_kernel;
+    std::shared_ptr<tt::tt_metal::Buffer> in_data_r_dram_buffer, in_data_i_dram_buffer, twiddle_dram_buffer, result_data_r_dram_buffer, result_data_i_dram_buffer;
+    // The L1 arena, where the writer's staging pages (c_10 and c_11) are two halves of each of staging_r_buffer and staging_i_buffer.
+    // A frame's input is read into the staging page that the writer does not fill until the input has been gathered
+    std::shared_ptr<tt::tt_metal::Buffer> staging_r_buffer, staging_i_buffer, twiddle_buffer;
+    // If non-zero twiddles are generated on the device from seed tables held in the twiddle DRAM buffer
+    uint32_t twiddle_seed_stride;
+    // Only the first octant (n/8+1) of twiddles are held, the rest are reconstructed by the reader
+    bool compact_twiddles;
+    // Spectrum of the convolution filter, only allocated when convolving
+    std::shared_ptr<tt::tt_metal::Buffer> filter_r_dram_buffer, filter_i_dram_buffer;
+    // Transformed Bluestein chirp filter, computed on first use for the domain size held in bluestein_size
+    float *bluestein_filter_r, *bluestein_filter_i;
+    uint32_t bluestein_size;
+    // The batched mixed radix sub transforms, created on first use for the domain size held in mixed_radix_size
+    std::shared_ptr<tt::tt_metal::Buffer> mixed_radix_r_dram_buffer, mixed_radix_i_dram_buffer, mixed_radix_result_r_dram_buffer,
+                                            mixed_radix_result_i_dram_buffer;
+    uint32_t mixed_radix_size;
+    // The reader gathers each stage as soon as the chunks it depends on are written, tracked in this semaphore
+    bool pipeline_stages;
+    uint32_t stage_progress_semaphore;
+    // If set each domain size and direction runs a program specialised for it, created on first use and cached
+    bool specialise_kernels;
+    std::vector<FFTPlan*> plan_cache;
+    // The reader computes the stages whose sub-FFTs fit within a chunk in L1, rather than passing each round the pipeline. Its
+    // core has no hardware float, so this is off by default and is timed against the pipeline by --benchmark-backends
+    bool local_substages;
+    // Strategy used for the launches that it supports, the others run chunked. The choices made by auto are kept per domain size
+    enum FFTStrategy strategy;
+    std::vector<std::pair<uint32_t, enum FFTStrategy>> strategy_choices;
+    // Compiled into the compute kernels of the generic program and of each plan
+    enum FFTComputeBackend compute_backend;
+};
+
+// Optional batching of transforms in one launch, the frames start frame_stride points apart in the input (so can overlap)
+// and are written contiguously to the output. If the window buffers are set each frame is multiplied by the window on read.
+// If input_length is non-zero then only that many points of each frame are read, with the rest zero padded, and the window
+// covers just these. With a post stage each spectrum is reduced to real values, and the imaginary output is not written.
+// With a reduction each frame is written to the real output as a record (see getReductionRecordSize) rather than a spectrum
+struct FFTBatch {
+    uint32_t num_frames, frame_stride;
+    std::shared_ptr<tt::tt_metal::Buffer> window_dram_buffer, window_buffer;
+    uint32_t input_length;
+    enum FFTPostStage post_stage;
+    enum FFTReduction reduction;
+    uint32_t reduction_capacity;
+    float reduction_threshold;
+};
+
+// A point of a reduced spectrum, the value being the power or the post stage result
+struct FFTPeak {
+    uint32_t index;
+    float value;
+};
+
+// A pipeline strategy, which creates the circular buffers and kernels of its program and sets their runtime arguments for a launch
+struct FFTStrategyDescriptor {
+    const char * name;
+    // Whether the strategy can run a launch of this domain size, with the filter multiply and batch given
+    bool (*supports)(TTExecution*, uint32_t, bool, FFTBatch*);
+    void (*create_program)(tt::tt_metal::Program&, tt::tt_metal::CoreCoord&, uint32_t, bool, bool, enum FFTComputeBackend,
+                            std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>, std::vector<uint32_t>,
+                            tt::tt_metal::KernelHandle*, tt::tt_metal::KernelHandle*, tt::tt_metal::KernelHandle*, uint32_t*);
+    void (*set_runtime_args)(TTExecution*, tt::tt_metal::Program&, tt::tt_metal::KernelHandle, tt::tt_metal::KernelHandle, tt::tt_metal::KernelHandle,
+                                uint32_t, std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>,
+                                std::shared_ptr<tt::tt_metal::Buffer>, uint32_t, enum FFTDirection, bool, FFTBatch*);
+};
+
+/*
+ * The L1 and DRAM that an execution of one configuration takes, from its buffers and the circular buffers of its
+ * program. The buffers are each a single page, so all of an execution's DRAM is held in one bank
+ */
+struct FFTFootprint {
+    uint32_t device_domain_size;
+    bool compact_twiddles;
+    // Set if the planner switched to compact twiddles for the configuration to fit
+    bool downgraded;
+    // The available L1 excludes l1_held_bytes, the buffers of other executions already on the core
+    uint64_t cb_bytes, l1_buffer_bytes, l1_available_bytes, l1_held_bytes;
+    uint64_t dram_bytes, dram_available_bytes;
+};
+
+// Short-time Fourier transform of one signal held on the device, with the windowed frames transformed as a batch
+struct STFTPlan {
+    TTExecution * device_descriptor;
+    uint32_t domain_size, signal_length, num_frames;
+    std::shared_ptr<tt::tt_metal::Buffer> signal_r_dram_buffer, signal_i_dram_buffer, spectra_r_dram_buffer, spectra_i_dram_buffer;
+    FFTBatch batch;
+};
+
+// Windowed and zero padded transform of a signal shorter than the domain, reduced to its power or decibel spectrum on the device
+struct SpectrumPlan {
+    TTExecution * device_descriptor;
+    uint32_t domain_size, signal_length;
+    std::shared_ptr<tt::tt_metal::Buffer> signal_r_dram_buffer, signal_i_dram_buffer, spectrum_dram_buffer;
+    FFTBatch batch;
+};
+
+// Frames held contiguously on the device, each transformed and reduced to its peaks with only the records downloaded
+struct ReductionPlan {
+    TTExecution * device_descriptor;
+    uint32_t domain_size, num_frames;
+    std::shared_ptr<tt::tt_metal::Buffer> signal_r_dram_buffer, signal_i_dram_buffer, records_dram_buffer;
+    FFTBatch batch;
+};
+
+/*
+ * Commands of one transform from the execution's input buffers to its result buffers, captured once and replayed without
+ * being dispatched again. If emulated there is no device and each replay runs emulateFFT with the table in twiddle_data
+ */
+struct FFTTrace {
+    tt::tt_metal::IDevice * device;
+    tt::tt_metal::CommandQueue * cq;
+    TTExecution * device_descriptor;
+    uint32_t domain_size;
+    enum FFTDirection direction;
+    uint32_t trace_id;
+    bool emulated;
+    float * twiddle_data;
+    uint32_t twiddle_seed_stride;
+    bool compact_twiddles, local_substages;
+};
+
+// Complex data held in DRAM between operations, so transforms can be chained without moving it to the host
+struct DeviceTensor {
+    uint32_t domain_size;
+    std::shared_ptr<tt::tt_metal::Buffer> r_dram_buffer, i_dram_buffer;
+};
+
+// Devices that a distributed FFT is spread over, each holding a slab of the domain as rows that it transforms. If
+// simulated then no devices are opened and the rows are transformed on the host
+struct DistributedBackend {
+    uint32_t num_devices, max_row_length;
+    bool simulated;
+    std::vector<tt::tt_metal::IDevice*> devices;
+    std::vector<TTExecution*> device_descriptors;
+};
+
+// A transform submitted to a scheduler, the caller's arrays of domain_size points must stay valid until done is made ready
+struct FFTRequest {
+    uint32_t domain_size;
+    enum FFTDirection direction;
+    float *input_r, *input_i, *result_r, *result_i;
+    std::chrono::steady_clock::time_point submit_time;
+    std::promise<void> done;
+};
+
+// The pending requests of one plan, a domain size and direction, which are launched together as a batch
+struct FFTRequestGroup {
+    uint32_t domain_size;
+    enum FFTDirection direction;
+    std::deque<FFTRequest*> requests;
+};
+
+/*
+ * A device that the scheduler launches batches on from its own thread, which is the only user of its command queue. The
+ * frames are staged in DRAM buffers sized for the largest batch of the largest domain, allocated once, and each launch
+ * moves just its own frames. If the scheduler is mocked there is no device and each batch is run on the host through
+ * emulateFFT, with the twiddles of the last size
+ */
+struct FFTSchedulerLane {
+    tt::tt_metal::IDevice * device;
+    TTExecution * device_descriptor;
+    std::thread worker;
+    uint32_t twiddle_domain_size;
+    std::shared_ptr<tt::tt_metal::Buffer> batch_r_dram_buffer, batch_i_dram_buffer, batch_result_r_dram_buffer, batch_result_i_dram_buffer;
+    float *batch_r, *batch_i, *twiddle_factors;
+};
+
+/*
+ * Coalesces the transforms submitted by many threads into batched launches. A plan's requests are launched once
+ * max_batch_frames are pending, or once the oldest has waited deadline seconds, by whichever lane is free first
+ */
+struct FFTScheduler {
+    uint32_t max_domain_size, max_batch_frames;
+    double deadline;
+    bool mocked;
+    std::vector<FFTSchedulerLane*> lanes;
+    std::mutex lock;
+    std::condition_variable pending_changed;
+    std::vector<FFTRequestGroup*> groups;
+    bool stopping;
+    uint64_t num_launches, num_frames;
+};
+
+// fft.cpp
+void fft(tt::tt_metal::CommandQueue&, TTExecution*, float*, float*, float*, float*, float*, uint32_t, enum FFTDirection);
+void enqueueFFT(tt::tt_metal::CommandQueue&, TTExecution*, std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>,
+                    std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>, uint32_t, enum FFTDirection, bool, FFTBatch*);
+void enqueuePlannedFFT(tt::tt_metal::CommandQueue&, TTExecution*, FFTPlan*, std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>,
+                        std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>, uint32_t, enum FFTDirection, bool, FFTBatch*);
+void descale(float*, float*, int);
+void checkAgainstReference(float*, float*, float*, float*, int);
+double getElapsedTime(struct timeval);
+int checkIfPowerOfTwo(int);
+TTExecution* createTTExecution(tt::tt_metal::IDevice*, uint32_t, uint32_t, bool, bool, bool, bool, bool, enum FFTComputeBackend);
+void destroyTTExecution(TTExecution*);
+float* computeTwiddleFactors(int);
+float* computeTwiddleSeeds(int, int);
+float* computeCompactTwiddleFactors(int);
+uint32_t getTwiddleSeedStride(uint32_t);
+void createFFTProgram(tt::tt_metal::Program&, tt::tt_metal::CoreCoord&, uint32_t, bool, bool, enum FFTComputeBackend,
+                        std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>, std::vector<uint32_t>,
+                        tt::tt_metal::KernelHandle*, tt::tt_metal::KernelHandle*, tt::tt_metal::KernelHandle*, uint32_t*);
+void getChunkedCBLayout(uint32_t, bool, uint32_t*, uint32_t*);
+void setChunkedRuntimeArgs(TTExecution*, tt::tt_metal::Program&, tt::tt_metal::KernelHandle, tt::tt_metal::KernelHandle, tt::tt_metal::KernelHandle,
+                            uint32_t, std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>,
+                            std::shared_ptr<tt::tt_metal::Buffer>, uint32_t, enum FFTDirection, bool, FFTBatch*);
+tt::tt_metal::CBHandle createCB(tt::tt_metal::Program&, tt::tt_metal::CoreCoord&, uint32_t, uint32_t, uint32_t);
+tt::tt_metal::CBHandle createArenaCB(tt::tt_metal::Program&, tt::tt_metal::CoreCoord&, uint32_t, uint32_t, std::shared_ptr<tt::tt_metal::Buffer>);
+uint32_t getStagingPageSize(uint32_t);
+
+// footprint.cpp
+void getFFTFootprint(FFTFootprint*, tt::tt_metal::IDevice*, uint32_t, bool, bool, uint32_t, uint64_t);
+bool planFFTFootprint(FFTFootprint*, tt::tt_metal::IDevice*, uint32_t, bool*, bool, bool, uint32_t, uint64_t);
+bool fitsFFTFootprint(FFTFootprint*);
+void printFFTFootprint(FFTFootprint*);
+
+// plan.cpp
+FFTPlan* getFFTPlan(TTExecution*, uint32_t, enum FFTDirection, enum FFTStrategy, enum FFTComputeBackend);
+void destroyFFTPlans(TTExecution*);
+
+// strategy.cpp
+const FFTStrategyDescriptor* getFFTStrategy(enum FFTStrategy);
+int parseFFTStrategy(const char*);
+enum FFTStrategy selectFFTStrategy(tt::tt_metal::CommandQueue&, TTExecution*, std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>,
+                                    std::shared_ptr<tt::tt_metal::Buffer>, std::shared_ptr<tt::tt_metal::Buffer>, uint32_t, enum FFTDirection, bool, FFTBatch*);
+FFTPlan* getStrategyPlan(TTExecution*, uint32_t, enum FFTDirection, enum FFTStrategy);
+
+// benchmark.cpp
+const char* getComputeBackendName(enum FFTComputeBackend);
+int parseComputeBackend(const char*);
+void runBackendBenchmark(tt::tt_metal::IDevice*, tt::tt_metal::CommandQueue&, uint32_t);
+
+// host_buffers.cpp
+float* allocateHostBuffer(size_t);
+void releaseHostBuffer(float*);
+void freeHostBuffers();
+
+// emulator.cpp
+void emulateFFT(float*, float*, float*, float*, float*, uint32_t, enum FFTDirection, uint32_t, bool, bool);
+void emulateBitreverse(float*, uint32_t);
+enum EmulatedTwiddleKind emulateChunkTwiddleKind(uint32_t, uint32_t, uint32_t, uint32_t);
+
+// accuracy.cpp
+int runAccuracySuite(uint32_t);
+void referenceFFTDouble(double*, double*, uint32_t);
+
+// tensor.cpp
+DeviceTensor* createDeviceTensor(tt::tt_metal::IDevice*, uint32_t);
+void destroyDeviceTensor(DeviceTensor*);
+void uploadDeviceTensor(tt::tt_metal::CommandQueue&, DeviceTensor*, float*, float*);
+void downloadDeviceTensor(tt::tt_metal::CommandQueue&, DeviceTensor*, float*, float*);
+void uploadTwiddleFactors(tt::tt_metal::CommandQueue&, TTExecution*, float*);
+void fftDeviceTensor(tt::tt_metal::CommandQueue&, TTExecution*, DeviceTensor*, DeviceTensor*, enum FFTDirection, bool);
+void fftRoundTrip(tt::tt_metal::IDevice*, tt::tt_metal::CommandQueue&, TTExecution*, float*, float*, float*, uint32_t);
+
+// mixed_radix.cpp
+uint32_t getDeviceDomainSize(uint32_t);
+void fftAnySize(tt::tt_metal::CommandQueue&, TTExecution*, float*, float*, float*, float*, float*, uint32_t, uint32_t, enum FFTDirection);
+void referenceDFT(float*, float*, float*, float*, uint32_t);
+
+// convolution.cpp
+void createConvolutionFilter(tt::tt_metal::CommandQueue&, TTExecution*, float*, float*, float*, uint32_t, uint32_t, bool);
+void convolve(tt::tt_metal::CommandQueue&, TTExecution*, float*, float*, float*, float*, uint32_t, uint32_t, uint32_t);
+void referenceConvolution(float*, float*, float*, float*, float*, float*, uint32_t, uint32_t);
+void runConvolution(tt::tt_metal::CommandQueue&, TTExecution*, float*, uint32_t, uint32_t, bool);
+
+// stft.cpp
+STFTPlan* createSTFTPlan(tt::tt_metal::IDevice*, tt::tt_metal::CommandQueue&, TTExecution*, float*, uint32_t, uint32_t, uint32_t);
+void stft(tt::tt_metal::CommandQueue&, STFTPlan*, float*, float*, float*, float*, float*);
+void destroySTFTPlan(STFTPlan*);
+float* computeHannWindow(uint32_t);
+float* computeBlackmanWindow(uint32_t);
+void runSTFT(tt::tt_metal::IDevice*, tt::tt_metal::CommandQueue&, TTExecution*, float*, uint32_t, uint32_t);
+
+// spectrum.cpp
+SpectrumPlan* createSpectrumPlan(tt::tt_metal::IDevice*, tt::tt_metal::CommandQueue&, TTExecution*, float*, uint32_t, uint32_t, enum FFTPostStage);
+void spectrum(tt::tt_metal::CommandQueue&, SpectrumPlan*, float*, float*, float*, float*);
+void destroySpectrumPlan(SpectrumPlan*);
+int parsePostStage(const char*);
+void referenceSpectrum(float*, float*, float*, float*, uint32_t, uint32_t, enum FFTPostStage);
+void runSpectrum(tt::tt_metal::IDevice*, tt::tt_metal::CommandQueue&, TTExecution*, float*, uint32_t, uint32_t, enum FFTPostStage);
+
+// reduction.cpp
+uint32_t getReductionRecordSize(uint32_t);
+ReductionPlan* createReductionPlan(tt::tt_metal::IDevice*, TTExecution*, uint32_t, uint32_t, enum FFTPostStage, enum FFTReduction, uint32_t, float);
+void reducedFFT(tt::tt_metal::CommandQueue&, ReductionPlan*, float*, float*, float*, FFTPeak*, uint32_t*);
+void destroyReductionPlan(ReductionPlan*);
+uint32_t referenceReduction(float*, float*, uint32_t, enum FFTReduction, uint32_t, float, FFTPeak*);
+void runReduction(tt::tt_metal::IDevice*, tt::tt_metal::CommandQueue&, TTExecution*, float*, uint32_t, enum FFTPostStage, enum FFTReduction, uint32_t, float);
+
+// microbenchmark.cpp
+int parseFFTComponent(const char*);
+void runMicrobenchmarks(tt::tt_metal::IDevice*, tt::tt_metal::CommandQueue*, int, uint32_t, uint32_t, enum FFTComputeBackend);
+
+// trace.cpp
+FFTTrace* createFFTTrace(tt::tt_metal::IDevice*, tt::tt_metal::CommandQueue&, TTExecution*, float*, uint32_t, enum FFTDirection);
+FFTTrace* createEmulatedFFTTrace(float*, uint32_t, enum FFTDirection, uint32_t, bool, bool);
+void replayFFTTrace(FFTTrace*, float*, float*, float*, float*);
+void destroyFFTTrace(FFTTrace*);
+void runTrace(tt::tt_metal::IDevice*, tt::tt_metal::CommandQueue*, TTExecution*, float*, uint32_t, uint32_t, bool, bool, uint32_t);
+
+// scheduler.cpp
+FFTScheduler* createFFTScheduler(uint32_t, uint32_t, uint32_t, double, bool);
+std::future<void> submitFFT(FFTScheduler*, float*, float*, float*, float*, uint32_t, enum FFTDirection);
+void destroyFFTScheduler(FFTScheduler*);
+void runSchedulerLoad(uint32_t, uint32_t, uint32_t, bool);
+
+// distributed.cpp
+DistributedBackend* createDistributedBackend(uint32_t, uint32_t, bool);
+void destroyDistributedBackend(DistributedBackend*);
+uint32_t getDistributedSplit(uint32_t);
+void distributedFFT(DistributedBackend*, float*, float*, float*, float*, uint32_t, uint32_t);
+void distributedFFT2D(DistributedBackend*, float*, float*, float*, float*, uint32_t, uint32_t);
+void runDistributedFFT(uint32_t, bool, uint32_t);
+
+#endif
@@ -0,0 +1,88 @@
+#include "fft.h"
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+// Wormhole sizes used when there is no device to ask, as for a dry run
+#define DEFAULT_L1_SIZE (1464 * 1024)
+#define DEFAULT_DRAM_BANK_SIZE (1024ull * 1024 * 1024)
+// Allocations are rounded up to these
+#define L1_ALIGNMENT 16
+#define DRAM_ALIGNMENT 32
+
+static uint64_t alignTo(uint64_t, uint64_t);
+
+/*
+ * The footprint of an execution with the generic chunked program, as created by createTTExecution, plus a window of
+ * window_length points held in L1 by an STFT or spectrum plan. Plans hold the same circular buffers as the generic
+ * program, and only one program's are allocated at a time, while the whole domain program's seventeen one tile CBs are
+ * always below the chunked program's. Buffers stay allocated though, so l1_held_bytes of other executions' L1 buffers
+ * on the same core are not available to this one. If device is NULL then the sizes are those of a Wormhole core
+ */
+void getFFTFootprint(FFTFootprint * footprint, IDevice* device, uint32_t device_domain_size, bool compact_twiddles, bool convolve,
+                        uint32_t window_length, uint64_t l1_held_bytes) {
+    uint64_t problem_mem_size=4 * (uint64_t) device_domain_size;
+    // The seed tables of generated twiddles are staged in the arena, the full table is still held in L1
+    uint64_t twiddle_mem_size=compact_twiddles ? ((device_domain_size/8)+1) * 8 : problem_mem_size;
+
+    footprint->device_domain_size=device_domain_size;
+    footprint->compact_twiddles=compact_twiddles;
+    footprint->downgraded=false;
+
+    uint32_t num_pages[NUM_CHUNKED_CBS], page_sizes[NUM_CHUNKED_CBS];
+    getChunkedCBLayout(device_domain_size, convolve, num_pages, page_sizes);
+    footprint->cb_bytes=0;
+    for (uint32_t cb=0;cb<NUM_CHUNKED_CBS;cb++) {
+        if (cb != CBIndex::c_10 && cb != CBIndex::c_11) footprint->cb_bytes+=(uint64_t) num_pages[cb] * page_sizes[cb];
+    }
+
+    // The staging arena, whose pages also hold the input of each frame, then the twiddles and window
+    footprint->l1_buffer_bytes=(2 * alignTo(2 * (uint64_t) getStagingPageSize(device_domain_size), L1_ALIGNMENT)) + alignTo(twiddle_mem_size, L1_ALIGNMENT);
+    if (window_length > 0) footprint->l1_buffer_bytes+=alignTo(4 * (uint64_t) window_length, L1_ALIGNMENT);
+    uint64_t l1_unreserved_bytes=(device != NULL ? device->l1_size_per_core() : DEFAULT_L1_SIZE) - L1_RESERVED_SIZE;
+    footprint->l1_held_bytes=l1_held_bytes;
+    footprint->l1_available_bytes=l1_held_bytes < l1_unreserved_bytes ? l1_unreserved_bytes - l1_held_bytes : 0;
+
+    // Input and result real and imaginary, the twiddles, then the filter spectrum of a convolution
+    footprint->dram_bytes=(4 * alignTo(problem_mem_size, DRAM_ALIGNMENT)) + alignTo(twiddle_mem_size, DRAM_ALIGNMENT);
+    if (convolve) footprint->dram_bytes+=2 * alignTo(problem_mem_size, DRAM_ALIGNMENT);
+    footprint->dram_available_bytes=device != NULL ? device->dram_size_per_channel() : DEFAULT_DRAM_BANK_SIZE;
+}
+
+/*
+ * Sizes the configuration, switching to compact twiddles if it does not otherwise fit in L1 and the twiddles are
+ * neither generated nor already compact. Returns whether the configuration, as downgraded, fits
+ */
+bool planFFTFootprint(FFTFootprint * footprint, IDevice* device, uint32_t device_domain_size, bool * compact_twiddles, bool generate_twiddles,
+                        bool convolve, uint32_t window_length, uint64_t l1_held_bytes) {
+    getFFTFootprint(footprint, device, device_domain_size, *compact_twiddles, convolve, window_length, l1_held_bytes);
+    if (fitsFFTFootprint(footprint) || *compact_twiddles || generate_twiddles || device_domain_size < 8) return fitsFFTFootprint(footprint);
+
+    FFTFootprint compact_footprint;
+    getFFTFootprint(&compact_footprint, device, device_domain_size, true, convolve, window_length, l1_held_bytes);
+    if (!fitsFFTFootprint(&compact_footprint)) return false;
+    *footprint=compact_footprint;
+    footprint->downgraded=true;
+    *compact_twiddles=true;
+    return true;
+}
+
+bool fitsFFTFootprint(FFTFootprint * footprint) {
+    return footprint->cb_bytes + footprint->l1_buffer_bytes <= footprint->l1_available_bytes &&
+            footprint->dram_bytes <= footprint->dram_available_bytes;
+}
+
+void printFFTFootprint(FFTFootprint * footprint) {
+    uint64_t l1_bytes=footprint->cb_bytes + footprint->l1_buffer_bytes;
+    printf("Footprint of domain size %d with %s twiddles%s:\n", footprint->device_domain_size, footprint->compact_twiddles ? "compact" : "full",
+            footprint->downgraded ? " (downgraded to fit)" : "");
+    printf("  L1:   %10lu bytes (%lu circular buffers, %lu buffers) of %lu available, %s\n", l1_bytes, footprint->cb_bytes,
+            footprint->l1_buffer_bytes, footprint->l1_available_bytes, l1_bytes <= footprint->l1_available_bytes ? "fits" : "does not fit");
+    if (footprint->l1_held_bytes > 0) printf("        %10lu bytes of L1 already held by other executions on the core\n", footprint->l1_held_bytes);
+    printf("  DRAM: %10lu bytes in one bank of %lu, %s\n", footprint->dram_bytes, footprint->dram_available_bytes,
+            footprint->dram_bytes <= footprint->dram_available_bytes ? "fits" : "does not fit");
+}
+
+static uint64_t alignTo(uint64_t size, uint64_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
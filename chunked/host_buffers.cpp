@@ -0,0 +1,49 @@
+#include "fft.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Released buffers stay allocated and locked, and are handed out again by later allocations
+struct HostBuffer {
+    float * data;
+    size_t size;
+    bool in_use, locked;
+};
+
+static std::vector<HostBuffer> host_buffers;
+
+/*
+ * Returns a buffer of at least num_points floats that is page aligned and locked in memory, so the runtime
+ * copies to and from it without page faults. Locking is best effort as it is limited by RLIMIT_MEMLOCK, the
+ * buffer is still usable if this fails
+ */
+float* allocateHostBuffer(size_t num_points) {
+    size_t page_size=sysconf(_SC_PAGESIZE);
+    size_t size=(((num_points * sizeof(float)) + page_size - 1) / page_size) * page_size;
+    for (HostBuffer & buffer : host_buffers) {
+        if (!buffer.in_use && buffer.size >= size) {
+            buffer.in_use=true;
+            return buffer.data;
+        }
+    }
+
+    void * data=NULL;
+    if (posix_memalign(&data, page_size, size) != 0) return NULL;
+    bool locked=mlock(data, size) == 0;
+    host_buffers.push_back({(float*) data, size, true, locked});
+    return (float*) data;
+}
+
+// The buffer can then be returned by a later allocation
+void releaseHostBuffer(float * data) {
+    for (HostBuffer & buffer : host_buffers) {
+        if (buffer.data == data) buffer.in_use=false;
+    }
+}
+
+void freeHostBuffers() {
+    for (HostBuffer & buffer : host_buffers) {
+        if (buffer.locked) munlock(buffer.data, buffer.size);
+        free(buffer.data);
+    }
+    host_buffers.clear();
+}
@@ -6,11 +6,12 @@
 #include "compute_kernel_api/eltwise_unary/sfpu_split_includes.h"
 #include "compute_kernel_api/eltwise_unary/eltwise_unary.h"
 #include "compute_kernel_api/eltwise_unary/negative.h"
+#include "compute_kernel_api/eltwise_unary/binop_with_scalar.h"
+#include "compute_kernel_api/eltwise_unary/relu.h"
+#include "compute_kernel_api.h"
 #include "debug/dprint.h"
 #include "../constants.h"
 
-//#define USE_SFPU 1
-
 namespace NAMESPACE {
 
 enum {
@@ -19,8 +20,17 @@ enum {
     MUL = 2,
     DIV = 3,
     NEG = 4,
+    DECIBEL = 5,
 };
 
+// 10/ln(10) as IEEE 754 bits, converting the natural log of a power to decibels
+#define DECIBELS_PER_NEPER_BITS 0x408af967
+// SPECTRUM_POWER_FLOOR as IEEE 754 bits, the power is clamped to this so that empty bins are finite
+#define SPECTRUM_POWER_FLOOR_BITS 0x1e3ce508
+
+void complex_multiply(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+void reduce_spectrum(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+void trivial_butterflies(uint32_t, bool, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
 void do_copy_tile(uint32_t, uint32_t);
 void copy_tiles(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
 int getLog(int);
@@ -34,6 +44,14 @@ void unary_sfpu_op(uint32_t cb_in, uint32_t cb_tgt) {
     if (OPERATION == NEG) {
         negative_tile_init();
         negative_tile(0);
+    } else if (OPERATION == DECIBEL) {
+        // relu(max(x, floor)), which is max(x, floor) as the power is never negative
+        relu_min_tile_init();
+        relu_min_tile(0, SPECTRUM_POWER_FLOOR_BITS);
+        log_tile_init();
+        log_tile(0);
+        binop_with_scalar_tile_init();
+        mul_unary_tile(0, DECIBELS_PER_NEPER_BITS);
     }
     tile_regs_commit();
     if constexpr(CB_OP_IN) cb_pop_front(cb_in, 1);
@@ -103,10 +121,66 @@ void maths_mm_op(uint32_t cb_in_1, uint32_t cb_in_2, uint32_t cb_tgt) {
     cb_push_back(cb_tgt, 1);
 }
 
+// The engine that the element-wise ops run on is chosen by the COMPUTE_BACKEND define, with the hybrid backend
+// putting the multiplies on the FPU and the additions and subtractions on the SFPU
+template <int OPERATION, bool CB_OP_IN1=false, bool CB_OP_IN2=false>
+inline void maths_op(uint32_t cb_in_1, uint32_t cb_in_2, uint32_t cb_tgt) {
+#if COMPUTE_BACKEND == BACKEND_SFPU
+    maths_sfpu_op<OPERATION, CB_OP_IN1, CB_OP_IN2>(cb_in_1, cb_in_2, cb_tgt);
+#elif COMPUTE_BACKEND == BACKEND_HYBRID
+    if constexpr(OPERATION == MUL) {
+        maths_mm_op<OPERATION, CB_OP_IN1, CB_OP_IN2>(cb_in_1, cb_in_2, cb_tgt);
+    } else {
+        maths_sfpu_op<OPERATION, CB_OP_IN1, CB_OP_IN2>(cb_in_1, cb_in_2, cb_tgt);
+    }
+#else
+    maths_mm_op<OPERATION, CB_OP_IN1, CB_OP_IN2>(cb_in_1, cb_in_2, cb_tgt);
+#endif
+}
+
+/*
+ * Butterflies of a chunk whose twiddles are all the unit twiddle or all -j (see get_twiddle_kind), which need
+ * just an addition or subtraction per output rather than the complex multiply. The inputs are not consumed.
+ * If negate_imaginary is set the imaginary inputs are conjugated first, which is folded into the operand order
+ * as -d0_i - -d1_i is d1_i - d0_i, with only -d0_i + -d1_i needing a negation
+ */
+void trivial_butterflies(uint32_t twiddle_kind, bool negate_imaginary, uint32_t cb_data0_r, uint32_t cb_data0_i, uint32_t cb_data1_r,
+                            uint32_t cb_data1_i, uint32_t cb_data0_result_r, uint32_t cb_data0_result_i, uint32_t cb_data1_result_r,
+                            uint32_t cb_data1_result_i, uint32_t cb_intermediate) {
+    if (twiddle_kind == UNIT_TWIDDLE) {
+        maths_op<SUB>(cb_data0_r, cb_data1_r, cb_data1_result_r);
+        if (negate_imaginary) {
+            maths_op<SUB>(cb_data1_i, cb_data0_i, cb_data1_result_i);
+        } else {
+            maths_op<SUB>(cb_data0_i, cb_data1_i, cb_data1_result_i);
+        }
+        maths_op<ADD>(cb_data0_r, cb_data1_r, cb_data0_result_r);
+        if (negate_imaginary) {
+            maths_op<ADD>(cb_data0_i, cb_data1_i, cb_intermediate);
+            unary_sfpu_op<NEG,true>(cb_intermediate, cb_data0_result_i);
+        } else {
+            maths_op<ADD>(cb_data0_i, cb_data1_i, cb_data0_result_i);
+        }
+    } else {
+        // Multiplying by -j gives f0=d1_i and f1=-d1_r, this is never the first step so there is no conjugation
+        maths_op<SUB>(cb_data0_r, cb_data1_i, cb_data1_result_r);
+        maths_op<ADD>(cb_data0_i, cb_data1_r, cb_data1_result_i);
+        maths_op<ADD>(cb_data0_r, cb_data1_i, cb_data0_result_r);
+        maths_op<SUB>(cb_data0_i, cb_data1_r, cb_data0_result_i);
+    }
+}
+
 void MAIN {
     // Direction is 0 for forward FFT and 1 for backward FFT
-    uint32_t direction = get_arg_val<uint32_t>(0);
-    uint32_t domain_size = get_arg_val<uint32_t>(1);
+    uint32_t direction = compile_time_domain_size > 0 ? compile_time_direction : get_arg_val<uint32_t>(0);
+    uint32_t domain_size = compile_time_domain_size > 0 ? compile_time_domain_size : get_arg_val<uint32_t>(1);
+    // If set the final stage results are multiplied by the filter spectrum, used for convolution
+    uint32_t pointwise_multiply = get_arg_val<uint32_t>(2);
+    uint32_t num_frames = get_arg_val<uint32_t>(3);
+    // If set then the reader has computed the first stages locally, including the conjugation of a backwards transform
+    uint32_t local_substages = get_arg_val<uint32_t>(4);
+    // If set then each point of the final stage is reduced to its power or decibels, and only the real CBs are passed on
+    uint32_t post_stage = get_arg_val<uint32_t>(5);
 
     uint32_t number_chunks = (domain_size/2) / CHUNK_SIZE;
     if (number_chunks * CHUNK_SIZE < (domain_size/2)) number_chunks++;
@@ -127,6 +201,12 @@ void MAIN {
     constexpr auto cb_intermediate2 = tt::CBIndex::c_14;
     constexpr auto cb_f0 = tt::CBIndex::c_15;
     constexpr auto cb_f1 = tt::CBIndex::c_16;
+    constexpr auto cb_filter0_r = tt::CBIndex::c_17;
+    constexpr auto cb_filter0_i = tt::CBIndex::c_18;
+    constexpr auto cb_filter1_r = tt::CBIndex::c_19;
+    constexpr auto cb_filter1_i = tt::CBIndex::c_20;
+    constexpr auto cb_butterfly_r = tt::CBIndex::c_21;
+    constexpr auto cb_butterfly_i = tt::CBIndex::c_22;
 
     unary_op_init_common(cb_data1_r, cb_out_data1_r);    
     binary_op_init_common(cb_data1_r, cb_data1_i, cb_intermediate0);
@@ -134,99 +214,152 @@ void MAIN {
     copy_tile_to_dst_init_short(cb_data1_r);
 
     uint32_t num_steps=(uint32_t) getLog(domain_size);
-    for (uint32_t step=0; step <= num_steps; step++) {
-        // If this is a backwards FFT then we need to invert imaginary data on the 
-        // first step and use this as input
-        bool requires_imaginary_neg=(direction == 1 && step == 0);
-
-        for (uint32_t i=0;i<number_chunks;i++) {
-
-            cb_wait_front(cb_data1_r, 1);
-            cb_wait_front(cb_data1_i, 1);
-
-            cb_wait_front(cb_twiddle_r, 1);
-            cb_wait_front(cb_twiddle_i, 1);
-
-
-            if (requires_imaginary_neg) {
-                unary_sfpu_op<NEG>(cb_data1_i, cb_intermediate2);
-                cb_wait_front(cb_intermediate2, 1);
-            }
-
-            // Calculate f0
-#ifdef USE_SFPU
-            maths_sfpu_op<MUL>(cb_data1_r, cb_twiddle_r, cb_intermediate0);
-            maths_sfpu_op<MUL>(requires_imaginary_neg ? cb_intermediate2 : cb_data1_i, cb_twiddle_i, cb_intermediate1);
-            maths_sfpu_op<SUB,true,true>(cb_intermediate0, cb_intermediate1, cb_f0);
-#else
-            maths_mm_op<MUL>(cb_data1_r, cb_twiddle_r, cb_intermediate0);
-            maths_mm_op<MUL>(requires_imaginary_neg ? cb_intermediate2 : cb_data1_i, cb_twiddle_i, cb_intermediate1);
-            maths_mm_op<SUB,true,true>(cb_intermediate0, cb_intermediate1, cb_f0);
-#endif
-
-            // Calculate f1      
-#ifdef USE_SFPU
-            maths_sfpu_op<MUL>(cb_data1_r, cb_twiddle_i, cb_intermediate0);
-            maths_sfpu_op<MUL>(requires_imaginary_neg ? cb_intermediate2 : cb_data1_i, cb_twiddle_r, cb_intermediate1);
-            maths_sfpu_op<ADD,true,true>(cb_intermediate0, cb_intermediate1, cb_f1);
-#else
-            maths_mm_op<MUL>(cb_data1_r, cb_twiddle_i, cb_intermediate0);
-            maths_mm_op<MUL>(requires_imaginary_neg ? cb_intermediate2 : cb_data1_i, cb_twiddle_r, cb_intermediate1);
-            maths_mm_op<ADD,true,true>(cb_intermediate0, cb_intermediate1, cb_f1);
-#endif
-
-            cb_pop_front(cb_twiddle_r, 1);
-            cb_pop_front(cb_twiddle_i, 1);
-
-            // Wait on data for data 0 CBs to be available as we are about to use these
-            cb_wait_front(cb_data0_r, 1);
-            cb_wait_front(cb_data0_i, 1);
-
-            if (requires_imaginary_neg) {
-                // Now invert the data 0 imaginary numbers if this is required
-                cb_pop_front(cb_intermediate2, 1);            
-                unary_sfpu_op<NEG>(cb_data0_i, cb_intermediate2);
-                cb_wait_front(cb_intermediate2, 1);
+    uint32_t first_step=get_first_pipelined_step(local_substages, num_steps);
+    for (uint32_t frame=0; frame < num_frames; frame++) {
+        for (uint32_t step=first_step; step <= num_steps; step++) {
+            // If this is a backwards FFT then we need to invert imaginary data on the 
+            // first step and use this as input
+            bool requires_imaginary_neg=(direction == 1 && step == 0);
+            // When multiplying by the filter the butterfly results go via intermediate CBs rather than straight to the writer
+            bool multiply_filter=(pointwise_multiply == 1 && step == num_steps);
+            // As do the results that a post stage reduces
+            bool reduce_results=(post_stage != NO_POST_STAGE && step == num_steps);
+            bool fused_results=multiply_filter || reduce_results;
+            uint32_t cb_data1_result_r=fused_results ? (uint32_t) cb_butterfly_r : (uint32_t) cb_out_data1_r;
+            uint32_t cb_data1_result_i=fused_results ? (uint32_t) cb_butterfly_i : (uint32_t) cb_out_data1_i;
+            uint32_t cb_data0_result_r=fused_results ? (uint32_t) cb_butterfly_r : (uint32_t) cb_out_data0_r;
+            uint32_t cb_data0_result_i=fused_results ? (uint32_t) cb_butterfly_i : (uint32_t) cb_out_data0_i;
+
+            for (uint32_t i=0;i<number_chunks;i++) {
+
+                cb_wait_front(cb_data1_r, 1);
+                cb_wait_front(cb_data1_i, 1);
+
+                cb_wait_front(cb_twiddle_r, 1);
+                cb_wait_front(cb_twiddle_i, 1);
+
+                // The filter multiply and post stage are fused into the general butterfly, which consumes each result before
+                // the next is produced, the final step needs this anyway beyond two points
+                uint32_t twiddle_kind=fused_results ? GENERAL_TWIDDLE : get_chunk_twiddle_kind(step, i, domain_size, num_steps);
+                if (twiddle_kind != GENERAL_TWIDDLE) {
+                    // The twiddles of the chunk are known, so are consumed without being read
+                    cb_wait_front(cb_data0_r, 1);
+                    cb_wait_front(cb_data0_i, 1);
+                    trivial_butterflies(twiddle_kind, requires_imaginary_neg, cb_data0_r, cb_data0_i, cb_data1_r, cb_data1_i, cb_data0_result_r,
+                                        cb_data0_result_i, cb_data1_result_r, cb_data1_result_i, cb_intermediate0);
+                    cb_pop_front(cb_twiddle_r, 1);
+                    cb_pop_front(cb_twiddle_i, 1);
+                    cb_pop_front(cb_data0_r, 1);
+                    cb_pop_front(cb_data0_i, 1);
+                    cb_pop_front(cb_data1_r, 1);
+                    cb_pop_front(cb_data1_i, 1);
+                    continue;
+                }
+
+                if (requires_imaginary_neg) {
+                    unary_sfpu_op<NEG>(cb_data1_i, cb_intermediate2);
+                    cb_wait_front(cb_intermediate2, 1);
+                }
+
+                // Calculate f0
+                maths_op<MUL>(cb_data1_r, cb_twiddle_r, cb_intermediate0);
+                maths_op<MUL>(requires_imaginary_neg ? cb_intermediate2 : cb_data1_i, cb_twiddle_i, cb_intermediate1);
+                maths_op<SUB,true,true>(cb_intermediate0, cb_intermediate1, cb_f0);
+
+                // Calculate f1      
+                maths_op<MUL>(cb_data1_r, cb_twiddle_i, cb_intermediate0);
+                maths_op<MUL>(requires_imaginary_neg ? cb_intermediate2 : cb_data1_i, cb_twiddle_r, cb_intermediate1);
+                maths_op<ADD,true,true>(cb_intermediate0, cb_intermediate1, cb_f1);
+
+                cb_pop_front(cb_twiddle_r, 1);
+                cb_pop_front(cb_twiddle_i, 1);
+
+                // Wait on data for data 0 CBs to be available as we are about to use these
+                cb_wait_front(cb_data0_r, 1);
+                cb_wait_front(cb_data0_i, 1);
+
+                if (requires_imaginary_neg) {
+                    // Now invert the data 0 imaginary numbers if this is required
+                    cb_pop_front(cb_intermediate2, 1);            
+                    unary_sfpu_op<NEG>(cb_data0_i, cb_intermediate2);
+                    cb_wait_front(cb_intermediate2, 1);
+                }
+
+                cb_wait_front(cb_f0, 1);
+                cb_wait_front(cb_f1, 1);
+
+                // Calculate data_1 real
+                maths_op<SUB>(cb_data0_r, cb_f0, cb_data1_result_r);
+                // Calculate data_1 imaginary
+                maths_op<SUB>(requires_imaginary_neg ? cb_intermediate2 : cb_data0_i, cb_f1, cb_data1_result_i);
+                if (multiply_filter) {
+                    complex_multiply(cb_butterfly_r, cb_butterfly_i, cb_filter1_r, cb_filter1_i, cb_out_data1_r, cb_out_data1_i, cb_intermediate0, cb_intermediate1);
+                } else if (reduce_results) {
+                    reduce_spectrum(post_stage, cb_butterfly_r, cb_butterfly_i, cb_out_data1_r, cb_intermediate0, cb_intermediate1);
+                }
+                // Calculate data_0 real
+                maths_op<ADD>(cb_data0_r, cb_f0, cb_data0_result_r);
+                // Calculate data_0 imaginary
+                maths_op<ADD>(requires_imaginary_neg ? cb_intermediate2 : cb_data0_i, cb_f1, cb_data0_result_i);
+                if (multiply_filter) {
+                    complex_multiply(cb_butterfly_r, cb_butterfly_i, cb_filter0_r, cb_filter0_i, cb_out_data0_r, cb_out_data0_i, cb_intermediate0, cb_intermediate1);
+                } else if (reduce_results) {
+                    reduce_spectrum(post_stage, cb_butterfly_r, cb_butterfly_i, cb_out_data0_r, cb_intermediate0, cb_intermediate1);
+                }
+
+                if (requires_imaginary_neg) cb_pop_front(cb_intermediate2, 1);
+
+                cb_pop_front(cb_f0, 1);
+                cb_pop_front(cb_f1, 1);
+   
+                cb_pop_front(cb_data0_r, 1);
+                cb_pop_front(cb_data0_i, 1);
+                cb_pop_front(cb_data1_r, 1);
+                cb_pop_front(cb_data1_i, 1);
             }
+        }
+    }
+}
 
-            cb_wait_front(cb_f0, 1);
-            cb_wait_front(cb_f1, 1);
-
-            // Calculate data_1 real
-#ifdef USE_SFPU
-            maths_sfpu_op<SUB>(cb_data0_r, cb_f0, cb_out_data1_r);
-#else
-            maths_mm_op<SUB>(cb_data0_r, cb_f0, cb_out_data1_r);
-#endif
-            // Calculate data_1 imaginary
-#ifdef USE_SFPU
-            maths_sfpu_op<SUB>(requires_imaginary_neg ? cb_intermediate2 : cb_data0_i, cb_f1, cb_out_data1_i);
-#else
-            maths_mm_op<SUB>(requires_imaginary_neg ? cb_intermediate2 : cb_data0_i, cb_f1, cb_out_data1_i);
-#endif
-            // Calculate data_0 real
-#ifdef USE_SFPU
-            maths_sfpu_op<ADD>(cb_data0_r, cb_f0, cb_out_data0_r);
-#else
-            maths_mm_op<ADD>(cb_data0_r, cb_f0, cb_out_data0_r);
-#endif
-            // Calculate data_0 imaginary
-#ifdef USE_SFPU
-            maths_sfpu_op<ADD>(requires_imaginary_neg ? cb_intermediate2 : cb_data0_i, cb_f1, cb_out_data0_i);
-#else
-            maths_mm_op<ADD>(requires_imaginary_neg ? cb_intermediate2 : cb_data0_i, cb_f1, cb_out_data0_i);
-#endif        
-
-            if (requires_imaginary_neg) cb_pop_front(cb_intermediate2, 1);
+/*
+ * Complex multiply (a_r + j*a_i) * (b_r + j*b_i) a tile at a time, consuming the tiles of both inputs. The
+ * two temporary CBs hold the partial products
+ */
+void complex_multiply(uint32_t cb_a_r, uint32_t cb_a_i, uint32_t cb_b_r, uint32_t cb_b_i, uint32_t cb_out_r, uint32_t cb_out_i, 
+                        uint32_t cb_tmp0, uint32_t cb_tmp1) {
+    cb_wait_front(cb_a_r, 1);
+    cb_wait_front(cb_a_i, 1);
+    cb_wait_front(cb_b_r, 1);
+    cb_wait_front(cb_b_i, 1);
+    maths_op<MUL>(cb_a_r, cb_b_r, cb_tmp0);
+    maths_op<MUL>(cb_a_i, cb_b_i, cb_tmp1);
+    maths_op<SUB,true,true>(cb_tmp0, cb_tmp1, cb_out_r);
+    maths_op<MUL>(cb_a_r, cb_b_i, cb_tmp0);
+    maths_op<MUL>(cb_a_i, cb_b_r, cb_tmp1);
+    maths_op<ADD,true,true>(cb_tmp0, cb_tmp1, cb_out_i);
+    cb_pop_front(cb_a_r, 1);
+    cb_pop_front(cb_a_i, 1);
+    cb_pop_front(cb_b_r, 1);
+    cb_pop_front(cb_b_i, 1);
+}
 
-            cb_pop_front(cb_f0, 1);
-            cb_pop_front(cb_f1, 1);
-   
-            cb_pop_front(cb_data0_r, 1);
-            cb_pop_front(cb_data0_i, 1);
-            cb_pop_front(cb_data1_r, 1);
-            cb_pop_front(cb_data1_i, 1);
-        }
+/*
+ * Reduces a tile of complex points to r^2 + i^2, consuming the tiles of both inputs, and for decibels then takes
+ * 10*log10 of this as the natural log scaled on the SFPU. The two temporary CBs hold the squares, with the power
+ * going back into the first for the decibel conversion
+ */
+void reduce_spectrum(uint32_t post_stage, uint32_t cb_r, uint32_t cb_i, uint32_t cb_out, uint32_t cb_tmp0, uint32_t cb_tmp1) {
+    cb_wait_front(cb_r, 1);
+    cb_wait_front(cb_i, 1);
+    maths_op<MUL>(cb_r, cb_r, cb_tmp0);
+    maths_op<MUL>(cb_i, cb_i, cb_tmp1);
+    cb_pop_front(cb_r, 1);
+    cb_pop_front(cb_i, 1);
+    if (post_stage == DECIBEL_POST_STAGE) {
+        maths_op<ADD,true,true>(cb_tmp0, cb_tmp1, cb_tmp0);
+        unary_sfpu_op<DECIBEL,true>(cb_tmp0, cb_out);
+    } else {
+        maths_op<ADD,true,true>(cb_tmp0, cb_tmp1, cb_out);
     }
 }
 
@@ -7,8 +7,7 @@
 #include "compute_kernel_api/eltwise_unary/eltwise_unary.h"
 #include "compute_kernel_api/eltwise_unary/negative.h"
 #include "debug/dprint.h"
-
-#define USE_SFPU 1
+#include "../constants.h"
 
 namespace NAMESPACE {
 
@@ -20,6 +19,7 @@ enum {
     NEG = 4,
 };
 
+void unit_twiddle_butterflies(bool, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
 void do_copy_tile(uint32_t, uint32_t);
 void copy_tiles(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
 int getLog(int);
@@ -102,6 +102,47 @@ void maths_mm_op(uint32_t cb_in_1, uint32_t cb_in_2, uint32_t cb_tgt) {
     cb_push_back(cb_tgt, 1);
 }
 
+// The engine that the element-wise ops run on is chosen by the COMPUTE_BACKEND define, with the hybrid backend
+// putting the multiplies on the FPU and the additions and subtractions on the SFPU
+template <int OPERATION, bool CB_OP_IN1=false, bool CB_OP_IN2=false>
+inline void maths_op(uint32_t cb_in_1, uint32_t cb_in_2, uint32_t cb_tgt) {
+#if COMPUTE_BACKEND == BACKEND_SFPU
+    maths_sfpu_op<OPERATION, CB_OP_IN1, CB_OP_IN2>(cb_in_1, cb_in_2, cb_tgt);
+#elif COMPUTE_BACKEND == BACKEND_HYBRID
+    if constexpr(OPERATION == MUL) {
+        maths_mm_op<OPERATION, CB_OP_IN1, CB_OP_IN2>(cb_in_1, cb_in_2, cb_tgt);
+    } else {
+        maths_sfpu_op<OPERATION, CB_OP_IN1, CB_OP_IN2>(cb_in_1, cb_in_2, cb_tgt);
+    }
+#else
+    maths_mm_op<OPERATION, CB_OP_IN1, CB_OP_IN2>(cb_in_1, cb_in_2, cb_tgt);
+#endif
+}
+
+/*
+ * Butterflies of a tile whose twiddles are all the unit twiddle, which need just an addition or subtraction per
+ * output rather than the complex multiply. The inputs are not consumed. If negate_imaginary is set the imaginary
+ * inputs are conjugated first, which is folded into the operand order as -d0_i - -d1_i is d1_i - d0_i, with only
+ * -d0_i + -d1_i needing a negation
+ */
+void unit_twiddle_butterflies(bool negate_imaginary, uint32_t cb_data0_r, uint32_t cb_data0_i, uint32_t cb_data1_r, uint32_t cb_data1_i,
+                                uint32_t cb_data0_result_r, uint32_t cb_data0_result_i, uint32_t cb_data1_result_r, uint32_t cb_data1_result_i,
+                                uint32_t cb_intermediate) {
+    maths_op<SUB>(cb_data0_r, cb_data1_r, cb_data1_result_r);
+    if (negate_imaginary) {
+        maths_op<SUB>(cb_data1_i, cb_data0_i, cb_data1_result_i);
+    } else {
+        maths_op<SUB>(cb_data0_i, cb_data1_i, cb_data1_result_i);
+    }
+    maths_op<ADD>(cb_data0_r, cb_data1_r, cb_data0_result_r);
+    if (negate_imaginary) {
+        maths_op<ADD>(cb_data0_i, cb_data1_i, cb_intermediate);
+        unary_sfpu_op<NEG,true>(cb_intermediate, cb_data0_result_i);
+    } else {
+        maths_op<ADD>(cb_data0_i, cb_data1_i, cb_data0_result_i);
+    }
+}
+
 void MAIN {
     // Direction is 0 for forward FFT and 1 for backward FFT
     uint32_t direction = get_arg_val<uint32_t>(0);
@@ -113,16 +154,15 @@ void MAIN {
     constexpr auto cb_data1_i = tt::CBIndex::c_3;
     constexpr auto cb_twiddle_r = tt::CBIndex::c_4;
     constexpr auto cb_twiddle_i = tt::CBIndex::c_5;
-    constexpr auto cb_out_data0_r = tt::CBIndex::c_16;
-    constexpr auto cb_out_data0_i = tt::CBIndex::c_17;
-    constexpr auto cb_out_data1_r = tt::CBIndex::c_18;
-    constexpr auto cb_out_data1_i = tt::CBIndex::c_19;
+    constexpr auto cb_out_data0_r = tt::CBIndex::c_6;
+    constexpr auto cb_out_data0_i = tt::CBIndex::c_7;
+    constexpr auto cb_out_data1_r = tt::CBIndex::c_8;
+    constexpr auto cb_out_data1_i = tt::CBIndex::c_9;
 
-    constexpr auto cb_intermediate0 = tt::CBIndex::c_23;
-    constexpr auto cb_intermediate1 = tt::CBIndex::c_24;
-    constexpr auto cb_intermediate2 = tt::CBIndex::c_25;
-    constexpr auto cb_f0 = tt::CBIndex::c_6;
-    constexpr auto cb_f1 = tt::CBIndex::c_7;
+    constexpr auto cb_intermediate0 = tt::CBIndex::c_12;
+    constexpr auto cb_intermediate1 = tt::CBIndex::c_13;
+    constexpr auto cb_f0 = tt::CBIndex::c_15;
+    constexpr auto cb_f1 = tt::CBIndex::c_16;
 
     unary_op_init_common(cb_data1_r, cb_out_data1_r);    
     binary_op_init_common(cb_data1_r, cb_data1_i, cb_intermediate0);
@@ -137,36 +177,31 @@ void MAIN {
         cb_wait_front(cb_twiddle_r, 1);
         cb_wait_front(cb_twiddle_i, 1);
 
-        // If this is a backwards FFT then we need to invert imaginary data on the 
-        // first step and use this as input
-        bool requires_imaginary_neg=(direction == 1 && step == 0);
-
-        if (requires_imaginary_neg) {
-            unary_sfpu_op<NEG>(cb_data1_i, cb_intermediate2);
-            cb_wait_front(cb_intermediate2, 1);
+        if (step == 0) {
+            // Every twiddle of the first step is the unit twiddle, later steps mix twiddles within the tile. A backwards
+            // FFT conjugates its input, which is only done here
+            cb_wait_front(cb_data0_r, 1);
+            cb_wait_front(cb_data0_i, 1);
+            unit_twiddle_butterflies(direction == 1, cb_data0_r, cb_data0_i, cb_data1_r, cb_data1_i, cb_out_data0_r, cb_out_data0_i,
+                                        cb_out_data1_r, cb_out_data1_i, cb_intermediate0);
+            cb_pop_front(cb_twiddle_r, 1);
+            cb_pop_front(cb_twiddle_i, 1);
+            cb_pop_front(cb_data0_r, 1);
+            cb_pop_front(cb_data0_i, 1);
+            cb_pop_front(cb_data1_r, 1);
+            cb_pop_front(cb_data1_i, 1);
+            continue;
         }
 
         // Calculate f0
-#ifdef USE_SFPU
-        maths_sfpu_op<MUL>(cb_data1_r, cb_twiddle_r, cb_intermediate0);
-        maths_sfpu_op<MUL>(requires_imaginary_neg ? cb_intermediate2 : cb_data1_i, cb_twiddle_i, cb_intermediate1);
-        maths_sfpu_op<SUB,true,true>(cb_intermediate0, cb_intermediate1, cb_f0);
-#else
-        maths_mm_op<MUL>(cb_data1_r, cb_twiddle_r, cb_intermediate0);
-        maths_mm_op<MUL>(requires_imaginary_neg ? cb_intermediate2 : cb_data1_i, cb_twiddle_i, cb_intermediate1);
-        maths_mm_op<SUB,true,true>(cb_intermediate0, cb_intermediate1, cb_f0);
-#endif
+        maths_op<MUL>(cb_data1_r, cb_twiddle_r, cb_intermediate0);
+        maths_op<MUL>(cb_data1_i, cb_twiddle_i, cb_intermediate1);
+        maths_op<SUB,true,true>(cb_intermediate0, cb_intermediate1, cb_f0);
 
         // Calculate f1      
-#ifdef USE_SFPU
-        maths_sfpu_op<MUL>(cb_data1_r, cb_twiddle_i, cb_intermediate0);
-        maths_sfpu_op<MUL>(requires_imaginary_neg ? cb_intermediate2 : cb_data1_i, cb_twiddle_r, cb_intermediate1);
-        maths_sfpu_op<ADD,true,true>(cb_intermediate0, cb_intermediate1, cb_f1);
-#else
-        maths_mm_op<MUL>(cb_data1_r, cb_twiddle_i, cb_intermediate0);
-        maths_mm_op<MUL>(requires_imaginary_neg ? cb_intermediate2 : cb_data1_i, cb_twiddle_r, cb_intermediate1);
-        maths_mm_op<ADD,true,true>(cb_intermediate0, cb_intermediate1, cb_f1);
-#endif
+        maths_op<MUL>(cb_data1_r, cb_twiddle_i, cb_intermediate0);
+        maths_op<MUL>(cb_data1_i, cb_twiddle_r, cb_intermediate1);
+        maths_op<ADD,true,true>(cb_intermediate0, cb_intermediate1, cb_f1);
 
         cb_pop_front(cb_twiddle_r, 1);
         cb_pop_front(cb_twiddle_i, 1);
@@ -175,42 +210,17 @@ void MAIN {
         cb_wait_front(cb_data0_r, 1);
         cb_wait_front(cb_data0_i, 1);
 
-        if (requires_imaginary_neg) {
-            // Now invert the data 0 imaginary numbers if this is required
-            cb_pop_front(cb_intermediate2, 1);            
-            unary_sfpu_op<NEG>(cb_data0_i, cb_intermediate2);
-            cb_wait_front(cb_intermediate2, 1);
-        }
-
         cb_wait_front(cb_f0, 1);
         cb_wait_front(cb_f1, 1);
 
         // Calculate data_1 real
-#ifdef USE_SFPU
-        maths_sfpu_op<SUB>(cb_data0_r, cb_f0, cb_out_data1_r);
-#else
-        maths_mm_op<SUB>(cb_data0_r, cb_f0, cb_out_data1_r);
-#endif
+        maths_op<SUB>(cb_data0_r, cb_f0, cb_out_data1_r);
         // Calculate data_1 imaginary
-#ifdef USE_SFPU
-        maths_sfpu_op<SUB>(requires_imaginary_neg ? cb_intermediate2 : cb_data0_i, cb_f1, cb_out_data1_i);
-#else
-        maths_mm_op<SUB>(requires_imaginary_neg ? cb_intermediate2 : cb_data0_i, cb_f1, cb_out_data1_i);
-#endif
+        maths_op<SUB>(cb_data0_i, cb_f1, cb_out_data1_i);
         // Calculate data_0 real
-#ifdef USE_SFPU
-        maths_sfpu_op<ADD>(cb_data0_r, cb_f0, cb_out_data0_r);
-#else
-        maths_mm_op<ADD>(cb_data0_r, cb_f0, cb_out_data0_r);
-#endif
+        maths_op<ADD>(cb_data0_r, cb_f0, cb_out_data0_r);
         // Calculate data_0 imaginary
-#ifdef USE_SFPU
-        maths_sfpu_op<ADD>(requires_imaginary_neg ? cb_intermediate2 : cb_data0_i, cb_f1, cb_out_data0_i);
-#else
-        maths_mm_op<ADD>(requires_imaginary_neg ? cb_intermediate2 : cb_data0_i, cb_f1, cb_out_data0_i);
-#endif        
-
-        if (requires_imaginary_neg) cb_pop_front(cb_intermediate2, 1);
+        maths_op<ADD>(cb_data0_i, cb_f1, cb_out_data0_i);
 
         cb_pop_front(cb_f0, 1);
         cb_pop_front(cb_f1, 1);
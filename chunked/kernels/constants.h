@@ -2,3 +2,74 @@
 // the tile size, but can be smaller to give reduced granularity
 #define CHUNK_SIZE 512
 
+// From this domain size each half of the domain, and each chunk of it, is a multiple
+// of 64 bytes so can be moved with aligned NoC transfers rather than point by point
+#define MIN_CONTIGUOUS_DOMAIN_SIZE 32
+
+// With local sub-FFTs the reader computes the stages whose butterflies all lie within one block of this many steps'
+// worth of points, 2^local_block_steps being the largest power of two within the 2*CHUNK_SIZE points of a chunk
+constexpr uint32_t local_block_steps = 31 - __builtin_clz(2 * CHUNK_SIZE);
+
+// The first step that goes through the compute kernel, the last step always does as it is written out by the writer
+inline uint32_t get_first_pipelined_step(uint32_t local_substages, uint32_t num_steps) {
+    if (!local_substages) return 0;
+    return local_block_steps < num_steps ? local_block_steps : num_steps;
+}
+
+// Reduction of each point of the final stage, as FFTPostStage on the host, after which only the real part is written
+#define NO_POST_STAGE 0
+#define POWER_POST_STAGE 1
+#define DECIBEL_POST_STAGE 2
+
+// Reduction of each frame's final stage by the writer, as FFTReduction on the host. A frame is written as a record of
+// the count followed by capacity (index, value) pairs, padded to 64 bytes and held in the writer's staging page
+#define NO_REDUCTION 0
+#define TOP_K_REDUCTION 1
+#define THRESHOLD_REDUCTION 2
+#define MAX_REDUCTION_CAPACITY ((CHUNK_SIZE / 2) - 1)
+
+inline uint32_t get_reduction_record_size(uint32_t capacity) {
+    return ((1 + (2 * capacity)) + 15) & ~15u;
+}
+
+// Twiddles that need no complex multiply, W^0=1 so f is data 1 itself, and W^(n/4)=-j so f is data 1 with real and
+// imaginary swapped and the new imaginary negated, leaving each butterfly output a single addition or subtraction
+#define GENERAL_TWIDDLE 0
+#define UNIT_TWIDDLE 1
+#define MINUS_J_TWIDDLE 2
+
+inline uint32_t get_twiddle_kind(uint32_t twiddle_index, uint32_t domain_size) {
+    if (twiddle_index == 0) return UNIT_TWIDDLE;
+    return twiddle_index == domain_size/4 ? MINUS_J_TWIDDLE : GENERAL_TWIDDLE;
+}
+
+// The kind of twiddle that all of a chunk's butterflies share, in every step spectra 0 has the unit twiddle and spectra
+// 2^(step-1) has -j, and once each spectra spans a whole number of chunks some chunks hold only one of these
+inline uint32_t get_chunk_twiddle_kind(uint32_t step, uint32_t chunk, uint32_t domain_size, uint32_t num_steps) {
+    if (step == 0) return UNIT_TWIDDLE;
+    uint32_t butterflies_per_spectra=(domain_size/2) >> step;
+    if (butterflies_per_spectra % CHUNK_SIZE != 0) return GENERAL_TWIDDLE;
+    uint32_t spectra=(chunk * CHUNK_SIZE) / butterflies_per_spectra;
+    return get_twiddle_kind(spectra << (num_steps-step), domain_size);
+}
+
+// Kernels built for a plan have the domain size and direction as compile time arguments, so the stage
+// loops are specialised for them. These are zero for the generic kernels, which use the runtime arguments
+constexpr uint32_t compile_time_domain_size = get_compile_time_arg_val(0);
+constexpr uint32_t compile_time_direction = get_compile_time_arg_val(1);
+
+// Values of the COMPUTE_BACKEND define that the compute kernels are built with, matching FFTComputeBackend on the host
+#define BACKEND_FPU 0
+#define BACKEND_SFPU 1
+#define BACKEND_HYBRID 2
+#ifndef COMPUTE_BACKEND
+#define COMPUTE_BACKEND BACKEND_FPU
+#endif
+
+// Pipeline components that the microbenchmark harness kernels drive alone, as FFTComponent on the host. The data movement
+// components are built from kernels/microbenchmark/component.cpp with the COMPONENT define set to one of these
+#define BITREVERSE_COMPONENT 0
+#define GATHER_COMPONENT 1
+#define TWIDDLE_COMPONENT 2
+#define BUTTERFLY_COMPONENT 3
+#define SCATTER_COMPONENT 4
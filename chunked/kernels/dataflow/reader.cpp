@@ -3,11 +3,20 @@
 #include "dataflow_api.h"
 #include "../constants.h"
 
-void read_cb_and_arange_data(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
-void read_external_and_arrange_data(uint64_t, uint64_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
-void read_stage_data(uint32_t, uint32_t, uint32_t, uint32_t, float*, float*, uint32_t, uint32_t, float*, uint32_t, uint32_t, uint32_t, uint32_t);
+void read_cb_and_arange_data(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, 
+                                uint64_t, uint64_t, uint32_t, volatile uint32_t*, uint32_t);
+void read_external_and_arrange_data(uint64_t, uint64_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t,
+                                        uint64_t, uint64_t, uint32_t, float*, uint32_t, uint32_t, uint32_t);
+void compute_local_stages(float*, float*, float*, uint32_t, uint32_t, uint32_t, uint32_t);
+void read_stage_data(uint32_t, uint32_t, uint32_t, uint32_t, float*, float*, uint32_t, uint32_t, float*, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t,
+                        uint64_t, uint64_t, uint32_t, volatile uint32_t*, uint32_t);
+void read_contiguous_stage_data(uint32_t, uint32_t, uint32_t, uint32_t, float*, float*, uint32_t, uint32_t, float*, uint32_t, uint32_t, uint32_t, uint32_t,
+                                    uint64_t, uint64_t, uint32_t, volatile uint32_t*, uint32_t);
+void read_filter_chunk(uint64_t, uint64_t, uint32_t, uint32_t);
+inline void get_compact_twiddle(float*, uint32_t, uint32_t, float*, float*);
 inline void push_cbs(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
 inline void reserve_cbs(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, float**, float**, float**, float**, float**, float**);
+void generate_twiddles_from_seeds(float*, float*, uint32_t, uint32_t);
 void bitreverse(float*, int);
 int getLog(int);
 
@@ -18,14 +27,40 @@ void kernel_main() {
     uint32_t data_r_bank_id = get_arg_val<uint32_t>(3);
     uint32_t data_i_bank_id = get_arg_val<uint32_t>(4);
     uint32_t twiddle_bank_id = get_arg_val<uint32_t>(5);
-    uint32_t read_in_r_buffer_addr = get_arg_val<uint32_t>(6);
-    uint32_t read_in_i_buffer_addr = get_arg_val<uint32_t>(7);
+    // The arena backing the writer's staging pages, each frame's input is read into one of these
+    uint32_t staging_r_buffer_addr = get_arg_val<uint32_t>(6);
+    uint32_t staging_i_buffer_addr = get_arg_val<uint32_t>(7);
     uint32_t twiddle_buffer_addr = get_arg_val<uint32_t>(8);
-    uint32_t domain_size = get_arg_val<uint32_t>(9);
+    uint32_t domain_size = compile_time_domain_size > 0 ? compile_time_domain_size : get_arg_val<uint32_t>(9);
+    uint32_t twiddle_seed_stride = get_arg_val<uint32_t>(10);
+    uint32_t compact_twiddles = get_arg_val<uint32_t>(11);
+    uint32_t filter_r_addr = get_arg_val<uint32_t>(12);
+    uint32_t filter_i_addr = get_arg_val<uint32_t>(13);
+    uint32_t pointwise_multiply = get_arg_val<uint32_t>(14);
+    // A batch of frames is transformed, each starting frame_stride points after the previous in the input
+    uint32_t num_frames = get_arg_val<uint32_t>(15);
+    uint32_t frame_stride = get_arg_val<uint32_t>(16);
+    // If the window address is non-zero then each frame is multiplied by the window as it is read
+    uint32_t window_addr = get_arg_val<uint32_t>(17);
+    uint32_t window_buffer_addr = get_arg_val<uint32_t>(18);
+    // If set then each stage is gathered as soon as the chunks of the previous stage it depends on are
+    // written, tracked by the writer in the progress semaphore, rather than waiting on the whole stage
+    uint32_t pipeline_stages = get_arg_val<uint32_t>(19);
+    uint32_t stage_progress_semaphore = get_arg_val<uint32_t>(20);
+    // If set then the stages whose sub-FFTs fit within a chunk are computed here in L1, rather than each going round
+    // the compute kernel and writer. The reader then applies the conjugation of a backwards transform itself
+    uint32_t local_substages = get_arg_val<uint32_t>(21);
+    uint32_t direction = get_arg_val<uint32_t>(22);
+    // Points of each frame read from the input, with the rest of the domain zero padded. The window covers just these
+    uint32_t input_length = get_arg_val<uint32_t>(23);
+    uint32_t staging_page_size = get_arg_val<uint32_t>(24);
 
     uint64_t data_r_noc_addr = get_noc_addr_from_bank_id<true>(data_r_bank_id, data_r_addr);
     uint64_t data_i_noc_addr = get_noc_addr_from_bank_id<true>(data_i_bank_id, data_i_addr);
     uint64_t twiddle_noc_addr = get_noc_addr_from_bank_id<true>(twiddle_bank_id, twiddle_addr);
+    // The filter spectrum is in the same bank as the data
+    uint64_t filter_r_noc_addr = get_noc_addr_from_bank_id<true>(data_r_bank_id, filter_r_addr);
+    uint64_t filter_i_noc_addr = get_noc_addr_from_bank_id<true>(data_i_bank_id, filter_i_addr);
 
     constexpr auto cb_data0_r = tt::CBIndex::c_0;
     constexpr auto cb_data0_i = tt::CBIndex::c_1;
@@ -41,50 +76,197 @@ void kernel_main() {
     uint32_t number_chunks = (domain_size/2) / CHUNK_SIZE;
     if (number_chunks * CHUNK_SIZE < domain_size/2) number_chunks++;
 
-    noc_async_read(twiddle_noc_addr, twiddle_buffer_addr, domain_size * 4);
-    noc_async_read_barrier();
+    if (twiddle_seed_stride > 0) {
+        // Only the seed tables are held in DRAM, these are staged in the arena (which the writer can not
+        // use until the first stage is computed) and expanded into the full twiddle table
+        uint32_t num_coarse_seeds=(domain_size/2) / twiddle_seed_stride;
+        noc_async_read(twiddle_noc_addr, staging_r_buffer_addr, (twiddle_seed_stride + num_coarse_seeds) * 8);
+        noc_async_read_barrier();
+        generate_twiddles_from_seeds((float*) staging_r_buffer_addr, (float*) twiddle_buffer_addr, twiddle_seed_stride, num_coarse_seeds);
+    } else {
+        // The compact table is the first octant, n/8+1 complex twiddles
+        noc_async_read(twiddle_noc_addr, twiddle_buffer_addr, compact_twiddles ? ((domain_size/8)+1) * 8 : domain_size * 4);
+        noc_async_read_barrier();
+    }
+
+    float * window_data=NULL;
+    if (window_addr != 0) {
+        noc_async_read(get_noc_addr_from_bank_id<true>(data_r_bank_id, window_addr), window_buffer_addr, input_length * 4);
+        noc_async_read_barrier();
+        window_data=(float*) window_buffer_addr;
+    }
 
     int num_steps=getLog(domain_size);
+    uint32_t first_step=get_first_pipelined_step(local_substages, num_steps);
 
-    read_external_and_arrange_data(data_r_noc_addr, data_i_noc_addr, read_in_r_buffer_addr, read_in_i_buffer_addr, cb_data0_r, cb_data0_i, cb_data1_r, cb_data1_i, 
-                                    cb_twiddle_r, cb_twiddle_i, twiddle_buffer_addr, domain_size, number_chunks, num_steps);
-    for (int step=1; step <= num_steps; step++) {
-        read_cb_and_arange_data(cb_out_data_r, cb_out_data_i, cb_data0_r, cb_data0_i, cb_data1_r, cb_data1_i, 
-                                    cb_twiddle_r, cb_twiddle_i, twiddle_buffer_addr, domain_size, number_chunks, num_steps, step);
+    volatile uint32_t * stage_progress=NULL;
+    if (pipeline_stages) {
+        // The count carries over from the previous launch, this is reset before any data is passed on so the
+        // writer can not have started updating it
+        stage_progress=(volatile uint32_t*) get_semaphore(stage_progress_semaphore);
+        noc_semaphore_set(stage_progress, 0);
+    }
+
+    for (uint32_t frame=0; frame < num_frames; frame++) {
+        // Overlapping frames are gathered straight from the one signal held in DRAM
+        uint32_t frame_offset=frame * frame_stride * 4;
+        // The input is dead once the first stage is gathered, so it is read into the staging page after the one
+        // the writer fills next. That page was last popped at the end of the previous frame and the writer
+        // can not reserve it before this frame's second stage is gathered
+        uint32_t input_page_offset=((((frame * (num_steps - first_step)) + 1) % 2) * staging_page_size);
+        read_external_and_arrange_data(data_r_noc_addr + frame_offset, data_i_noc_addr + frame_offset, staging_r_buffer_addr + input_page_offset,
+                                        staging_i_buffer_addr + input_page_offset, 
+                                        cb_data0_r, cb_data0_i, cb_data1_r, cb_data1_i, cb_twiddle_r, cb_twiddle_i, twiddle_buffer_addr, compact_twiddles, 
+                                        domain_size, number_chunks, num_steps, filter_r_noc_addr, filter_i_noc_addr, pointwise_multiply, window_data,
+                                        first_step, direction, input_length);
+        for (int step=first_step+1; step <= num_steps; step++) {
+            // The writer counts the chunks it has written over all previous stages and frames
+            uint32_t progress_base=((frame * (num_steps - first_step)) + step - 1 - first_step) * number_chunks;
+            read_cb_and_arange_data(cb_out_data_r, cb_out_data_i, cb_data0_r, cb_data0_i, cb_data1_r, cb_data1_i, 
+                                        cb_twiddle_r, cb_twiddle_i, twiddle_buffer_addr, compact_twiddles, domain_size, number_chunks, num_steps, step,
+                                        filter_r_noc_addr, filter_i_noc_addr, pointwise_multiply, stage_progress, progress_base);
+        }
     }
 }
 
 void read_cb_and_arange_data(uint32_t cb_data_r_id, uint32_t cb_data_i_id, uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb_data1_r_id, uint32_t cb_data1_i_id, 
-                                uint32_t cb_twiddle_r, uint32_t cb_twiddle_i, uint32_t twiddle_data, uint32_t domain_size, uint32_t number_chunks, uint32_t num_steps, uint32_t step) {
-    cb_wait_front(cb_data_r_id, 1);
-    cb_wait_front(cb_data_i_id, 1);
+                                uint32_t cb_twiddle_r, uint32_t cb_twiddle_i, uint32_t twiddle_data, uint32_t compact_twiddles, uint32_t domain_size, uint32_t number_chunks, 
+                                uint32_t num_steps, uint32_t step, uint64_t filter_r_noc_addr, uint64_t filter_i_noc_addr, uint32_t pointwise_multiply,
+                                volatile uint32_t * stage_progress, uint32_t progress_base) {
+    if (stage_progress == NULL) {
+        cb_wait_front(cb_data_r_id, 1);
+        cb_wait_front(cb_data_i_id, 1);
+    }
+    // When pipelining the page is read whilst the writer is still filling it, the front page is where the
+    // writer's reserved page will be as both advance through the two pages in turn
     float * read_cb_data_r_addr = (float*) get_read_ptr(cb_data_r_id);
     float * read_cb_data_i_addr = (float*) get_read_ptr(cb_data_i_id);
     read_stage_data(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, read_cb_data_r_addr, read_cb_data_i_addr, 
-                        cb_twiddle_r, cb_twiddle_i, (float*) twiddle_data, domain_size, number_chunks, num_steps, step);
+                        cb_twiddle_r, cb_twiddle_i, (float*) twiddle_data, compact_twiddles, domain_size, number_chunks, num_steps, step,
+                        filter_r_noc_addr, filter_i_noc_addr, pointwise_multiply, stage_progress, progress_base);
+    if (stage_progress != NULL) {
+        // Every chunk has been written by now, so this just keeps the circular buffer accounting in step
+        cb_wait_front(cb_data_r_id, 1);
+        cb_wait_front(cb_data_i_id, 1);
+    }
     cb_pop_front(cb_data_r_id, 1);
     cb_pop_front(cb_data_i_id, 1);
 }
 
 void read_external_and_arrange_data(uint64_t data_r_noc_addr, uint64_t data_i_noc_addr, uint32_t read_in_r_buffer_addr, uint32_t read_in_i_buffer_addr, 
                                         uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb_data1_r_id, uint32_t cb_data1_i_id, 
-                                        uint32_t cb_twiddle_r, uint32_t cb_twiddle_i, uint32_t twiddle_data, uint32_t domain_size, uint32_t number_chunks, uint32_t num_steps) {
-    noc_async_read(data_r_noc_addr, read_in_r_buffer_addr, domain_size * 4);
-    noc_async_read(data_i_noc_addr, read_in_i_buffer_addr, domain_size * 4);
-    noc_async_read_barrier();
+                                        uint32_t cb_twiddle_r, uint32_t cb_twiddle_i, uint32_t twiddle_data, uint32_t compact_twiddles, uint32_t domain_size, 
+                                        uint32_t number_chunks, uint32_t num_steps, uint64_t filter_r_noc_addr, uint64_t filter_i_noc_addr, 
+                                        uint32_t pointwise_multiply, float * window_data, uint32_t first_step, uint32_t direction,
+                                        uint32_t input_length) {
+    noc_async_read(data_r_noc_addr, read_in_r_buffer_addr, input_length * 4);
+    noc_async_read(data_i_noc_addr, read_in_i_buffer_addr, input_length * 4);
     float* in_r_data=(float*) read_in_r_buffer_addr;
     float* in_i_data=(float*) read_in_i_buffer_addr;
+    // The padding is beyond the points being read, so is zeroed whilst they arrive
+    for (uint32_t i=input_length; i<domain_size; i++) {
+        in_r_data[i]=0.0f;
+        in_i_data[i]=0.0f;
+    }
+    noc_async_read_barrier();
+    if (window_data != NULL) {
+        for (uint32_t i=0; i<input_length; i++) {
+            in_r_data[i]*=window_data[i];
+            in_i_data[i]*=window_data[i];
+        }
+    }
     // Bit reverse on the input data that we have just read
     bitreverse(in_r_data, domain_size);
     bitreverse(in_i_data, domain_size);
-    // Step is zero here a this is the first read
+    if (first_step > 0) {
+        if (direction == 1) {
+            // Otherwise done by the compute kernel in step zero, which is now one of the local stages
+            for (uint32_t i=0; i<domain_size; i++) in_i_data[i]=-in_i_data[i];
+        }
+        compute_local_stages(in_r_data, in_i_data, (float*) twiddle_data, compact_twiddles, domain_size, num_steps, first_step);
+    }
+    // This is the first read, so the first step that goes through the compute kernel
     read_stage_data(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, in_r_data, in_i_data, 
-                        cb_twiddle_r, cb_twiddle_i, (float*) twiddle_data, domain_size, number_chunks, num_steps, 0);
+                        cb_twiddle_r, cb_twiddle_i, (float*) twiddle_data, compact_twiddles, domain_size, number_chunks, num_steps, first_step,
+                        filter_r_noc_addr, filter_i_noc_addr, pointwise_multiply, NULL, 0);
+}
+
+/*
+ * Runs steps zero to first_step-1 in place on the bit reversed input. Each sub-FFT of these steps lies within
+ * a block of 2^first_step points, so all of the steps are run on one block before moving to the next whilst
+ * it is held close. The butterflies are those of the compute kernel, with the same twiddles and operation order,
+ * and those with the unit or -j twiddle skip the multiply as the compute kernel does for whole chunks of them
+ */
+void compute_local_stages(float * data_r, float * data_i, float * twiddle_data, uint32_t compact_twiddles, uint32_t domain_size,
+                            uint32_t num_steps, uint32_t first_step) {
+    if constexpr (compile_time_domain_size > 0) {
+        domain_size=compile_time_domain_size;
+        num_steps=getLog(compile_time_domain_size);
+    }
+    uint32_t block_size=1 << first_step;
+    for (uint32_t block_start=0; block_start < domain_size; block_start+=block_size) {
+        for (uint32_t step=0; step < first_step; step++) {
+            uint32_t num_spectra_in_step=step == 0 ? 1 : 2 << (step-1);
+            uint32_t increment_next_point_in_step=2 << step;
+            uint32_t matching_second_point=increment_next_point_in_step/2;
+            for (uint32_t spectra=0; spectra < num_spectra_in_step; spectra++) {
+                uint32_t twiddle_index=spectra << (num_steps-step);
+                uint32_t twiddle_kind=get_twiddle_kind(twiddle_index, domain_size);
+                float twiddle_r, twiddle_i;
+                if (compact_twiddles) {
+                    get_compact_twiddle(twiddle_data, twiddle_index, domain_size, &twiddle_r, &twiddle_i);
+                } else {
+                    twiddle_r=twiddle_data[twiddle_index*2];
+                    twiddle_i=twiddle_data[(twiddle_index*2)+1];
+                }
+                for (uint32_t point=block_start; point < block_start+block_size; point+=increment_next_point_in_step) {
+                    uint32_t d0_data_index=spectra + point;
+                    uint32_t d1_data_index=spectra + point + matching_second_point;
+                    float f0, f1;
+                    if (twiddle_kind == UNIT_TWIDDLE) {
+                        f0=data_r[d1_data_index];
+                        f1=data_i[d1_data_index];
+                    } else if (twiddle_kind == MINUS_J_TWIDDLE) {
+                        f0=data_i[d1_data_index];
+                        f1=-data_r[d1_data_index];
+                    } else {
+                        f0=(data_r[d1_data_index] * twiddle_r) - (data_i[d1_data_index] * twiddle_i);
+                        f1=(data_r[d1_data_index] * twiddle_i) + (data_i[d1_data_index] * twiddle_r);
+                    }
+                    data_r[d1_data_index]=data_r[d0_data_index] - f0;
+                    data_i[d1_data_index]=data_i[d0_data_index] - f1;
+                    data_r[d0_data_index]=data_r[d0_data_index] + f0;
+                    data_i[d0_data_index]=data_i[d0_data_index] + f1;
+                }
+            }
+        }
+    }
 }
 
+/*
+ * Spectra s of this step holds the points whose index modulo 2^step is s, which were all written by spectra
+ * s modulo 2^(step-1) of the previous step. The previous step writes its spectra in order, each of
+ * n/2^step butterflies, so the first half of the spectra here only needs a growing prefix of the previous
+ * step and the second half none further. If stage_progress is set then we wait on just that prefix
+ */
 void read_stage_data(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb_data1_r_id, uint32_t cb_data1_i_id, 
                         float * in_data_r, float * in_data_i, uint32_t cb_twiddle_r, uint32_t cb_twiddle_i, float * twiddle_data, 
-                        uint32_t domain_size, uint32_t number_chunks, uint32_t num_steps, uint32_t step) {
+                        uint32_t compact_twiddles, uint32_t domain_size, uint32_t number_chunks, uint32_t num_steps, uint32_t step,
+                        uint64_t filter_r_noc_addr, uint64_t filter_i_noc_addr, uint32_t pointwise_multiply,
+                        volatile uint32_t * stage_progress, uint32_t progress_base) {
+    if constexpr (compile_time_domain_size > 0) {
+        // Constant for a plan, so the loop bounds and index arithmetic below reduce to shifts of constants
+        domain_size=compile_time_domain_size;
+        number_chunks=((compile_time_domain_size/2) + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        num_steps=getLog(compile_time_domain_size);
+    }
+
+    if (step == num_steps && domain_size >= MIN_CONTIGUOUS_DOMAIN_SIZE) {
+        read_contiguous_stage_data(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, in_data_r, in_data_i, cb_twiddle_r, cb_twiddle_i,
+                                    twiddle_data, compact_twiddles, domain_size, number_chunks, step, filter_r_noc_addr, filter_i_noc_addr,
+                                    pointwise_multiply, stage_progress, progress_base);
+        return;
+    }
 
     float *write_cb_data0_r_addr, *write_cb_data0_i_addr, *write_cb_data1_r_addr, 
             *write_cb_data1_i_addr, *twiddle_r_addr, *twiddle_i_addr;
@@ -93,15 +275,32 @@ void read_stage_data(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb
                     &write_cb_data0_r_addr, &write_cb_data0_i_addr, &write_cb_data1_r_addr, 
                     &write_cb_data1_i_addr, &twiddle_r_addr, &twiddle_i_addr);
 
+    // In the final stage the points are in natural order, so the filter spectrum is read chunk by chunk
+    // alongside the data for the compute kernel to multiply by
+    bool read_filter=pointwise_multiply && step == num_steps;
+    if (read_filter) read_filter_chunk(filter_r_noc_addr, filter_i_noc_addr, 0, domain_size);
+
     uint32_t num_spectra_in_step=step == 0 ? 1 : 2 << (step-1);
     uint32_t increment_next_point_in_step=2 << step;
     uint32_t matching_second_point=increment_next_point_in_step/2;
+    uint32_t num_spectra_in_previous_step=num_spectra_in_step/2;
+    uint32_t butterflies_per_previous_spectra=domain_size >> step;
        
     uint32_t tgt_data_idx=0, chunks_computed=0;
     for (uint32_t spectra=0; spectra < num_spectra_in_step; spectra++) {
+        if (stage_progress != NULL && spectra < num_spectra_in_previous_step) {
+            uint32_t required_butterflies=(spectra+1) * butterflies_per_previous_spectra;
+            uint32_t required_chunks=(required_butterflies + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            noc_semaphore_wait_min(stage_progress, progress_base + required_chunks);
+        }
         uint32_t twiddle_index=spectra << (num_steps-step);
-        uint32_t twiddle_index_r=twiddle_index*2;
-        uint32_t twiddle_index_i=(twiddle_index*2)+1;
+        float twiddle_r, twiddle_i;
+        if (compact_twiddles) {
+            get_compact_twiddle(twiddle_data, twiddle_index, domain_size, &twiddle_r, &twiddle_i);
+        } else {
+            twiddle_r=twiddle_data[twiddle_index*2];
+            twiddle_i=twiddle_data[(twiddle_index*2)+1];
+        }
         for (uint32_t point=0; point < domain_size; point+=increment_next_point_in_step) {
             uint32_t d0_data_index=spectra + point;
             uint32_t d1_data_index=spectra + point + matching_second_point;
@@ -110,8 +309,8 @@ void read_stage_data(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb
             write_cb_data0_i_addr[tgt_data_idx]=in_data_i[d0_data_index];
             write_cb_data1_r_addr[tgt_data_idx]=in_data_r[d1_data_index];            
             write_cb_data1_i_addr[tgt_data_idx]=in_data_i[d1_data_index];
-            twiddle_r_addr[tgt_data_idx]=twiddle_data[twiddle_index_r];
-            twiddle_i_addr[tgt_data_idx]=twiddle_data[twiddle_index_i];
+            twiddle_r_addr[tgt_data_idx]=twiddle_r;
+            twiddle_i_addr[tgt_data_idx]=twiddle_i;
 
             //DPRINT << "Data step="<<U32(step)<<" spectra="<<U32(spectra)<<" point="<<U32(point)<<" is "<<in_data[d0_data_index] << "\n";
             //DPRINT << "Target twiddle="<<tgt_data_idx<< ENDL();
@@ -125,6 +324,7 @@ void read_stage_data(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb
                     reserve_cbs(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, cb_twiddle_r, cb_twiddle_i,
                                     &write_cb_data0_r_addr, &write_cb_data0_i_addr, &write_cb_data1_r_addr,
                                     &write_cb_data1_i_addr, &twiddle_r_addr, &twiddle_i_addr);                
+                    if (read_filter) read_filter_chunk(filter_r_noc_addr, filter_i_noc_addr, chunks_computed, domain_size);
                     tgt_data_idx=0;
                 }
             }
@@ -133,6 +333,120 @@ void read_stage_data(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb
     push_cbs(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, cb_twiddle_r, cb_twiddle_i);
 }
 
+/*
+ * In the final step every spectra is a single butterfly, spectra s pairing points s and s+n/2, so each chunk
+ * of data 0 and data 1 is a contiguous run of the two halves. These are copied by the NoC within L1 whilst
+ * the twiddles, which are the consecutive entries of the table, are filled in
+ */
+void read_contiguous_stage_data(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb_data1_r_id, uint32_t cb_data1_i_id,
+                                    float * in_data_r, float * in_data_i, uint32_t cb_twiddle_r, uint32_t cb_twiddle_i, float * twiddle_data,
+                                    uint32_t compact_twiddles, uint32_t domain_size, uint32_t number_chunks, uint32_t step,
+                                    uint64_t filter_r_noc_addr, uint64_t filter_i_noc_addr, uint32_t pointwise_multiply,
+                                    volatile uint32_t * stage_progress, uint32_t progress_base) {
+    if constexpr (compile_time_domain_size > 0) {
+        domain_size=compile_time_domain_size;
+        number_chunks=((compile_time_domain_size/2) + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    }
+    float *write_cb_data0_r_addr, *write_cb_data0_i_addr, *write_cb_data1_r_addr, 
+            *write_cb_data1_i_addr, *twiddle_r_addr, *twiddle_i_addr;
+
+    uint32_t half_domain=domain_size/2;
+    uint32_t num_spectra_in_previous_step=1 << (step-1);
+    uint32_t butterflies_per_previous_spectra=domain_size >> step;
+
+    for (uint32_t chunk=0; chunk < number_chunks; chunk++) {
+        uint32_t chunk_start=chunk * CHUNK_SIZE;
+        uint32_t chunk_points=half_domain - chunk_start < CHUNK_SIZE ? half_domain - chunk_start : CHUNK_SIZE;
+
+        reserve_cbs(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, cb_twiddle_r, cb_twiddle_i, 
+                        &write_cb_data0_r_addr, &write_cb_data0_i_addr, &write_cb_data1_r_addr, 
+                        &write_cb_data1_i_addr, &twiddle_r_addr, &twiddle_i_addr);
+        if (pointwise_multiply) read_filter_chunk(filter_r_noc_addr, filter_i_noc_addr, chunk, domain_size);
+
+        if (stage_progress != NULL) {
+            // The same dependency as read_stage_data, taken for the last spectra in the chunk
+            uint32_t last_spectra=chunk_start + chunk_points - 1;
+            uint32_t dependent_spectra=last_spectra < num_spectra_in_previous_step ? last_spectra : num_spectra_in_previous_step - 1;
+            uint32_t required_chunks=(((dependent_spectra+1) * butterflies_per_previous_spectra) + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            noc_semaphore_wait_min(stage_progress, progress_base + required_chunks);
+        }
+
+        noc_async_read(get_noc_addr((uint32_t) &in_data_r[chunk_start]), (uint32_t) write_cb_data0_r_addr, chunk_points * 4);
+        noc_async_read(get_noc_addr((uint32_t) &in_data_i[chunk_start]), (uint32_t) write_cb_data0_i_addr, chunk_points * 4);
+        noc_async_read(get_noc_addr((uint32_t) &in_data_r[half_domain + chunk_start]), (uint32_t) write_cb_data1_r_addr, chunk_points * 4);
+        noc_async_read(get_noc_addr((uint32_t) &in_data_i[half_domain + chunk_start]), (uint32_t) write_cb_data1_i_addr, chunk_points * 4);
+
+        for (uint32_t i=0; i < chunk_points; i++) {
+            uint32_t twiddle_index=chunk_start + i;
+            if (compact_twiddles) {
+                get_compact_twiddle(twiddle_data, twiddle_index, domain_size, &twiddle_r_addr[i], &twiddle_i_addr[i]);
+            } else {
+                twiddle_r_addr[i]=twiddle_data[twiddle_index*2];
+                twiddle_i_addr[i]=twiddle_data[(twiddle_index*2)+1];
+            }
+        }
+        noc_async_read_barrier();
+        push_cbs(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, cb_twiddle_r, cb_twiddle_i);
+    }
+}
+
+/*
+ * Reads a chunk of the filter spectrum for data 0 (points 0 to n/2) and data 1 (points n/2 to n), these
+ * are the points that the final stage produces for that chunk
+ */
+void read_filter_chunk(uint64_t filter_r_noc_addr, uint64_t filter_i_noc_addr, uint32_t chunk, uint32_t domain_size) {
+    if constexpr (compile_time_domain_size > 0) domain_size=compile_time_domain_size;
+    constexpr auto cb_filter0_r = tt::CBIndex::c_17;
+    constexpr auto cb_filter0_i = tt::CBIndex::c_18;
+    constexpr auto cb_filter1_r = tt::CBIndex::c_19;
+    constexpr auto cb_filter1_i = tt::CBIndex::c_20;
+
+    uint32_t chunk_start=chunk * CHUNK_SIZE;
+    uint32_t chunk_points=(domain_size/2) - chunk_start < CHUNK_SIZE ? (domain_size/2) - chunk_start : CHUNK_SIZE;
+    uint32_t data0_offset=chunk_start * 4;
+    uint32_t data1_offset=((domain_size/2) + chunk_start) * 4;
+
+    cb_reserve_back(cb_filter0_r, 1);
+    cb_reserve_back(cb_filter0_i, 1);
+    cb_reserve_back(cb_filter1_r, 1);
+    cb_reserve_back(cb_filter1_i, 1);
+    noc_async_read(filter_r_noc_addr + data0_offset, get_write_ptr(cb_filter0_r), chunk_points * 4);
+    noc_async_read(filter_i_noc_addr + data0_offset, get_write_ptr(cb_filter0_i), chunk_points * 4);
+    noc_async_read(filter_r_noc_addr + data1_offset, get_write_ptr(cb_filter1_r), chunk_points * 4);
+    noc_async_read(filter_i_noc_addr + data1_offset, get_write_ptr(cb_filter1_i), chunk_points * 4);
+    noc_async_read_barrier();
+    cb_push_back(cb_filter0_r, 1);
+    cb_push_back(cb_filter0_i, 1);
+    cb_push_back(cb_filter1_r, 1);
+    cb_push_back(cb_filter1_i, 1);
+}
+
+/*
+ * Reconstruct twiddle index (0 to n/2) from the first octant table. With W^k = cos(t) - j*sin(t), the
+ * second octant mirrors the first about n/8 with cos and sin swapped, and the second quadrant follows
+ * from the first by cos(pi/2 + t) = -sin(t) and sin(pi/2 + t) = cos(t)
+ */
+inline void get_compact_twiddle(float * twiddle_data, uint32_t twiddle_index, uint32_t domain_size, float * twiddle_r, float * twiddle_i) {
+    if constexpr (compile_time_domain_size > 0) domain_size=compile_time_domain_size;
+    uint32_t eighth=domain_size/8, quarter=domain_size/4;
+    if (twiddle_index <= eighth) {
+        *twiddle_r=twiddle_data[twiddle_index*2];
+        *twiddle_i=twiddle_data[(twiddle_index*2)+1];
+    } else if (twiddle_index <= quarter) {
+        uint32_t idx=quarter-twiddle_index;
+        *twiddle_r=-twiddle_data[(idx*2)+1];
+        *twiddle_i=-twiddle_data[idx*2];
+    } else if (twiddle_index <= quarter+eighth) {
+        uint32_t idx=twiddle_index-quarter;
+        *twiddle_r=twiddle_data[(idx*2)+1];
+        *twiddle_i=-twiddle_data[idx*2];
+    } else {
+        uint32_t idx=(domain_size/2)-twiddle_index;
+        *twiddle_r=-twiddle_data[idx*2];
+        *twiddle_i=twiddle_data[(idx*2)+1];
+    }
+}
+
 inline void push_cbs(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb_data1_r_id, uint32_t cb_data1_i_id, uint32_t cb_twiddle_r, uint32_t cb_twiddle_i) {
     cb_push_back(cb_twiddle_r, 1);
     cb_push_back(cb_twiddle_i, 1);
@@ -162,6 +476,23 @@ inline void reserve_cbs(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t
     *twiddle_i_addr = (float*) get_write_ptr(cb_twiddle_i);
 }
 
+void generate_twiddles_from_seeds(float * seeds, float * twiddle_data, uint32_t twiddle_seed_stride, uint32_t num_coarse_seeds) {
+    float * fine_seeds=seeds;
+    float * coarse_seeds=&seeds[twiddle_seed_stride*2];
+    uint32_t twiddle_index=0;
+    for (uint32_t i=0; i < num_coarse_seeds; i++) {
+        float coarse_r=coarse_seeds[i*2];
+        float coarse_i=coarse_seeds[(i*2)+1];
+        for (uint32_t j=0; j < twiddle_seed_stride; j++) {
+            float fine_r=fine_seeds[j*2];
+            float fine_i=fine_seeds[(j*2)+1];
+            twiddle_data[twiddle_index*2]=(coarse_r * fine_r) - (coarse_i * fine_i);
+            twiddle_data[(twiddle_index*2)+1]=(coarse_r * fine_i) + (coarse_i * fine_r);
+            twiddle_index++;
+        }
+    }
+}
+
 void bitreverse(float * data, int n) {
   int j=0;
   for (int i=0;i<n-1;i++) {
@@ -30,8 +30,8 @@ void kernel_main() {
     constexpr auto cb_twiddle_r = tt::CBIndex::c_4;
     constexpr auto cb_twiddle_i = tt::CBIndex::c_5;
 
-    constexpr auto cb_out_data_r = tt::CBIndex::c_20;
-    constexpr auto cb_out_data_i = tt::CBIndex::c_21;
+    constexpr auto cb_out_data_r = tt::CBIndex::c_10;
+    constexpr auto cb_out_data_i = tt::CBIndex::c_11;
 
     noc_async_read(twiddle_noc_addr, twiddle_buffer_addr, domain_size * 4);
     noc_async_read_barrier();
@@ -12,13 +12,13 @@ void kernel_main() {
     uint32_t data_i_bank_id = get_arg_val<uint32_t>(3);
     uint32_t domain_size = get_arg_val<uint32_t>(4);
 
-    constexpr auto cb_out_data0_r = tt::CBIndex::c_16;
-    constexpr auto cb_out_data0_i = tt::CBIndex::c_17;
-    constexpr auto cb_out_data1_r = tt::CBIndex::c_18;
-    constexpr auto cb_out_data1_i = tt::CBIndex::c_19;
+    constexpr auto cb_out_data0_r = tt::CBIndex::c_6;
+    constexpr auto cb_out_data0_i = tt::CBIndex::c_7;
+    constexpr auto cb_out_data1_r = tt::CBIndex::c_8;
+    constexpr auto cb_out_data1_i = tt::CBIndex::c_9;
 
-    constexpr auto cb_out_data_r = tt::CBIndex::c_20;
-    constexpr auto cb_out_data_i = tt::CBIndex::c_21;
+    constexpr auto cb_out_data_r = tt::CBIndex::c_10;
+    constexpr auto cb_out_data_i = tt::CBIndex::c_11;
 
     int num_steps=getLog(domain_size);
     for (int step=0; step < num_steps; step++) {
@@ -2,8 +2,12 @@
 #include "../constants.h"
 
 void write_data_to_external(uint64_t, uint64_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
-void write_data_to_CB(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
-void write_stage_data(uint32_t, uint32_t, uint32_t, uint32_t, float*, float*, uint32_t, uint32_t, uint32_t);
+void write_data_to_CB(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, volatile uint32_t*, uint32_t);
+void write_stage_data(uint32_t, uint32_t, uint32_t, uint32_t, float*, float*, uint32_t, uint32_t, uint32_t, volatile uint32_t*, uint32_t);
+void write_contiguous_data_to_external(uint64_t, uint64_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+void write_reduced_data_to_external(uint64_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+void reduce_data_to_external(uint64_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, float);
+inline void reduce_point(uint32_t*, uint32_t, uint32_t, float, uint32_t, float);
 inline void popfront_cbs(uint32_t, uint32_t, uint32_t, uint32_t);
 inline void waitfront_cbs(uint32_t, uint32_t, uint32_t, uint32_t, float**, float**, float**, float**);
 int getLog(int);
@@ -13,7 +17,21 @@ void kernel_main() {
     uint32_t data_i_addr = get_arg_val<uint32_t>(1);
     uint32_t data_r_bank_id = get_arg_val<uint32_t>(2);
     uint32_t data_i_bank_id = get_arg_val<uint32_t>(3);
-    uint32_t domain_size = get_arg_val<uint32_t>(4);
+    uint32_t domain_size = compile_time_domain_size > 0 ? compile_time_domain_size : get_arg_val<uint32_t>(4);
+    // Each frame of a batch is written contiguously after the previous one
+    uint32_t num_frames = get_arg_val<uint32_t>(5);
+    // If set then the number of chunks written so far is published for the reader to pipeline stages against
+    uint32_t pipeline_stages = get_arg_val<uint32_t>(6);
+    uint32_t stage_progress_semaphore = get_arg_val<uint32_t>(7);
+    // If set then the reader computes the first stages itself, and the first stage here is the first one it passes on
+    uint32_t local_substages = get_arg_val<uint32_t>(8);
+    // If set then the compute kernel has reduced the final stage to real values, and there is no imaginary output
+    uint32_t post_stage = get_arg_val<uint32_t>(9);
+    // If set then each frame is reduced to a record of its strongest points, or those over the threshold, in place of the spectrum
+    uint32_t reduction = get_arg_val<uint32_t>(10);
+    uint32_t reduction_capacity = get_arg_val<uint32_t>(11);
+    uint32_t threshold_bits = get_arg_val<uint32_t>(12);
+    float reduction_threshold = *(float*) &threshold_bits;
 
     constexpr auto cb_out_data0_r = tt::CBIndex::c_6;
     constexpr auto cb_out_data0_i = tt::CBIndex::c_7;
@@ -26,52 +44,241 @@ void kernel_main() {
     uint32_t number_chunks = (domain_size /2) / CHUNK_SIZE;
     if (number_chunks * CHUNK_SIZE < domain_size/2) number_chunks++;
 
-    int num_steps=getLog(domain_size);
-    for (int step=0; step < num_steps; step++) {
-        write_data_to_CB(cb_out_data_r, cb_out_data_i, 
-                            cb_out_data0_r, cb_out_data0_i, cb_out_data1_r, cb_out_data1_i, domain_size, number_chunks, step);
-    }
-
     uint64_t data_r_noc_addr = get_noc_addr_from_bank_id<true>(data_r_bank_id, data_r_addr);
     uint64_t data_i_noc_addr = get_noc_addr_from_bank_id<true>(data_i_bank_id, data_i_addr);
 
-    write_data_to_external(data_r_noc_addr, data_i_noc_addr, cb_out_data_r, cb_out_data_i, 
-                            cb_out_data0_r, cb_out_data0_i, cb_out_data1_r, cb_out_data1_i, domain_size, number_chunks, num_steps);
+    volatile uint32_t * stage_progress=pipeline_stages ? (volatile uint32_t*) get_semaphore(stage_progress_semaphore) : NULL;
+
+    int num_steps=getLog(domain_size);
+    uint32_t first_step=get_first_pipelined_step(local_substages, num_steps);
+    for (uint32_t frame=0; frame < num_frames; frame++) {
+        for (int step=first_step; step < num_steps; step++) {
+            uint32_t progress_base=((frame * (num_steps - first_step)) + step - first_step) * number_chunks;
+            write_data_to_CB(cb_out_data_r, cb_out_data_i, 
+                                cb_out_data0_r, cb_out_data0_i, cb_out_data1_r, cb_out_data1_i, domain_size, number_chunks, step,
+                                stage_progress, progress_base);
+        }
+
+        if (reduction != NO_REDUCTION) {
+            uint32_t record_offset=frame * get_reduction_record_size(reduction_capacity) * 4;
+            reduce_data_to_external(data_r_noc_addr + record_offset, cb_out_data_r, cb_out_data0_r, cb_out_data0_i, cb_out_data1_r, cb_out_data1_i,
+                                        domain_size, number_chunks, post_stage, reduction, reduction_capacity, reduction_threshold);
+            continue;
+        }
+        uint32_t frame_offset=frame * domain_size * 4;
+        if (post_stage != NO_POST_STAGE) {
+            write_reduced_data_to_external(data_r_noc_addr + frame_offset, cb_out_data_r, cb_out_data0_r, cb_out_data1_r, domain_size, number_chunks);
+            continue;
+        }
+        write_data_to_external(data_r_noc_addr + frame_offset, data_i_noc_addr + frame_offset, cb_out_data_r, cb_out_data_i, 
+                                cb_out_data0_r, cb_out_data0_i, cb_out_data1_r, cb_out_data1_i, domain_size, number_chunks, num_steps);
+    }
 }
 
 void write_data_to_external(uint64_t data_r_noc_addr, uint64_t data_i_noc_addr, uint32_t cb_target_r_id, uint32_t cb_target_i_id, 
                                 uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb_data1_r_id, uint32_t cb_data1_i_id, 
                                 uint32_t domain_size, uint32_t number_chunks, uint32_t step) {
+    if (domain_size >= MIN_CONTIGUOUS_DOMAIN_SIZE) {
+        write_contiguous_data_to_external(data_r_noc_addr, data_i_noc_addr, cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id,
+                                            domain_size, number_chunks);
+        return;
+    }
     // We use the target CB as a memory staging area to use for data reordering, then write out to DDR
     cb_reserve_back(cb_target_r_id, 1);
     cb_reserve_back(cb_target_i_id, 1);
     float * write_cb_target_r_addr = (float*) get_write_ptr(cb_target_r_id);
     float * write_cb_target_i_addr = (float*) get_write_ptr(cb_target_i_id);
 
+    // Nothing reads the final stage back, so there is no progress to publish
     write_stage_data(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, 
-                        write_cb_target_r_addr, write_cb_target_i_addr, domain_size, number_chunks, step); 
+                        write_cb_target_r_addr, write_cb_target_i_addr, domain_size, number_chunks, step, NULL, 0); 
 
     noc_async_write((uint32_t) write_cb_target_r_addr, data_r_noc_addr, domain_size * 4);
     noc_async_write((uint32_t) write_cb_target_i_addr, data_i_noc_addr, domain_size * 4);
     noc_async_write_barrier();
 
-    cb_push_back(cb_target_r_id, 1);
-    cb_push_back(cb_target_i_id, 1);
+    // The staging page is not pushed, as nothing consumes the final stage and the reader would otherwise
+    // pick it up as the input to the next frame of a batch
+}
+
+/*
+ * The final step produces the points in natural order, each chunk of data 0 and data 1 being a contiguous
+ * run of the first and second half of the domain, so these are written straight to DRAM from the circular
+ * buffers without being staged
+ */
+void write_contiguous_data_to_external(uint64_t data_r_noc_addr, uint64_t data_i_noc_addr, uint32_t cb_data0_r_id, uint32_t cb_data0_i_id,
+                                        uint32_t cb_data1_r_id, uint32_t cb_data1_i_id, uint32_t domain_size, uint32_t number_chunks) {
+    if constexpr (compile_time_domain_size > 0) {
+        domain_size=compile_time_domain_size;
+        number_chunks=((compile_time_domain_size/2) + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    }
+    float *read_cb_data0_r_addr, *read_cb_data0_i_addr, *read_cb_data1_r_addr, *read_cb_data1_i_addr;
+    uint32_t half_domain=domain_size/2;
+
+    for (uint32_t chunk=0; chunk < number_chunks; chunk++) {
+        uint32_t chunk_start=chunk * CHUNK_SIZE;
+        uint32_t chunk_points=half_domain - chunk_start < CHUNK_SIZE ? half_domain - chunk_start : CHUNK_SIZE;
+
+        waitfront_cbs(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, 
+                        &read_cb_data0_r_addr, &read_cb_data0_i_addr, &read_cb_data1_r_addr, &read_cb_data1_i_addr);
+        noc_async_write((uint32_t) read_cb_data0_r_addr, data_r_noc_addr + (chunk_start * 4), chunk_points * 4);
+        noc_async_write((uint32_t) read_cb_data0_i_addr, data_i_noc_addr + (chunk_start * 4), chunk_points * 4);
+        noc_async_write((uint32_t) read_cb_data1_r_addr, data_r_noc_addr + ((half_domain + chunk_start) * 4), chunk_points * 4);
+        noc_async_write((uint32_t) read_cb_data1_i_addr, data_i_noc_addr + ((half_domain + chunk_start) * 4), chunk_points * 4);
+        // The pages must be written out before they are handed back to the compute kernel
+        noc_async_write_barrier();
+        popfront_cbs(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id);
+    }
+}
+
+/*
+ * The reduced final stage is in natural order as write_contiguous_data_to_external, but with only the real CBs. Below
+ * the contiguous size the whole domain is in one chunk, which is staged so that it is written in a single transfer
+ */
+void write_reduced_data_to_external(uint64_t data_noc_addr, uint32_t cb_target_id, uint32_t cb_data0_id, uint32_t cb_data1_id,
+                                        uint32_t domain_size, uint32_t number_chunks) {
+    uint32_t half_domain=domain_size/2;
+    if (domain_size < MIN_CONTIGUOUS_DOMAIN_SIZE) {
+        cb_reserve_back(cb_target_id, 1);
+        float * write_cb_target_addr = (float*) get_write_ptr(cb_target_id);
+        cb_wait_front(cb_data1_id, 1);
+        cb_wait_front(cb_data0_id, 1);
+        float * read_cb_data0_addr = (float*) get_read_ptr(cb_data0_id);
+        float * read_cb_data1_addr = (float*) get_read_ptr(cb_data1_id);
+        for (uint32_t i=0; i < half_domain; i++) {
+            write_cb_target_addr[i]=read_cb_data0_addr[i];
+            write_cb_target_addr[half_domain + i]=read_cb_data1_addr[i];
+        }
+        cb_pop_front(cb_data1_id, 1);
+        cb_pop_front(cb_data0_id, 1);
+        noc_async_write((uint32_t) write_cb_target_addr, data_noc_addr, domain_size * 4);
+        noc_async_write_barrier();
+        // Not pushed, as with the staging page of write_data_to_external
+        return;
+    }
+
+    for (uint32_t chunk=0; chunk < number_chunks; chunk++) {
+        uint32_t chunk_start=chunk * CHUNK_SIZE;
+        uint32_t chunk_points=half_domain - chunk_start < CHUNK_SIZE ? half_domain - chunk_start : CHUNK_SIZE;
+
+        cb_wait_front(cb_data1_id, 1);
+        cb_wait_front(cb_data0_id, 1);
+        noc_async_write(get_read_ptr(cb_data0_id), data_noc_addr + (chunk_start * 4), chunk_points * 4);
+        noc_async_write(get_read_ptr(cb_data1_id), data_noc_addr + ((half_domain + chunk_start) * 4), chunk_points * 4);
+        noc_async_write_barrier();
+        cb_pop_front(cb_data1_id, 1);
+        cb_pop_front(cb_data0_id, 1);
+    }
+}
+
+/*
+ * Reduces the final stage of a frame to its record, which is built in the staging page and written in one transfer. The
+ * value of a point is its power, or the post stage result if there is one (just the real CBs are then present), which
+ * orders points the same. The final stage is in natural order, so each chunk is a run of each half of the domain
+ */
+void reduce_data_to_external(uint64_t data_noc_addr, uint32_t cb_target_id, uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb_data1_r_id,
+                                uint32_t cb_data1_i_id, uint32_t domain_size, uint32_t number_chunks, uint32_t post_stage, uint32_t reduction,
+                                uint32_t capacity, float threshold) {
+    cb_reserve_back(cb_target_id, 1);
+    uint32_t * record = (uint32_t*) get_write_ptr(cb_target_id);
+    record[0]=0;
+    uint32_t half_domain=domain_size/2;
+    bool complex_points=post_stage == NO_POST_STAGE;
+
+    for (uint32_t chunk=0; chunk < number_chunks; chunk++) {
+        uint32_t chunk_start=chunk * CHUNK_SIZE;
+        uint32_t chunk_points=half_domain - chunk_start < CHUNK_SIZE ? half_domain - chunk_start : CHUNK_SIZE;
+
+        cb_wait_front(cb_data1_r_id, 1);
+        cb_wait_front(cb_data0_r_id, 1);
+        if (complex_points) {
+            cb_wait_front(cb_data1_i_id, 1);
+            cb_wait_front(cb_data0_i_id, 1);
+        }
+        float * data0_r = (float*) get_read_ptr(cb_data0_r_id);
+        float * data1_r = (float*) get_read_ptr(cb_data1_r_id);
+        float * data0_i = complex_points ? (float*) get_read_ptr(cb_data0_i_id) : NULL;
+        float * data1_i = complex_points ? (float*) get_read_ptr(cb_data1_i_id) : NULL;
+        for (uint32_t i=0; i < chunk_points; i++) {
+            float value0=complex_points ? (data0_r[i] * data0_r[i]) + (data0_i[i] * data0_i[i]) : data0_r[i];
+            float value1=complex_points ? (data1_r[i] * data1_r[i]) + (data1_i[i] * data1_i[i]) : data1_r[i];
+            reduce_point(record, reduction, capacity, threshold, chunk_start + i, value0);
+            reduce_point(record, reduction, capacity, threshold, half_domain + chunk_start + i, value1);
+        }
+        cb_pop_front(cb_data1_r_id, 1);
+        cb_pop_front(cb_data0_r_id, 1);
+        if (complex_points) {
+            cb_pop_front(cb_data1_i_id, 1);
+            cb_pop_front(cb_data0_i_id, 1);
+        }
+    }
+
+    noc_async_write((uint32_t) record, data_noc_addr, get_reduction_record_size(capacity) * 4);
+    noc_async_write_barrier();
+    // Not pushed, as with the staging page of write_data_to_external
+}
+
+/*
+ * Inserts a point into the pairs held after the count at the start of the record, which are ordered best first. Top-K
+ * holds the largest values with ties to the lower index, and threshold compaction holds the lowest indices whose value
+ * is at least the threshold whilst counting all of them. The points arrive a chunk of each half at a time rather than in
+ * index order, so both insert by position
+ */
+inline void reduce_point(uint32_t * record, uint32_t reduction, uint32_t capacity, float threshold, uint32_t index, float value) {
+    uint32_t held;
+    if (reduction == THRESHOLD_REDUCTION) {
+        if (!(value >= threshold)) return;
+        held=record[0] < capacity ? record[0] : capacity;
+        record[0]++;
+    } else {
+        held=record[0];
+        if (held < capacity) record[0]++;
+    }
+
+    uint32_t * pairs=&record[1];
+    uint32_t position=held;
+    while (position > 0) {
+        uint32_t held_index=pairs[(position-1)*2];
+        float held_value=*(float*) &pairs[((position-1)*2)+1];
+        bool precedes=reduction == THRESHOLD_REDUCTION ? index < held_index :
+                        value > held_value || (value == held_value && index < held_index);
+        if (!precedes) break;
+        position--;
+    }
+    if (position >= capacity) return;
+
+    // The last held pair drops off the end once the record is full
+    for (uint32_t j=(held < capacity ? held : capacity - 1); j > position; j--) {
+        pairs[j*2]=pairs[(j-1)*2];
+        pairs[(j*2)+1]=pairs[((j-1)*2)+1];
+    }
+    pairs[position*2]=index;
+    *(float*) &pairs[(position*2)+1]=value;
 }
 
 void write_data_to_CB(uint32_t cb_target_r_id, uint32_t cb_target_i_id, uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb_data1_r_id, uint32_t cb_data1_i_id, 
-                        uint32_t domain_size, uint32_t number_chunks, uint32_t step) {
+                        uint32_t domain_size, uint32_t number_chunks, uint32_t step, volatile uint32_t * stage_progress, uint32_t progress_base) {
     cb_reserve_back(cb_target_r_id, 1);
     cb_reserve_back(cb_target_i_id, 1);
     float * write_cb_target_r_addr = (float*) get_write_ptr(cb_target_r_id);
     float * write_cb_target_i_addr = (float*) get_write_ptr(cb_target_i_id);
-    write_stage_data(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, write_cb_target_r_addr, write_cb_target_i_addr, domain_size, number_chunks, step);
+    write_stage_data(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, write_cb_target_r_addr, write_cb_target_i_addr, domain_size, number_chunks, step,
+                        stage_progress, progress_base);
     cb_push_back(cb_target_r_id, 1);
     cb_push_back(cb_target_i_id, 1);
 }
 
+/*
+ * If stage_progress is set then it is updated after each chunk is scattered, to progress_base plus the chunks
+ * of this stage written so far, so the reader can start on the next stage before this one completes
+ */
 void write_stage_data(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb_data1_r_id, uint32_t cb_data1_i_id, float * out_r_data, float * out_i_data, 
-                        uint32_t domain_size, uint32_t number_chunks, uint32_t step) {
+                        uint32_t domain_size, uint32_t number_chunks, uint32_t step, volatile uint32_t * stage_progress, uint32_t progress_base) {
+    if constexpr (compile_time_domain_size > 0) {
+        // Constant for a plan, so the loop bounds and index arithmetic below reduce to shifts of constants
+        domain_size=compile_time_domain_size;
+        number_chunks=((compile_time_domain_size/2) + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    }
     float *read_cb_data0_r_addr, *read_cb_data0_i_addr, *read_cb_data1_r_addr, *read_cb_data1_i_addr;
 
     waitfront_cbs(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id, 
@@ -99,6 +306,7 @@ void write_stage_data(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t c
                 chunks_computed++;
                 if (chunks_computed < number_chunks) {
                     popfront_cbs(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id);                    
+                    if (stage_progress != NULL) noc_semaphore_set(stage_progress, progress_base + chunks_computed);
                     waitfront_cbs(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id,
                                     &read_cb_data0_r_addr, &read_cb_data0_i_addr, &read_cb_data1_r_addr, &read_cb_data1_i_addr);
                     tgt_data_idx=0;
@@ -107,6 +315,7 @@ void write_stage_data(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t c
         }
     }
     popfront_cbs(cb_data0_r_id, cb_data0_i_id, cb_data1_r_id, cb_data1_i_id);
+    if (stage_progress != NULL) noc_semaphore_set(stage_progress, progress_base + number_chunks);
 }
 
 inline void popfront_cbs(uint32_t cb_data0_r_id, uint32_t cb_data0_i_id, uint32_t cb_data1_r_id, uint32_t cb_data1_i_id) {
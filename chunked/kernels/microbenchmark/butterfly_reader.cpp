@@ -0,0 +1,51 @@
+#include <stdint.h>
+#include "dataflow_api.h"
+#include "../constants.h"
+
+int getLog(int);
+
+/*
+ * Feeds the compute kernel as the reader does, but with chunks that are pushed as soon as there is space rather
+ * than gathered, so the compute kernel runs alone. The chunks are whatever is in the circular buffers, the
+ * butterflies take the same time whatever the values. As many chunks are pushed as the compute kernel takes
+ * over num_frames frames of domain_size points, each of every stage
+ */
+void kernel_main() {
+    uint32_t domain_size = get_arg_val<uint32_t>(0);
+    uint32_t num_frames = get_arg_val<uint32_t>(1);
+
+    constexpr auto cb_data0_r = tt::CBIndex::c_0;
+    constexpr auto cb_data0_i = tt::CBIndex::c_1;
+    constexpr auto cb_data1_r = tt::CBIndex::c_2;
+    constexpr auto cb_data1_i = tt::CBIndex::c_3;
+    constexpr auto cb_twiddle_r = tt::CBIndex::c_4;
+    constexpr auto cb_twiddle_i = tt::CBIndex::c_5;
+
+    uint32_t number_chunks = (domain_size/2) / CHUNK_SIZE;
+    if (number_chunks * CHUNK_SIZE < domain_size/2) number_chunks++;
+    uint32_t total_chunks=num_frames * (getLog(domain_size) + 1) * number_chunks;
+
+    for (uint32_t chunk=0; chunk < total_chunks; chunk++) {
+        cb_reserve_back(cb_data0_r, 1);
+        cb_reserve_back(cb_data0_i, 1);
+        cb_reserve_back(cb_data1_r, 1);
+        cb_reserve_back(cb_data1_i, 1);
+        cb_reserve_back(cb_twiddle_r, 1);
+        cb_reserve_back(cb_twiddle_i, 1);
+        cb_push_back(cb_data0_r, 1);
+        cb_push_back(cb_data0_i, 1);
+        cb_push_back(cb_data1_r, 1);
+        cb_push_back(cb_data1_i, 1);
+        cb_push_back(cb_twiddle_r, 1);
+        cb_push_back(cb_twiddle_i, 1);
+    }
+}
+
+int getLog(int n) {
+   int logn=0;
+   n >>= 1;
+   while ((n >>=1) > 0) {
+      logn++;
+   }
+   return logn;
+}
@@ -0,0 +1,64 @@
+#include <stdint.h>
+#include "dataflow_api.h"
+#include "../constants.h"
+
+int getLog(int);
+inline uint64_t read_wall_clock();
+
+/*
+ * Drains the compute kernel's results without scattering them, and writes the cycles from the start of the
+ * launch until the last chunk of num_frames frames is popped to DRAM. With butterfly_reader this times the
+ * compute kernel alone, the data movers doing nothing but circular buffer accounting
+ */
+void kernel_main() {
+    uint32_t domain_size = get_arg_val<uint32_t>(0);
+    uint32_t num_frames = get_arg_val<uint32_t>(1);
+    uint32_t results_addr = get_arg_val<uint32_t>(2);
+    uint32_t results_bank_id = get_arg_val<uint32_t>(3);
+    // Scratch in L1 that the results are written to DRAM from
+    uint32_t results_buffer_addr = get_arg_val<uint32_t>(4);
+
+    constexpr auto cb_out_data0_r = tt::CBIndex::c_6;
+    constexpr auto cb_out_data0_i = tt::CBIndex::c_7;
+    constexpr auto cb_out_data1_r = tt::CBIndex::c_8;
+    constexpr auto cb_out_data1_i = tt::CBIndex::c_9;
+
+    uint32_t number_chunks = (domain_size/2) / CHUNK_SIZE;
+    if (number_chunks * CHUNK_SIZE < domain_size/2) number_chunks++;
+    uint32_t total_chunks=num_frames * (getLog(domain_size) + 1) * number_chunks;
+
+    uint64_t start_cycles=read_wall_clock();
+    for (uint32_t chunk=0; chunk < total_chunks; chunk++) {
+        cb_wait_front(cb_out_data1_r, 1);
+        cb_wait_front(cb_out_data1_i, 1);
+        cb_wait_front(cb_out_data0_r, 1);
+        cb_wait_front(cb_out_data0_i, 1);
+        cb_pop_front(cb_out_data1_r, 1);
+        cb_pop_front(cb_out_data1_i, 1);
+        cb_pop_front(cb_out_data0_r, 1);
+        cb_pop_front(cb_out_data0_i, 1);
+    }
+    uint64_t cycles=read_wall_clock() - start_cycles;
+
+    uint32_t * results=(uint32_t*) results_buffer_addr;
+    results[0]=(uint32_t) cycles;
+    results[1]=(uint32_t) (cycles >> 32);
+    noc_async_write(results_buffer_addr, get_noc_addr_from_bank_id<true>(results_bank_id, results_addr), 8);
+    noc_async_write_barrier();
+}
+
+// The core's wall clock, which counts cycles of the AI clock
+inline uint64_t read_wall_clock() {
+    uint32_t low=reg_read(RISCV_DEBUG_REG_WALL_CLOCK_L);
+    uint32_t high=reg_read(RISCV_DEBUG_REG_WALL_CLOCK_H);
+    return (((uint64_t) high) << 32) | low;
+}
+
+int getLog(int n) {
+   int logn=0;
+   n >>= 1;
+   while ((n >>=1) > 0) {
+      logn++;
+   }
+   return logn;
+}
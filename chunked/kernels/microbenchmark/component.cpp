@@ -0,0 +1,133 @@
+#include <stdint.h>
+#include "dataflow_api.h"
+#include "../constants.h"
+
+void run_stage(float*, float*, float*, float*, float*, float*, float*, float*, float*, uint32_t, uint32_t, uint32_t, uint32_t);
+void bitreverse(float*, int);
+int getLog(int);
+inline uint64_t read_wall_clock();
+
+/*
+ * Runs one data movement component of the pipeline alone, repeats times over a domain held in L1, and writes the
+ * cycles taken to DRAM. The gather, twiddles and scatter are run for every stage, and bit reversal once, as in a
+ * transform. The loops are those of the reader and writer, but chunks are gathered into and scattered from scratch
+ * arrays of chunk_size points rather than circular buffers, so no other kernel is needed to consume them. The data
+ * is whatever is in L1, which these components do not depend on
+ */
+void kernel_main() {
+    // Laid out as real data, imaginary data and the full twiddle table, each of domain_size floats, then the
+    // scratch chunks of data 0 and data 1 (real and imaginary) and the twiddles, each of chunk_size floats
+    uint32_t l1_buffer_addr = get_arg_val<uint32_t>(0);
+    uint32_t domain_size = get_arg_val<uint32_t>(1);
+    uint32_t chunk_size = get_arg_val<uint32_t>(2);
+    uint32_t repeats = get_arg_val<uint32_t>(3);
+    uint32_t results_addr = get_arg_val<uint32_t>(4);
+    uint32_t results_bank_id = get_arg_val<uint32_t>(5);
+
+    float * data_r=(float*) l1_buffer_addr;
+    float * data_i=data_r + domain_size;
+    float * twiddle_data=data_i + domain_size;
+    float * chunk_data0_r=twiddle_data + domain_size;
+    float * chunk_data0_i=chunk_data0_r + chunk_size;
+    float * chunk_data1_r=chunk_data0_i + chunk_size;
+    float * chunk_data1_i=chunk_data1_r + chunk_size;
+    float * chunk_twiddle_r=chunk_data1_i + chunk_size;
+    float * chunk_twiddle_i=chunk_twiddle_r + chunk_size;
+
+    int num_steps=getLog(domain_size);
+
+    uint64_t start_cycles=read_wall_clock();
+    for (uint32_t repeat=0; repeat < repeats; repeat++) {
+#if COMPONENT == BITREVERSE_COMPONENT
+        bitreverse(data_r, domain_size);
+        bitreverse(data_i, domain_size);
+#else
+        for (int step=0; step <= num_steps; step++) {
+            run_stage(data_r, data_i, twiddle_data, chunk_data0_r, chunk_data0_i, chunk_data1_r, chunk_data1_i, chunk_twiddle_r, chunk_twiddle_i,
+                        domain_size, chunk_size, num_steps, step);
+        }
+#endif
+    }
+    uint64_t cycles=read_wall_clock() - start_cycles;
+
+    // The cycles as low and high words, written from the first scratch chunk, which is no longer needed
+    uint32_t * results=(uint32_t*) chunk_data0_r;
+    results[0]=(uint32_t) cycles;
+    results[1]=(uint32_t) (cycles >> 32);
+    noc_async_write((uint32_t) results, get_noc_addr_from_bank_id<true>(results_bank_id, results_addr), 8);
+    noc_async_write_barrier();
+}
+
+/*
+ * The component's part of one stage, with the loop of read_stage_data and write_stage_data. The chunk index wraps
+ * where the reader pushes and the writer pops a page
+ */
+void run_stage(float * data_r, float * data_i, float * twiddle_data, float * chunk_data0_r, float * chunk_data0_i, float * chunk_data1_r,
+                float * chunk_data1_i, float * chunk_twiddle_r, float * chunk_twiddle_i, uint32_t domain_size, uint32_t chunk_size,
+                uint32_t num_steps, uint32_t step) {
+    uint32_t num_spectra_in_step=step == 0 ? 1 : 2 << (step-1);
+    uint32_t increment_next_point_in_step=2 << step;
+    uint32_t matching_second_point=increment_next_point_in_step/2;
+
+    uint32_t tgt_data_idx=0;
+    for (uint32_t spectra=0; spectra < num_spectra_in_step; spectra++) {
+#if COMPONENT == TWIDDLE_COMPONENT
+        uint32_t twiddle_index=spectra << (num_steps-step);
+        float twiddle_r=twiddle_data[twiddle_index*2];
+        float twiddle_i=twiddle_data[(twiddle_index*2)+1];
+#endif
+        for (uint32_t point=0; point < domain_size; point+=increment_next_point_in_step) {
+            uint32_t d0_data_index=spectra + point;
+            uint32_t d1_data_index=spectra + point + matching_second_point;
+#if COMPONENT == GATHER_COMPONENT
+            chunk_data0_r[tgt_data_idx]=data_r[d0_data_index];
+            chunk_data0_i[tgt_data_idx]=data_i[d0_data_index];
+            chunk_data1_r[tgt_data_idx]=data_r[d1_data_index];
+            chunk_data1_i[tgt_data_idx]=data_i[d1_data_index];
+#elif COMPONENT == TWIDDLE_COMPONENT
+            chunk_twiddle_r[tgt_data_idx]=twiddle_r;
+            chunk_twiddle_i[tgt_data_idx]=twiddle_i;
+#elif COMPONENT == SCATTER_COMPONENT
+            data_r[d0_data_index]=chunk_data0_r[tgt_data_idx];
+            data_r[d1_data_index]=chunk_data1_r[tgt_data_idx];
+            data_i[d0_data_index]=chunk_data0_i[tgt_data_idx];
+            data_i[d1_data_index]=chunk_data1_i[tgt_data_idx];
+#endif
+            tgt_data_idx++;
+            if (tgt_data_idx == chunk_size) tgt_data_idx=0;
+        }
+    }
+}
+
+// The core's wall clock, which counts cycles of the AI clock
+inline uint64_t read_wall_clock() {
+    uint32_t low=reg_read(RISCV_DEBUG_REG_WALL_CLOCK_L);
+    uint32_t high=reg_read(RISCV_DEBUG_REG_WALL_CLOCK_H);
+    return (((uint64_t) high) << 32) | low;
+}
+
+void bitreverse(float * data, int n) {
+  int j=0;
+  for (int i=0;i<n-1;i++) {
+    if (i < j) {
+      float temp_val=data[i];
+      data[i]=data[j];
+      data[j]=temp_val;
+    }
+    int k=n >> 1;
+    while (k <= j) {
+      j -= k;
+      k >>= 1;
+    }
+    j+=k;
+  }
+}
+
+int getLog(int n) {
+   int logn=0;
+   n >>= 1;
+   while ((n >>=1) > 0) {
+      logn++;
+   }
+   return logn;
+}
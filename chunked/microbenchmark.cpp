@@ -0,0 +1,275 @@
+#include "fft.h"
+#include <x86intrin.h>
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+// Passes of each component in a timed launch, or frames of the butterfly, and on the host
+#define MICROBENCHMARK_REPEATS 10
+// The harness kernels write the cycles to DRAM as two words, padded to the DRAM write alignment
+#define MICROBENCHMARK_RESULTS_SIZE 64
+// The compute kernel works a tile page at a time, so its chunks are always this size (CHUNK_SIZE in kernels/constants.h)
+#define BUTTERFLY_CHUNK_SIZE 512
+
+// Indexed by FFTComponent
+static const char * component_names[]={"bitreverse", "gather", "twiddle", "butterfly", "scatter"};
+
+// Read after each host pass, so that the stores of the pass are not optimised away
+static volatile float microbenchmark_sink;
+
+static uint64_t deviceComponentCycles(IDevice*, CommandQueue&, enum FFTComponent, uint32_t, uint32_t, enum FFTComputeBackend);
+static uint64_t hostComponentCycles(enum FFTComponent, uint32_t, uint32_t);
+static void hostStage(enum FFTComponent, float*, float*, float*, float*, uint32_t, uint32_t, uint32_t, uint32_t);
+static uint64_t getComponentElements(enum FFTComponent, uint32_t);
+static uint32_t getComponentL1Size(uint32_t, uint32_t);
+
+// Returns the component named, or -1 if there is no such component
+int parseFFTComponent(const char * name) {
+    for (int i=0;i<(int) (sizeof(component_names) / sizeof(component_names[0]));i++) {
+        if (strcmp(name, component_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/*
+ * For power of two domains from 2 up to max_domain_size, times each component of the pipeline alone (or just the one
+ * given, if component is not negative) and reports the cycles per element. An element is a point through one pass of
+ * the component, so one stage for all but bit reversal, which is once per transform. The device cycles are counted by
+ * the harness kernels on the core's wall clock, with the gather, twiddles and scatter in chunks of chunk_size. The host
+ * cycles are of the same loops in single precision on the host, counted by the time stamp counter. If device is NULL
+ * then just the host is timed, as it is for the sizes whose harness does not fit in a core's L1
+ */
+void runMicrobenchmarks(IDevice* device, CommandQueue * cq, int component, uint32_t max_domain_size, uint32_t chunk_size,
+                        enum FFTComputeBackend compute_backend) {
+    uint32_t num_components=sizeof(component_names) / sizeof(component_names[0]);
+
+    uint64_t device_l1_unreserved_bytes=device != NULL ? device->l1_size_per_core() - L1_RESERVED_SIZE : 0;
+
+    printf("%10s %8s %11s %16s %16s\n", "Size", "Chunk", "Component", "Device cyc/elem", "Host cyc/elem");
+    for (uint32_t domain_size=2;domain_size<=max_domain_size;domain_size<<=1) {
+        for (uint32_t c=0;c<num_components;c++) {
+            if (component >= 0 && c != (uint32_t) component) continue;
+            enum FFTComponent timed_component=(enum FFTComponent) c;
+            // A stage is domain_size/2 butterflies, so a larger chunk is never filled
+            uint32_t component_chunk_size=timed_component == BUTTERFLY_COMPONENT ? BUTTERFLY_CHUNK_SIZE : std::min(chunk_size, domain_size/2);
+            double elements=(double) getComponentElements(timed_component, domain_size) * MICROBENCHMARK_REPEATS;
+            double host_cycles=hostComponentCycles(timed_component, domain_size, component_chunk_size) / elements;
+            // The harness of the data movement components holds the whole domain in L1, which the largest sizes outgrow
+            bool fits_l1=timed_component == BUTTERFLY_COMPONENT ||
+                            getComponentL1Size(domain_size, component_chunk_size) <= device_l1_unreserved_bytes;
+            if (device != NULL && fits_l1) {
+                double device_cycles=deviceComponentCycles(device, *cq, timed_component, domain_size, component_chunk_size, compute_backend) / elements;
+                printf("%10d %8d %11s %16.3f %16.3f\n", domain_size, component_chunk_size, component_names[c], device_cycles, host_cycles);
+            } else {
+                printf("%10d %8d %11s %16s %16.3f\n", domain_size, component_chunk_size, component_names[c], "-", host_cycles);
+            }
+        }
+    }
+}
+
+/*
+ * Launches the component's harness on one core. The butterfly is the compute kernel as built for the pipeline, fed
+ * and drained by data movers that do nothing else, the other components are a single data movement kernel
+ */
+static uint64_t deviceComponentCycles(IDevice* device, CommandQueue& cq, enum FFTComponent component, uint32_t domain_size,
+                                        uint32_t chunk_size, enum FFTComputeBackend compute_backend) {
+    Program program=CreateProgram();
+    CoreCoord core={0, 0};
+    // The harness kernels include constants.h, so take the compile time arguments of the generic kernels
+    std::vector<uint32_t> compile_args={0, 0};
+
+    tt_metal::InterleavedBufferConfig results_dram_config{
+        .device = device,
+        .size = MICROBENCHMARK_RESULTS_SIZE,
+        .page_size = MICROBENCHMARK_RESULTS_SIZE,
+        .buffer_type = tt_metal::BufferType::DRAM};
+    std::shared_ptr<Buffer> results_dram_buffer=CreateBuffer(results_dram_config);
+
+    // Held until the launch completes
+    std::shared_ptr<Buffer> l1_buffer;
+    if (component == BUTTERFLY_COMPONENT) {
+        uint32_t num_pages[NUM_CHUNKED_CBS], page_sizes[NUM_CHUNKED_CBS];
+        getChunkedCBLayout(domain_size, false, num_pages, page_sizes);
+        for (uint32_t cb=0; cb < NUM_CHUNKED_CBS; cb++) {
+            // The staging pages are the writer's, which the harness does not scatter into
+            if (cb == CBIndex::c_10 || cb == CBIndex::c_11 || num_pages[cb] == 0) continue;
+            createCB(program, core, cb, num_pages[cb], page_sizes[cb]);
+        }
+        tt::tt_metal::InterleavedBufferConfig l1_results_buffer_config{
+            .device= device,
+            .size = MICROBENCHMARK_RESULTS_SIZE,
+            .page_size = MICROBENCHMARK_RESULTS_SIZE,
+            .buffer_type = tt::tt_metal::BufferType::L1};
+        l1_buffer=CreateBuffer(l1_results_buffer_config);
+
+        KernelHandle reader_kernel_id=CreateKernel(
+            program,
+            "kernels/microbenchmark/butterfly_reader.cpp",
+            core,
+            DataMovementConfig{.processor = DataMovementProcessor::RISCV_1, .noc = NOC::RISCV_1_default, .compile_args = compile_args});
+        KernelHandle writer_kernel_id=CreateKernel(
+            program,
+            "kernels/microbenchmark/butterfly_writer.cpp",
+            core,
+            DataMovementConfig{.processor = DataMovementProcessor::RISCV_0, .noc = NOC::RISCV_0_default, .compile_args = compile_args});
+        KernelHandle compute_kernel_id=CreateKernel(
+            program,
+            "kernels/compute/compute.cpp",
+            core,
+            ComputeConfig{
+                .math_fidelity = MathFidelity::HiFi4,
+                .fp32_dest_acc_en = false,
+                .math_approx_mode = false,
+                .compile_args = compile_args,
+                .defines = {{"COMPUTE_BACKEND", std::to_string(compute_backend)}},
+            });
+        SetRuntimeArgs(program, reader_kernel_id, core, {domain_size, MICROBENCHMARK_REPEATS});
+        SetRuntimeArgs(program, writer_kernel_id, core, {domain_size, MICROBENCHMARK_REPEATS, (uint32_t) results_dram_buffer->address(), 0,
+                                                            (uint32_t) l1_buffer->address()});
+        // A forward transform of each frame, without a filter multiply, local stages or a post stage
+        SetRuntimeArgs(program, compute_kernel_id, core, {FFT_FORWARD, domain_size, 0, MICROBENCHMARK_REPEATS, 0, NO_POST_STAGE});
+    } else {
+        uint32_t l1_buffer_size=getComponentL1Size(domain_size, chunk_size);
+        tt::tt_metal::InterleavedBufferConfig l1_buffer_config{
+            .device= device,
+            .size = l1_buffer_size,
+            .page_size = l1_buffer_size,
+            .buffer_type = tt::tt_metal::BufferType::L1};
+        l1_buffer=CreateBuffer(l1_buffer_config);
+
+        KernelHandle component_kernel_id=CreateKernel(
+            program,
+            "kernels/microbenchmark/component.cpp",
+            core,
+            DataMovementConfig{.processor = DataMovementProcessor::RISCV_1, .noc = NOC::RISCV_1_default, .compile_args = compile_args,
+                                .defines = {{"COMPONENT", std::to_string(component)}}});
+        SetRuntimeArgs(program, component_kernel_id, core, {(uint32_t) l1_buffer->address(), domain_size, chunk_size, MICROBENCHMARK_REPEATS,
+                                                                (uint32_t) results_dram_buffer->address(), 0});
+    }
+
+    uint32_t results[MICROBENCHMARK_RESULTS_SIZE / 4];
+    EnqueueProgram(cq, program, false);
+    EnqueueReadBuffer(cq, results_dram_buffer, results, true);
+    return (((uint64_t) results[1]) << 32) | results[0];
+}
+
+// The same loops as the harness kernels, and for the butterfly the arithmetic of the compute kernel for each kind of chunk
+static uint64_t hostComponentCycles(enum FFTComponent component, uint32_t domain_size, uint32_t chunk_size) {
+    // As getLog in the kernels, the stages are steps zero to num_steps
+    uint32_t num_steps=30 - __builtin_clz(domain_size);
+    float * data_r=(float*) malloc(sizeof(float) * domain_size);
+    float * data_i=(float*) malloc(sizeof(float) * domain_size);
+    float * twiddle_data=computeTwiddleFactors(domain_size);
+    // Data 0 and data 1 (real and imaginary) then the twiddles, the butterfly writes its results in place
+    float * chunks=(float*) malloc(sizeof(float) * 6 * chunk_size);
+    for (uint32_t i=0;i<domain_size;i++) {
+        data_r[i]=(float) rand()/(float) RAND_MAX;
+        data_i[i]=(float) rand()/(float) RAND_MAX;
+    }
+    for (uint32_t i=0;i<6 * chunk_size;i++) chunks[i]=(float) rand()/(float) RAND_MAX;
+
+    uint64_t start_cycles=__rdtsc();
+    for (uint32_t repeat=0;repeat<MICROBENCHMARK_REPEATS;repeat++) {
+        if (component == BITREVERSE_COMPONENT) {
+            hostStage(component, data_r, data_i, twiddle_data, chunks, domain_size, chunk_size, num_steps, 0);
+        } else {
+            for (uint32_t step=0;step<=num_steps;step++) {
+                hostStage(component, data_r, data_i, twiddle_data, chunks, domain_size, chunk_size, num_steps, step);
+            }
+        }
+        microbenchmark_sink=data_r[repeat % domain_size] + chunks[repeat % chunk_size];
+    }
+    uint64_t cycles=__rdtsc() - start_cycles;
+
+    free(data_r);
+    free(data_i);
+    free(twiddle_data);
+    free(chunks);
+    return cycles;
+}
+
+/*
+ * One pass of the component, which for all but bit reversal is its part of stage step. The chunk index wraps where
+ * the reader pushes and the writer pops a page, and the butterfly computes each chunk as it is wrapped
+ */
+static void hostStage(enum FFTComponent component, float * data_r, float * data_i, float * twiddle_data, float * chunks, uint32_t domain_size,
+                        uint32_t chunk_size, uint32_t num_steps, uint32_t step) {
+    float * chunk_data0_r=chunks;
+    float * chunk_data0_i=chunk_data0_r + chunk_size;
+    float * chunk_data1_r=chunk_data0_i + chunk_size;
+    float * chunk_data1_i=chunk_data1_r + chunk_size;
+    float * chunk_twiddle_r=chunk_data1_i + chunk_size;
+    float * chunk_twiddle_i=chunk_twiddle_r + chunk_size;
+
+    if (component == BITREVERSE_COMPONENT) {
+        emulateBitreverse(data_r, domain_size);
+        emulateBitreverse(data_i, domain_size);
+        return;
+    }
+    if (component == BUTTERFLY_COMPONENT) {
+        for (uint32_t butterfly=0;butterfly<domain_size/2;butterfly+=chunk_size) {
+            uint32_t chunk_points=(domain_size/2) - butterfly < chunk_size ? (domain_size/2) - butterfly : chunk_size;
+            // As the compute kernel, the multiply is skipped for chunks that are all the unit twiddle or all -j
+            enum EmulatedTwiddleKind twiddle_kind=emulateChunkTwiddleKind(step, butterfly / chunk_size, domain_size, num_steps);
+            for (uint32_t i=0;i<chunk_points;i++) {
+                float f0, f1;
+                if (twiddle_kind == UNIT_TWIDDLE) {
+                    f0=chunk_data1_r[i];
+                    f1=chunk_data1_i[i];
+                } else if (twiddle_kind == MINUS_J_TWIDDLE) {
+                    f0=chunk_data1_i[i];
+                    f1=-chunk_data1_r[i];
+                } else {
+                    f0=(chunk_data1_r[i] * chunk_twiddle_r[i]) - (chunk_data1_i[i] * chunk_twiddle_i[i]);
+                    f1=(chunk_data1_r[i] * chunk_twiddle_i[i]) + (chunk_data1_i[i] * chunk_twiddle_r[i]);
+                }
+                chunk_data1_r[i]=chunk_data0_r[i] - f0;
+                chunk_data1_i[i]=chunk_data0_i[i] - f1;
+                chunk_data0_r[i]=chunk_data0_r[i] + f0;
+                chunk_data0_i[i]=chunk_data0_i[i] + f1;
+            }
+        }
+        return;
+    }
+
+    uint32_t num_spectra_in_step=step == 0 ? 1 : 2 << (step-1);
+    uint32_t increment_next_point_in_step=2 << step;
+    uint32_t matching_second_point=increment_next_point_in_step/2;
+    uint32_t tgt_data_idx=0;
+    for (uint32_t spectra=0; spectra < num_spectra_in_step; spectra++) {
+        uint32_t twiddle_index=spectra << (num_steps-step);
+        float twiddle_r=twiddle_data[twiddle_index*2];
+        float twiddle_i=twiddle_data[(twiddle_index*2)+1];
+        for (uint32_t point=0; point < domain_size; point+=increment_next_point_in_step) {
+            uint32_t d0_data_index=spectra + point;
+            uint32_t d1_data_index=spectra + point + matching_second_point;
+            if (component == GATHER_COMPONENT) {
+                chunk_data0_r[tgt_data_idx]=data_r[d0_data_index];
+                chunk_data0_i[tgt_data_idx]=data_i[d0_data_index];
+                chunk_data1_r[tgt_data_idx]=data_r[d1_data_index];
+                chunk_data1_i[tgt_data_idx]=data_i[d1_data_index];
+            } else if (component == TWIDDLE_COMPONENT) {
+                chunk_twiddle_r[tgt_data_idx]=twiddle_r;
+                chunk_twiddle_i[tgt_data_idx]=twiddle_i;
+            } else {
+                data_r[d0_data_index]=chunk_data0_r[tgt_data_idx];
+                data_r[d1_data_index]=chunk_data1_r[tgt_data_idx];
+                data_i[d0_data_index]=chunk_data0_i[tgt_data_idx];
+                data_i[d1_data_index]=chunk_data1_i[tgt_data_idx];
+            }
+            tgt_data_idx++;
+            if (tgt_data_idx == chunk_size) tgt_data_idx=0;
+        }
+    }
+}
+
+// Points through each pass of the component, bit reversal is of the whole domain and the others are of every stage
+static uint64_t getComponentElements(enum FFTComponent component, uint32_t domain_size) {
+    uint64_t num_steps=31 - __builtin_clz(domain_size);
+    return component == BITREVERSE_COMPONENT ? domain_size : domain_size * num_steps;
+}
+
+// Bytes of the L1 buffer of a data movement component's harness, the data, imaginary data and twiddle table, then six scratch chunks
+static uint32_t getComponentL1Size(uint32_t domain_size, uint32_t chunk_size) {
+    return ((3 * domain_size) + (6 * chunk_size)) * 4;
+}
@@ -0,0 +1,257 @@
+#include "fft.h"
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+static void fftMixedRadix(CommandQueue&, TTExecution*, float*, float*, float*, float*, float*, uint32_t, uint32_t, enum FFTDirection);
+static void fftBluestein(CommandQueue&, TTExecution*, float*, float*, float*, float*, float*, uint32_t, uint32_t, enum FFTDirection);
+static void mixedRadixDFT(float*, float*, uint32_t, float*, float*, uint32_t);
+static uint32_t getSmallestRadix(uint32_t);
+static uint32_t getOddPart(uint32_t);
+static bool isSmoothSize(uint32_t);
+
+/*
+ * The device only transforms power of two domains. Other sizes are decomposed as n = p * m, where p is the
+ * largest power of two factor, and if m only has factors of 3, 5 and 7 and p is at least sixteen then m device
+ * FFTs of size p are combined on the host with recursive radix 3/5/7 passes. Otherwise Bluestein's algorithm is
+ * used, which needs a power of two device domain of at least 2n-1
+ */
+uint32_t getDeviceDomainSize(uint32_t domain_size) {
+    if (checkIfPowerOfTwo(domain_size)) return domain_size;
+    uint32_t odd_part=getOddPart(domain_size);
+    uint32_t power_of_two_part=domain_size / odd_part;
+    if (power_of_two_part >= MIN_MIXED_RADIX_DEVICE_SIZE && isSmoothSize(odd_part)) {
+        return power_of_two_part;
+    }
+    uint32_t bluestein_size=1;
+    while (bluestein_size < (2*domain_size)-1) bluestein_size <<= 1;
+    return bluestein_size;
+}
+
+/*
+ * FFT of any domain size, the result follows the same convention as fft so a backwards transform
+ * is the forward transform of the conjugated input
+ */
+void fftAnySize(CommandQueue& cq, TTExecution * device_descriptor, float * input_r, float * input_i, float * twiddle_factors,
+                    float * result_r, float * result_i, uint32_t domain_size, uint32_t device_domain_size, enum FFTDirection direction) {
+    if (domain_size == device_domain_size) {
+        fft(cq, device_descriptor, input_r, input_i, twiddle_factors, result_r, result_i, domain_size, direction);
+    } else if (domain_size % device_domain_size == 0) {
+        fftMixedRadix(cq, device_descriptor, input_r, input_i, twiddle_factors, result_r, result_i, domain_size, device_domain_size, direction);
+    } else {
+        fftBluestein(cq, device_descriptor, input_r, input_i, twiddle_factors, result_r, result_i, domain_size, device_domain_size, direction);
+    }
+}
+
+/*
+ * Forward DFT of any size on the host, used as the reference. Radix 2, 3, 5 and 7 are split out
+ * recursively and any remaining prime factor is computed directly
+ */
+void referenceDFT(float * input_r, float * input_i, float * result_r, float * result_i, uint32_t domain_size) {
+    mixedRadixDFT(input_r, input_i, 1, result_r, result_i, domain_size);
+}
+
+/*
+ * The m sub transforms are held one after another and transformed as a single batch, so there is one upload, launch
+ * and download whatever the odd part
+ */
+static void fftMixedRadix(CommandQueue& cq, TTExecution * device_descriptor, float * input_r, float * input_i, float * twiddle_factors,
+                            float * result_r, float * result_i, uint32_t domain_size, uint32_t device_domain_size, enum FFTDirection direction) {
+    uint32_t num_subtransforms=domain_size / device_domain_size;
+
+    float * sub_r=(float*) malloc(sizeof(float) * domain_size);
+    float * sub_i=(float*) malloc(sizeof(float) * domain_size);
+    float * transformed_r=(float*) malloc(sizeof(float) * domain_size);
+    float * transformed_i=(float*) malloc(sizeof(float) * domain_size);
+
+    // Decimate in time, sub transform r holds points r, r+m, r+2m... and its result is stored at r*p
+    for (uint32_t r=0;r<num_subtransforms;r++) {
+        for (uint32_t i=0;i<device_domain_size;i++) {
+            sub_r[(r*device_domain_size)+i]=input_r[(i*num_subtransforms)+r];
+            sub_i[(r*device_domain_size)+i]=direction == FFT_BACKWARD ? -input_i[(i*num_subtransforms)+r] : input_i[(i*num_subtransforms)+r];
+        }
+    }
+
+    if (device_descriptor->mixed_radix_size != domain_size) {
+        // Like the Bluestein filter these only depend on the domain size, so are kept for subsequent calls
+        tt_metal::InterleavedBufferConfig frames_dram_config{
+            .device = device_descriptor->in_data_r_dram_buffer->device(),
+            .size = domain_size * 4,
+            .page_size = domain_size * 4,
+            .buffer_type = tt_metal::BufferType::DRAM};
+        device_descriptor->mixed_radix_r_dram_buffer=CreateBuffer(frames_dram_config);
+        device_descriptor->mixed_radix_i_dram_buffer=CreateBuffer(frames_dram_config);
+        device_descriptor->mixed_radix_result_r_dram_buffer=CreateBuffer(frames_dram_config);
+        device_descriptor->mixed_radix_result_i_dram_buffer=CreateBuffer(frames_dram_config);
+        device_descriptor->mixed_radix_size=domain_size;
+    }
+
+    struct timeval start_time;
+    gettimeofday(&start_time, NULL);
+    FFTBatch batch={num_subtransforms, device_domain_size};
+    EnqueueWriteBuffer(cq, device_descriptor->mixed_radix_r_dram_buffer, sub_r, false);
+    EnqueueWriteBuffer(cq, device_descriptor->mixed_radix_i_dram_buffer, sub_i, false);
+    uploadTwiddleFactors(cq, device_descriptor, twiddle_factors);
+    enqueueFFT(cq, device_descriptor, device_descriptor->mixed_radix_r_dram_buffer, device_descriptor->mixed_radix_i_dram_buffer,
+                device_descriptor->mixed_radix_result_r_dram_buffer, device_descriptor->mixed_radix_result_i_dram_buffer, device_domain_size,
+                FFT_FORWARD, false, &batch);
+    EnqueueReadBuffer(cq, device_descriptor->mixed_radix_result_r_dram_buffer, transformed_r, false);
+    EnqueueReadBuffer(cq, device_descriptor->mixed_radix_result_i_dram_buffer, transformed_i, false);
+    Finish(cq);
+    printf("Batch of %d FFTs of size %d: total time %.6f sec\n", num_subtransforms, device_domain_size, getElapsedTime(start_time));
+
+    float * twiddled_r=(float*) malloc(sizeof(float) * num_subtransforms);
+    float * twiddled_i=(float*) malloc(sizeof(float) * num_subtransforms);
+    float * combined_r=(float*) malloc(sizeof(float) * num_subtransforms);
+    float * combined_i=(float*) malloc(sizeof(float) * num_subtransforms);
+    for (uint32_t k1=0;k1<device_domain_size;k1++) {
+        // Apply the twiddle for each sub transform then an m point DFT across them gives points k1, k1+p, k1+2p...
+        for (uint32_t r=0;r<num_subtransforms;r++) {
+            double base_factor=(2.0 * PI * (double) (r * k1))/(double) domain_size;
+            float w_r=(float) cos(base_factor), w_i=(float) -sin(base_factor);
+            float d_r=transformed_r[(r*device_domain_size)+k1], d_i=transformed_i[(r*device_domain_size)+k1];
+            twiddled_r[r]=(d_r * w_r) - (d_i * w_i);
+            twiddled_i[r]=(d_r * w_i) + (d_i * w_r);
+        }
+        mixedRadixDFT(twiddled_r, twiddled_i, 1, combined_r, combined_i, num_subtransforms);
+        for (uint32_t k2=0;k2<num_subtransforms;k2++) {
+            result_r[k1+(k2*device_domain_size)]=combined_r[k2];
+            result_i[k1+(k2*device_domain_size)]=combined_i[k2];
+        }
+    }
+
+    free(sub_r);
+    free(sub_i);
+    free(transformed_r);
+    free(transformed_i);
+    free(twiddled_r);
+    free(twiddled_i);
+    free(combined_r);
+    free(combined_i);
+}
+
+static void fftBluestein(CommandQueue& cq, TTExecution * device_descriptor, float * input_r, float * input_i, float * twiddle_factors,
+                            float * result_r, float * result_i, uint32_t domain_size, uint32_t device_domain_size, enum FFTDirection direction) {
+    float * chirp_r=(float*) malloc(sizeof(float) * domain_size);
+    float * chirp_i=(float*) malloc(sizeof(float) * domain_size);
+    for (uint32_t k=0;k<domain_size;k++) {
+        // The chirp is exp(-j*pi*k^2/n), reduce k^2 modulo 2n before converting to an angle
+        double base_factor=(PI * (double) (((uint64_t) k * k) % (2 * (uint64_t) domain_size)))/(double) domain_size;
+        chirp_r[k]=(float) cos(base_factor);
+        chirp_i[k]=(float) -sin(base_factor);
+    }
+
+    float * a_r=(float*) calloc(device_domain_size, sizeof(float));
+    float * a_i=(float*) calloc(device_domain_size, sizeof(float));
+
+    if (device_descriptor->bluestein_size != domain_size) {
+        // The filter is the conjugate chirp mirrored so negative indices wrap around, it only depends on the
+        // domain size so is transformed once and kept for subsequent calls
+        free(device_descriptor->bluestein_filter_r);
+        free(device_descriptor->bluestein_filter_i);
+        device_descriptor->bluestein_filter_r=(float*) malloc(sizeof(float) * device_domain_size);
+        device_descriptor->bluestein_filter_i=(float*) malloc(sizeof(float) * device_domain_size);
+        for (uint32_t k=0;k<domain_size;k++) {
+            a_r[k]=chirp_r[k];
+            a_i[k]=-chirp_i[k];
+            if (k > 0) {
+                a_r[device_domain_size-k]=a_r[k];
+                a_i[device_domain_size-k]=a_i[k];
+            }
+        }
+        fft(cq, device_descriptor, a_r, a_i, twiddle_factors, device_descriptor->bluestein_filter_r,
+                device_descriptor->bluestein_filter_i, device_domain_size, FFT_FORWARD);
+        device_descriptor->bluestein_size=domain_size;
+        memset(a_r, 0, sizeof(float) * device_domain_size);
+        memset(a_i, 0, sizeof(float) * device_domain_size);
+    }
+
+    for (uint32_t k=0;k<domain_size;k++) {
+        float x_r=input_r[k];
+        float x_i=direction == FFT_BACKWARD ? -input_i[k] : input_i[k];
+        a_r[k]=(x_r * chirp_r[k]) - (x_i * chirp_i[k]);
+        a_i[k]=(x_r * chirp_i[k]) + (x_i * chirp_r[k]);
+    }
+    fft(cq, device_descriptor, a_r, a_i, twiddle_factors, a_r, a_i, device_domain_size, FFT_FORWARD);
+
+    float * filter_r=device_descriptor->bluestein_filter_r;
+    float * filter_i=device_descriptor->bluestein_filter_i;
+    for (uint32_t i=0;i<device_domain_size;i++) {
+        float c_r=(a_r[i] * filter_r[i]) - (a_i[i] * filter_i[i]);
+        float c_i=(a_r[i] * filter_i[i]) + (a_i[i] * filter_r[i]);
+        a_r[i]=c_r;
+        a_i[i]=c_i;
+    }
+    // A backwards device FFT gives the conjugate of the scaled inverse
+    fft(cq, device_descriptor, a_r, a_i, twiddle_factors, a_r, a_i, device_domain_size, FFT_BACKWARD);
+
+    for (uint32_t k=0;k<domain_size;k++) {
+        float c_r=a_r[k] / device_domain_size;
+        float c_i=-a_i[k] / device_domain_size;
+        result_r[k]=(c_r * chirp_r[k]) - (c_i * chirp_i[k]);
+        result_i[k]=(c_r * chirp_i[k]) + (c_i * chirp_r[k]);
+    }
+
+    free(chirp_r);
+    free(chirp_i);
+    free(a_r);
+    free(a_i);
+}
+
+static void mixedRadixDFT(float * input_r, float * input_i, uint32_t stride, float * result_r, float * result_i, uint32_t n) {
+    if (n == 1) {
+        result_r[0]=input_r[0];
+        result_i[0]=input_i[0];
+        return;
+    }
+    // If no supported radix divides n then it is prime (or has large prime factors) and the radix is n, a direct DFT
+    uint32_t radix=getSmallestRadix(n);
+    if (radix == 0) radix=n;
+    uint32_t sub_size=n/radix;
+    for (uint32_t r=0;r<radix;r++) {
+        mixedRadixDFT(&input_r[r*stride], &input_i[r*stride], stride*radix, &result_r[r*sub_size], &result_i[r*sub_size], sub_size);
+    }
+
+    float * sub_results_r=(float*) malloc(sizeof(float) * n);
+    float * sub_results_i=(float*) malloc(sizeof(float) * n);
+    memcpy(sub_results_r, result_r, sizeof(float) * n);
+    memcpy(sub_results_i, result_i, sizeof(float) * n);
+    for (uint32_t k1=0;k1<sub_size;k1++) {
+        for (uint32_t k2=0;k2<radix;k2++) {
+            uint32_t k=k1+(sub_size*k2);
+            double sum_r=0.0, sum_i=0.0;
+            for (uint32_t r=0;r<radix;r++) {
+                double base_factor=(2.0 * PI * (double) (((uint64_t) r * k) % n))/(double) n;
+                double w_r=cos(base_factor), w_i=-sin(base_factor);
+                double d_r=sub_results_r[(r*sub_size)+k1], d_i=sub_results_i[(r*sub_size)+k1];
+                sum_r+=(d_r * w_r) - (d_i * w_i);
+                sum_i+=(d_r * w_i) + (d_i * w_r);
+            }
+            result_r[k]=(float) sum_r;
+            result_i[k]=(float) sum_i;
+        }
+    }
+    free(sub_results_r);
+    free(sub_results_i);
+}
+
+static uint32_t getSmallestRadix(uint32_t n) {
+    uint32_t radices[]={2, 3, 5, 7};
+    for (uint32_t radix : radices) {
+        if (n % radix == 0) return radix;
+    }
+    return 0;
+}
+
+static uint32_t getOddPart(uint32_t n) {
+    while (n % 2 == 0) n/=2;
+    return n;
+}
+
+static bool isSmoothSize(uint32_t n) {
+    uint32_t radices[]={3, 5, 7};
+    for (uint32_t radix : radices) {
+        while (n % radix == 0) n/=radix;
+    }
+    return n == 1;
+}
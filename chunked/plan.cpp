@@ -0,0 +1,58 @@
+#include "fft.h"
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+/*
+ * Returns the program of this strategy and compute backend specialised for this domain size and direction, building it on first use. The
+ * domain size and direction are compiled into the kernels, so their loop bounds and index arithmetic are constants,
+ * and each distinct pair is a separate kernel binary which is then reused for every later transform
+ */
+FFTPlan* getFFTPlan(TTExecution * device_descriptor, uint32_t domain_size, enum FFTDirection direction, enum FFTStrategy strategy,
+                        enum FFTComputeBackend compute_backend) {
+    for (FFTPlan * plan : device_descriptor->plan_cache) {
+        if (plan->domain_size == domain_size && plan->direction == direction && plan->strategy == strategy &&
+                plan->compute_backend == compute_backend) return plan;
+    }
+
+    FFTPlan * plan=new FFTPlan();
+    plan->domain_size=domain_size;
+    plan->direction=direction;
+    plan->strategy=strategy;
+    plan->compute_backend=compute_backend;
+    plan->program=CreateProgram();
+    plan->stage_progress_semaphore=0;
+    plan->device_descriptor=device_descriptor;
+    // The filter circular buffers are only needed if a filter has been allocated for convolution
+    bool convolve=device_descriptor->filter_r_dram_buffer != nullptr;
+    getFFTStrategy(strategy)->create_program(plan->program, *(device_descriptor->core), domain_size, convolve, device_descriptor->pipeline_stages,
+                                                compute_backend, device_descriptor->staging_r_buffer, device_descriptor->staging_i_buffer,
+                                                {domain_size, (uint32_t) direction}, &plan->read_kernel, &plan->write_kernel, &plan->compute_kernel,
+                                                &plan->stage_progress_semaphore);
+    device_descriptor->plan_cache.push_back(plan);
+    return plan;
+}
+
+/*
+ * As fft, but always through this plan's program whether or not the execution specialises kernels. With buffers
+ * from allocateHostBuffer the transfers are from page aligned memory that is locked in place
+ */
+void FFTPlan::execute(CommandQueue& cq, float * input_r, float * input_i, float * twiddle_factors, float * result_r, float * result_i) {
+    EnqueueWriteBuffer(cq, device_descriptor->in_data_r_dram_buffer, input_r, false);
+    EnqueueWriteBuffer(cq, device_descriptor->in_data_i_dram_buffer, input_i, false);
+    if (device_descriptor->twiddle_seed_stride == 0) {
+        EnqueueWriteBuffer(cq, device_descriptor->twiddle_dram_buffer, twiddle_factors, false);
+    }
+    enqueuePlannedFFT(cq, device_descriptor, this, device_descriptor->in_data_r_dram_buffer, device_descriptor->in_data_i_dram_buffer,
+                        device_descriptor->result_data_r_dram_buffer, device_descriptor->result_data_i_dram_buffer, domain_size, direction, false, NULL);
+    EnqueueReadBuffer(cq, device_descriptor->result_data_r_dram_buffer, result_r, false);
+    EnqueueReadBuffer(cq, device_descriptor->result_data_i_dram_buffer, result_i, false);
+    Finish(cq);
+}
+
+void destroyFFTPlans(TTExecution * device_descriptor) {
+    for (FFTPlan * plan : device_descriptor->plan_cache) {
+        delete plan;
+    }
+    device_descriptor->plan_cache.clear();
+}
@@ -0,0 +1,201 @@
+#include "fft.h"
+#include <algorithm>
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+// Points of each frame given a strong tone, so that the peaks stand out from the noise
+#define REDUCTION_TONES 4
+
+static const char * reduction_names[]={"none", "top-k", "threshold"};
+
+/*
+ * Words in the record of a frame, the count then capacity (index, value) pairs padded to 64 bytes so that each frame's
+ * record keeps the DRAM write alignment. This matches get_reduction_record_size in kernels/constants.h
+ */
+uint32_t getReductionRecordSize(uint32_t capacity) {
+    return ((1 + (2 * capacity)) + 15) & ~15u;
+}
+
+/*
+ * Creates the device buffers for num_frames frames of domain_size points held one after another, each reduced to a
+ * record of at most capacity peaks. With a post stage the peaks are of its result rather than of the power
+ */
+ReductionPlan* createReductionPlan(IDevice* device, TTExecution * device_descriptor, uint32_t domain_size, uint32_t num_frames,
+                                    enum FFTPostStage post_stage, enum FFTReduction reduction, uint32_t capacity, float threshold) {
+    ReductionPlan * plan=new ReductionPlan();
+    plan->device_descriptor=device_descriptor;
+    plan->domain_size=domain_size;
+    plan->num_frames=num_frames;
+
+    tt_metal::InterleavedBufferConfig signal_dram_config{
+        .device = device,
+        .size = num_frames * domain_size * 4,
+        .page_size = num_frames * domain_size * 4,
+        .buffer_type = tt_metal::BufferType::DRAM};
+    tt_metal::InterleavedBufferConfig records_dram_config{
+        .device = device,
+        .size = num_frames * getReductionRecordSize(capacity) * 4,
+        .page_size = num_frames * getReductionRecordSize(capacity) * 4,
+        .buffer_type = tt_metal::BufferType::DRAM};
+
+    plan->signal_r_dram_buffer=CreateBuffer(signal_dram_config);
+    plan->signal_i_dram_buffer=CreateBuffer(signal_dram_config);
+    plan->records_dram_buffer=CreateBuffer(records_dram_config);
+
+    plan->batch.num_frames=num_frames;
+    plan->batch.frame_stride=domain_size;
+    plan->batch.post_stage=post_stage;
+    plan->batch.reduction=reduction;
+    plan->batch.reduction_capacity=capacity;
+    plan->batch.reduction_threshold=threshold;
+    return plan;
+}
+
+/*
+ * Peaks are returned capacity to a frame, with the count of each frame being the number of peaks held for top-K and
+ * the number of points over the threshold (which may be more than are held) for threshold compaction. The records are
+ * the real output of the launch, nothing is written to the imaginary output so the records buffer is given as both
+ */
+void reducedFFT(CommandQueue& cq, ReductionPlan * plan, float * signal_r, float * signal_i, float * twiddle_factors, FFTPeak * peaks, uint32_t * counts) {
+    TTExecution * device_descriptor=plan->device_descriptor;
+    uint32_t capacity=plan->batch.reduction_capacity;
+    uint32_t record_size=getReductionRecordSize(capacity);
+    uint32_t * records=(uint32_t*) malloc(sizeof(uint32_t) * plan->num_frames * record_size);
+    struct timeval start_time;
+
+    gettimeofday(&start_time, NULL);
+    EnqueueWriteBuffer(cq, plan->signal_r_dram_buffer, signal_r, false);
+    EnqueueWriteBuffer(cq, plan->signal_i_dram_buffer, signal_i, false);
+    if (device_descriptor->twiddle_seed_stride == 0) {
+        EnqueueWriteBuffer(cq, device_descriptor->twiddle_dram_buffer, twiddle_factors, false);
+    }
+    Finish(cq);
+    double xfer_on_time=getElapsedTime(start_time);
+
+    gettimeofday(&start_time, NULL);
+    enqueueFFT(cq, device_descriptor, plan->signal_r_dram_buffer, plan->signal_i_dram_buffer,
+                plan->records_dram_buffer, plan->records_dram_buffer, plan->domain_size, FFT_FORWARD, false, &plan->batch);
+    Finish(cq);
+    double exec_time=getElapsedTime(start_time);
+
+    gettimeofday(&start_time, NULL);
+    EnqueueReadBuffer(cq, plan->records_dram_buffer, records, true);
+    double xfer_off_time=getElapsedTime(start_time);
+
+    for (uint32_t frame=0;frame<plan->num_frames;frame++) {
+        uint32_t * record=&records[frame * record_size];
+        counts[frame]=record[0];
+        uint32_t held=record[0] < capacity ? record[0] : capacity;
+        for (uint32_t i=0;i<held;i++) {
+            peaks[(frame * capacity) + i].index=record[1 + (i * 2)];
+            memcpy(&peaks[(frame * capacity) + i].value, &record[2 + (i * 2)], sizeof(float));
+        }
+    }
+    free(records);
+
+    double total_time=xfer_on_time+exec_time+xfer_off_time;
+    printf("Reduction (%s) of %d frames of size %d: total time %.6f sec. %.6f sec transfer on, %.6f sec execution, %.6f sec transfer off "
+            "of %d bytes\n", reduction_names[plan->batch.reduction], plan->num_frames, plan->domain_size, total_time, xfer_on_time, exec_time,
+            xfer_off_time, plan->num_frames * record_size * 4);
+}
+
+void destroyReductionPlan(ReductionPlan * plan) {
+    delete plan;
+}
+
+/*
+ * The reduction on the host of one spectrum, with the same ordering as the writer. If values_i is NULL then values_r
+ * holds the value of each point (a post stage result), otherwise the value is the power. Returns the count
+ */
+uint32_t referenceReduction(float * values_r, float * values_i, uint32_t domain_size, enum FFTReduction reduction, uint32_t capacity,
+                                float threshold, FFTPeak * peaks) {
+    std::vector<FFTPeak> points;
+    for (uint32_t i=0;i<domain_size;i++) {
+        float value=values_i == NULL ? values_r[i] : (values_r[i] * values_r[i]) + (values_i[i] * values_i[i]);
+        if (reduction == THRESHOLD_REDUCTION && !(value >= threshold)) continue;
+        points.push_back({i, value});
+    }
+    if (reduction == TOP_K_REDUCTION) {
+        // Stable, so equal values stay in index order
+        std::stable_sort(points.begin(), points.end(), [](const FFTPeak & a, const FFTPeak & b) { return a.value > b.value; });
+    }
+    uint32_t held=points.size() < capacity ? points.size() : capacity;
+    for (uint32_t i=0;i<held;i++) peaks[i]=points[i];
+    return reduction == TOP_K_REDUCTION ? held : points.size();
+}
+
+/*
+ * Reduction of noise frames each with a few strong tones. The same frames are also transformed in full and reduced by
+ * referenceReduction on the host, which the device records must match exactly as both see the same values
+ */
+void runReduction(IDevice* device, CommandQueue& cq, TTExecution * device_descriptor, float * twiddle_factors, uint32_t domain_size,
+                    enum FFTPostStage post_stage, enum FFTReduction reduction, uint32_t capacity, float threshold) {
+    uint32_t num_frames=4;
+    float * signal_r=(float*) malloc(sizeof(float) * num_frames * domain_size);
+    float * signal_i=(float*) malloc(sizeof(float) * num_frames * domain_size);
+    for (uint32_t i=0;i<num_frames * domain_size;i++) {
+        signal_r[i]=(float) rand()/(float) RAND_MAX;
+        signal_i[i]=(float) rand()/(float) RAND_MAX;
+    }
+    for (uint32_t frame=0;frame<num_frames;frame++) {
+        for (uint32_t tone=0;tone<REDUCTION_TONES;tone++) {
+            uint32_t bin=rand() % domain_size;
+            for (uint32_t i=0;i<domain_size;i++) {
+                double phase=(2.0 * PI * bin * i)/(double) domain_size;
+                signal_r[(frame * domain_size) + i]+=(float) ((tone + 1) * cos(phase));
+                signal_i[(frame * domain_size) + i]+=(float) ((tone + 1) * sin(phase));
+            }
+        }
+    }
+
+    ReductionPlan * plan=createReductionPlan(device, device_descriptor, domain_size, num_frames, post_stage, reduction, capacity, threshold);
+    FFTPeak * peaks=(FFTPeak*) malloc(sizeof(FFTPeak) * num_frames * capacity);
+    uint32_t * counts=(uint32_t*) malloc(sizeof(uint32_t) * num_frames);
+    reducedFFT(cq, plan, signal_r, signal_i, twiddle_factors, peaks, counts);
+
+    // The full spectra, which with a post stage are just the real values
+    tt_metal::InterleavedBufferConfig spectra_dram_config{
+        .device = device,
+        .size = num_frames * domain_size * 4,
+        .page_size = num_frames * domain_size * 4,
+        .buffer_type = tt_metal::BufferType::DRAM};
+    std::shared_ptr<Buffer> spectra_r_dram_buffer=CreateBuffer(spectra_dram_config);
+    std::shared_ptr<Buffer> spectra_i_dram_buffer=CreateBuffer(spectra_dram_config);
+    FFTBatch full_batch=plan->batch;
+    full_batch.reduction=NO_REDUCTION;
+    float * spectra_r=(float*) malloc(sizeof(float) * num_frames * domain_size);
+    float * spectra_i=(float*) malloc(sizeof(float) * num_frames * domain_size);
+    enqueueFFT(cq, device_descriptor, plan->signal_r_dram_buffer, plan->signal_i_dram_buffer, spectra_r_dram_buffer, spectra_i_dram_buffer,
+                domain_size, FFT_FORWARD, false, &full_batch);
+    EnqueueReadBuffer(cq, spectra_r_dram_buffer, spectra_r, false);
+    if (post_stage == NO_POST_STAGE) EnqueueReadBuffer(cq, spectra_i_dram_buffer, spectra_i, false);
+    Finish(cq);
+
+    FFTPeak * reference_peaks=(FFTPeak*) malloc(sizeof(FFTPeak) * capacity);
+    uint32_t mismatches=0;
+    for (uint32_t frame=0;frame<num_frames;frame++) {
+        uint32_t reference_count=referenceReduction(&spectra_r[frame * domain_size], post_stage == NO_POST_STAGE ? &spectra_i[frame * domain_size] : NULL,
+                                                    domain_size, reduction, capacity, threshold, reference_peaks);
+        if (counts[frame] != reference_count) mismatches++;
+        uint32_t held=reference_count < capacity ? reference_count : capacity;
+        for (uint32_t i=0;i<held && counts[frame] == reference_count;i++) {
+            FFTPeak * peak=&peaks[(frame * capacity) + i];
+            if (peak->index != reference_peaks[i].index || fabsf(peak->value - reference_peaks[i].value) > 1e-5f * fabsf(reference_peaks[i].value)) {
+                mismatches++;
+            }
+        }
+        printf("Frame %d: %d peaks, strongest at %d with %e\n", frame, counts[frame], held > 0 ? peaks[frame * capacity].index : 0,
+                held > 0 ? peaks[frame * capacity].value : 0.0f);
+    }
+    printf("Checked the records of %d frames against the host reduction of the full spectra: %d mismatches\n", num_frames, mismatches);
+
+    destroyReductionPlan(plan);
+    free(signal_r);
+    free(signal_i);
+    free(peaks);
+    free(counts);
+    free(spectra_r);
+    free(spectra_i);
+    free(reference_peaks);
+}
@@ -0,0 +1,388 @@
+#include "fft.h"
+#include <algorithm>
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+// Time a mock device takes to dispatch each launch, which coalescing requests into batches amortises
+#define MOCK_LAUNCH_LATENCY_US 50
+// Limits of the coalesced scheduler in the load generator, the baseline launches each request alone
+#define SCHEDULER_MAX_BATCH_FRAMES 32
+#define SCHEDULER_DEADLINE 0.0002
+// Transforms submitted by each client of the load generator
+#define SCHEDULER_REQUESTS_PER_CLIENT 200
+// Smallest domain size submitted by the load generator, below this frames can not be batched at the DRAM read alignment
+#define SCHEDULER_MIN_DOMAIN_SIZE 16
+// Transfers to and from the lane's buffers move just the frames launched, rounded up to the DRAM read alignment
+#define SCHEDULER_TRANSFER_ALIGNMENT 64
+
+static void runLane(FFTScheduler*, FFTSchedulerLane*);
+static FFTRequestGroup* selectReadyGroup(FFTScheduler*, std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point*);
+static void launchBatch(FFTScheduler*, FFTSchedulerLane*, uint32_t, enum FFTDirection, std::vector<FFTRequest*>&);
+static void launchMockBatch(FFTSchedulerLane*, uint32_t, enum FFTDirection, std::vector<FFTRequest*>&);
+static void launchDeviceBatch(FFTScheduler*, FFTSchedulerLane*, uint32_t, enum FFTDirection, std::vector<FFTRequest*>&);
+static BufferRegion getTransferRegion(std::shared_ptr<Buffer>&, uint32_t);
+static void runSchedulerClient(FFTScheduler*, uint32_t, uint32_t, uint32_t, std::vector<double>*, float*);
+static void runSchedulerPass(const char*, uint32_t, uint32_t, uint32_t, uint32_t, double, uint32_t, bool, float*);
+
+/*
+ * Opens num_devices devices, each with an execution for transforms of up to max_domain_size points and a lane that
+ * launches batches on it. If mocked then no devices are opened and each of the num_devices lanes runs its batches on
+ * the host. The twiddles are uploaded by each lane for the domain size of its batch, so are never generated or compact
+ */
+FFTScheduler* createFFTScheduler(uint32_t num_devices, uint32_t max_domain_size, uint32_t max_batch_frames, double deadline, bool mocked) {
+    FFTScheduler * scheduler=new FFTScheduler();
+    scheduler->max_domain_size=max_domain_size;
+    scheduler->max_batch_frames=max_batch_frames;
+    scheduler->deadline=deadline;
+    scheduler->mocked=mocked;
+    scheduler->stopping=false;
+    scheduler->num_launches=scheduler->num_frames=0;
+    for (uint32_t i=0;i<num_devices;i++) {
+        FFTSchedulerLane * lane=new FFTSchedulerLane();
+        lane->device=NULL;
+        lane->device_descriptor=NULL;
+        if (!mocked) {
+            lane->device=CreateDevice(i);
+            lane->device_descriptor=createTTExecution(lane->device, max_domain_size, 0, false, false, false, false, false, FPU_BACKEND);
+            // Sized for the largest batch of the largest domain, so that a launch only sets how many frames it holds
+            tt_metal::InterleavedBufferConfig batch_dram_config{
+                .device = lane->device,
+                .size = max_batch_frames * max_domain_size * 4,
+                .page_size = max_batch_frames * max_domain_size * 4,
+                .buffer_type = tt_metal::BufferType::DRAM};
+            lane->batch_r_dram_buffer=CreateBuffer(batch_dram_config);
+            lane->batch_i_dram_buffer=CreateBuffer(batch_dram_config);
+            lane->batch_result_r_dram_buffer=CreateBuffer(batch_dram_config);
+            lane->batch_result_i_dram_buffer=CreateBuffer(batch_dram_config);
+        }
+        lane->twiddle_domain_size=0;
+        lane->batch_r=(float*) malloc(sizeof(float) * max_batch_frames * max_domain_size);
+        lane->batch_i=(float*) malloc(sizeof(float) * max_batch_frames * max_domain_size);
+        lane->twiddle_factors=NULL;
+        scheduler->lanes.push_back(lane);
+    }
+    // The lanes only start once they are all created, as each may take any plan's requests
+    for (uint32_t i=0;i<num_devices;i++) {
+        scheduler->lanes[i]->worker=std::thread(runLane, scheduler, scheduler->lanes[i]);
+    }
+    return scheduler;
+}
+
+/*
+ * Queues a transform of domain_size points, a power of two of up to the scheduler's maximum, from the input to the
+ * result arrays. These are written before the returned future is made ready, and any error from the runtime is
+ * rethrown by its get. As with fft, backward transforms are not scaled
+ */
+std::future<void> submitFFT(FFTScheduler * scheduler, float * input_r, float * input_i, float * result_r, float * result_i, uint32_t domain_size,
+                                enum FFTDirection direction) {
+    FFTRequest * request=new FFTRequest();
+    request->domain_size=domain_size;
+    request->direction=direction;
+    request->input_r=input_r;
+    request->input_i=input_i;
+    request->result_r=result_r;
+    request->result_i=result_i;
+    std::future<void> done=request->done.get_future();
+
+    std::lock_guard<std::mutex> guard(scheduler->lock);
+    FFTRequestGroup * group=NULL;
+    for (FFTRequestGroup * candidate : scheduler->groups) {
+        if (candidate->domain_size == domain_size && candidate->direction == direction) group=candidate;
+    }
+    if (group == NULL) {
+        group=new FFTRequestGroup();
+        group->domain_size=domain_size;
+        group->direction=direction;
+        scheduler->groups.push_back(group);
+    }
+    request->submit_time=std::chrono::steady_clock::now();
+    group->requests.push_back(request);
+    // A lane is woken to wait on the deadline of a plan's first request, and to launch a batch once one is full
+    if (group->requests.size() == 1 || group->requests.size() >= scheduler->max_batch_frames) scheduler->pending_changed.notify_one();
+    return done;
+}
+
+// Launches any requests still pending, then stops the lanes and closes their devices
+void destroyFFTScheduler(FFTScheduler * scheduler) {
+    {
+        std::lock_guard<std::mutex> guard(scheduler->lock);
+        scheduler->stopping=true;
+    }
+    scheduler->pending_changed.notify_all();
+    for (FFTSchedulerLane * lane : scheduler->lanes) {
+        lane->worker.join();
+        if (lane->device != NULL) {
+            destroyTTExecution(lane->device_descriptor);
+            CloseDevice(lane->device);
+        }
+        free(lane->batch_r);
+        free(lane->batch_i);
+        free(lane->twiddle_factors);
+        delete lane;
+    }
+    for (FFTRequestGroup * group : scheduler->groups) delete group;
+    delete scheduler;
+}
+
+/*
+ * Load of num_clients threads each submitting SCHEDULER_REQUESTS_PER_CLIENT transforms of random power of two sizes up to
+ * max_domain_size, in random directions, and waiting on each before the next. The load is run once with every
+ * request launched alone, as if each caller had the device to itself, and once coalesced, reporting the throughput
+ * and latency of each. The first transform of each client is forward and checked against a double precision reference
+ */
+void runSchedulerLoad(uint32_t num_devices, uint32_t max_domain_size, uint32_t num_clients, bool mocked) {
+    uint32_t requests_per_client=SCHEDULER_REQUESTS_PER_CLIENT;
+    uint32_t min_domain_size=max_domain_size < SCHEDULER_MIN_DOMAIN_SIZE ? max_domain_size : SCHEDULER_MIN_DOMAIN_SIZE;
+    printf("Scheduling %d transforms of sizes %d to %d from %d clients over %d %sdevices\n", num_clients * requests_per_client, min_domain_size,
+            max_domain_size, num_clients, num_devices, mocked ? "mock " : "");
+
+    float max_error=0.0f;
+    runSchedulerPass("unbatched", num_devices, max_domain_size, num_clients, requests_per_client, 0.0, 1, mocked, &max_error);
+    runSchedulerPass("coalesced", num_devices, max_domain_size, num_clients, requests_per_client, SCHEDULER_DEADLINE, SCHEDULER_MAX_BATCH_FRAMES,
+                        mocked, &max_error);
+    printf("Checked the first transform of each client against reference FFT: maximum relative error %e\n", max_error);
+}
+
+/*
+ * A lane takes the ready plan whose oldest request has waited longest, and launches up to max_batch_frames of its
+ * requests. Otherwise it sleeps until the earliest deadline or a new request, returning once stopped and drained
+ */
+static void runLane(FFTScheduler * scheduler, FFTSchedulerLane * lane) {
+    std::vector<FFTRequest*> batch;
+    std::unique_lock<std::mutex> guard(scheduler->lock);
+    while (true) {
+        std::chrono::steady_clock::time_point next_deadline;
+        FFTRequestGroup * group=selectReadyGroup(scheduler, std::chrono::steady_clock::now(), &next_deadline);
+        if (group == NULL) {
+            if (next_deadline != std::chrono::steady_clock::time_point::max()) {
+                scheduler->pending_changed.wait_until(guard, next_deadline);
+            } else if (scheduler->stopping) {
+                return;
+            } else {
+                scheduler->pending_changed.wait(guard);
+            }
+            continue;
+        }
+
+        batch.clear();
+        while (!group->requests.empty() && batch.size() < scheduler->max_batch_frames) {
+            batch.push_back(group->requests.front());
+            group->requests.pop_front();
+        }
+        scheduler->num_launches++;
+        scheduler->num_frames+=batch.size();
+        // Another lane may take what is left while this one launches
+        for (FFTRequestGroup * pending : scheduler->groups) {
+            if (!pending->requests.empty()) {
+                scheduler->pending_changed.notify_one();
+                break;
+            }
+        }
+
+        uint32_t domain_size=group->domain_size;
+        enum FFTDirection direction=group->direction;
+        guard.unlock();
+        launchBatch(scheduler, lane, domain_size, direction, batch);
+        guard.lock();
+    }
+}
+
+/*
+ * The group with pending requests whose oldest was submitted first, of those with a full batch or whose oldest has
+ * reached the deadline, or of all of them when stopping. If there is none then NULL is returned and next_deadline set
+ * to the earliest deadline of a pending request, or the maximum time point if nothing is pending. The lock is held
+ */
+static FFTRequestGroup* selectReadyGroup(FFTScheduler * scheduler, std::chrono::steady_clock::time_point now,
+                                            std::chrono::steady_clock::time_point * next_deadline) {
+    std::chrono::steady_clock::duration deadline=std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                    std::chrono::duration<double>(scheduler->deadline));
+    FFTRequestGroup * ready_group=NULL;
+    *next_deadline=std::chrono::steady_clock::time_point::max();
+    for (FFTRequestGroup * group : scheduler->groups) {
+        if (group->requests.empty()) continue;
+        std::chrono::steady_clock::time_point oldest_time=group->requests.front()->submit_time;
+        if (scheduler->stopping || group->requests.size() >= scheduler->max_batch_frames || oldest_time + deadline <= now) {
+            if (ready_group == NULL || oldest_time < ready_group->requests.front()->submit_time) ready_group=group;
+        } else if (oldest_time + deadline < *next_deadline) {
+            *next_deadline=oldest_time + deadline;
+        }
+    }
+    return ready_group;
+}
+
+// Transforms the batch on the lane's device and makes each request's future ready, with the exception if one was thrown
+static void launchBatch(FFTScheduler * scheduler, FFTSchedulerLane * lane, uint32_t domain_size, enum FFTDirection direction,
+                        std::vector<FFTRequest*>& batch) {
+    try {
+        if (scheduler->mocked) {
+            launchMockBatch(lane, domain_size, direction, batch);
+        } else {
+            launchDeviceBatch(scheduler, lane, domain_size, direction, batch);
+        }
+        for (FFTRequest * request : batch) request->done.set_value();
+    } catch (...) {
+        for (FFTRequest * request : batch) request->done.set_exception(std::current_exception());
+    }
+    for (FFTRequest * request : batch) delete request;
+}
+
+// One launch of the mock device, which waits out the dispatch latency then runs the chunked kernels on the host for each frame
+static void launchMockBatch(FFTSchedulerLane * lane, uint32_t domain_size, enum FFTDirection direction, std::vector<FFTRequest*>& batch) {
+    if (lane->twiddle_domain_size != domain_size) {
+        free(lane->twiddle_factors);
+        lane->twiddle_factors=computeTwiddleFactors(domain_size);
+        lane->twiddle_domain_size=domain_size;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(MOCK_LAUNCH_LATENCY_US));
+    for (FFTRequest * request : batch) {
+        emulateFFT(request->input_r, request->input_i, lane->twiddle_factors, request->result_r, request->result_i, domain_size, direction,
+                    0, false, false);
+    }
+}
+
+/*
+ * The frames are gathered one after another and transformed by a single launch, as the rows of a distributed FFT. Below
+ * sixteen points a frame would not start at the DRAM read alignment, so each is instead launched alone through the
+ * execution's own buffers
+ */
+static void launchDeviceBatch(FFTScheduler * scheduler, FFTSchedulerLane * lane, uint32_t domain_size, enum FFTDirection direction,
+                                std::vector<FFTRequest*>& batch) {
+    TTExecution * device_descriptor=lane->device_descriptor;
+    CommandQueue& cq=lane->device->command_queue();
+    uint32_t num_frames=batch.size();
+
+    // The twiddle buffer was sized for the largest domain, so the table for this size is padded to that
+    if (lane->twiddle_domain_size != domain_size) {
+        free(lane->twiddle_factors);
+        lane->twiddle_factors=(float*) calloc(scheduler->max_domain_size, sizeof(float));
+        float * twiddle_factors=computeTwiddleFactors(domain_size);
+        memcpy(lane->twiddle_factors, twiddle_factors, sizeof(float) * domain_size);
+        free(twiddle_factors);
+        EnqueueWriteBuffer(cq, device_descriptor->twiddle_dram_buffer, lane->twiddle_factors, false);
+        lane->twiddle_domain_size=domain_size;
+    }
+
+    if (domain_size < 16) {
+        for (FFTRequest * request : batch) {
+            memcpy(lane->batch_r, request->input_r, sizeof(float) * domain_size);
+            memcpy(lane->batch_i, request->input_i, sizeof(float) * domain_size);
+            EnqueueWriteSubBuffer(cq, device_descriptor->in_data_r_dram_buffer, lane->batch_r, getTransferRegion(device_descriptor->in_data_r_dram_buffer, domain_size), false);
+            EnqueueWriteSubBuffer(cq, device_descriptor->in_data_i_dram_buffer, lane->batch_i, getTransferRegion(device_descriptor->in_data_i_dram_buffer, domain_size), false);
+            enqueueFFT(cq, device_descriptor, device_descriptor->in_data_r_dram_buffer, device_descriptor->in_data_i_dram_buffer,
+                        device_descriptor->result_data_r_dram_buffer, device_descriptor->result_data_i_dram_buffer, domain_size, direction, false, NULL);
+            EnqueueReadSubBuffer(cq, device_descriptor->result_data_r_dram_buffer, lane->batch_r, getTransferRegion(device_descriptor->result_data_r_dram_buffer, domain_size), false);
+            EnqueueReadSubBuffer(cq, device_descriptor->result_data_i_dram_buffer, lane->batch_i, getTransferRegion(device_descriptor->result_data_i_dram_buffer, domain_size), false);
+            Finish(cq);
+            memcpy(request->result_r, lane->batch_r, sizeof(float) * domain_size);
+            memcpy(request->result_i, lane->batch_i, sizeof(float) * domain_size);
+        }
+        return;
+    }
+
+    for (uint32_t f=0;f<num_frames;f++) {
+        memcpy(&lane->batch_r[f*domain_size], batch[f]->input_r, sizeof(float) * domain_size);
+        memcpy(&lane->batch_i[f*domain_size], batch[f]->input_i, sizeof(float) * domain_size);
+    }
+    FFTBatch fft_batch={num_frames, domain_size};
+    EnqueueWriteSubBuffer(cq, lane->batch_r_dram_buffer, lane->batch_r, getTransferRegion(lane->batch_r_dram_buffer, num_frames * domain_size), false);
+    EnqueueWriteSubBuffer(cq, lane->batch_i_dram_buffer, lane->batch_i, getTransferRegion(lane->batch_i_dram_buffer, num_frames * domain_size), false);
+    enqueueFFT(cq, device_descriptor, lane->batch_r_dram_buffer, lane->batch_i_dram_buffer, lane->batch_result_r_dram_buffer,
+                lane->batch_result_i_dram_buffer, domain_size, direction, false, &fft_batch);
+    EnqueueReadSubBuffer(cq, lane->batch_result_r_dram_buffer, lane->batch_r, getTransferRegion(lane->batch_result_r_dram_buffer, num_frames * domain_size), false);
+    EnqueueReadSubBuffer(cq, lane->batch_result_i_dram_buffer, lane->batch_i, getTransferRegion(lane->batch_result_i_dram_buffer, num_frames * domain_size), false);
+    Finish(cq);
+    for (uint32_t f=0;f<num_frames;f++) {
+        memcpy(batch[f]->result_r, &lane->batch_r[f*domain_size], sizeof(float) * domain_size);
+        memcpy(batch[f]->result_i, &lane->batch_i[f*domain_size], sizeof(float) * domain_size);
+    }
+}
+
+/*
+ * The leading num_points floats of the buffer, rounded up to the DRAM read alignment but no further than the buffer, as
+ * the lane's buffers are sized for the largest batch and moving all of them would cost more than the launch saves
+ */
+static BufferRegion getTransferRegion(std::shared_ptr<Buffer>& buffer, uint32_t num_points) {
+    uint64_t size=(((uint64_t) num_points * 4) + SCHEDULER_TRANSFER_ALIGNMENT - 1) / SCHEDULER_TRANSFER_ALIGNMENT * SCHEDULER_TRANSFER_ALIGNMENT;
+    return BufferRegion(0, std::min(size, (uint64_t) buffer->size()));
+}
+
+// One pass of the load through a scheduler of these limits, the largest error of the checked transforms is kept in max_error
+static void runSchedulerPass(const char * name, uint32_t num_devices, uint32_t max_domain_size, uint32_t num_clients, uint32_t requests_per_client,
+                                double deadline, uint32_t max_batch_frames, bool mocked, float * max_error) {
+    FFTScheduler * scheduler=createFFTScheduler(num_devices, max_domain_size, max_batch_frames, deadline, mocked);
+    std::vector<std::vector<double>> client_latencies(num_clients);
+    std::vector<float> client_errors(num_clients, 0.0f);
+    std::vector<std::thread> clients;
+
+    struct timeval start_time;
+    gettimeofday(&start_time, NULL);
+    for (uint32_t c=0;c<num_clients;c++) {
+        clients.push_back(std::thread(runSchedulerClient, scheduler, c, max_domain_size, requests_per_client, &client_latencies[c], &client_errors[c]));
+    }
+    for (std::thread& client : clients) client.join();
+    double elapsed_time=getElapsedTime(start_time);
+
+    std::vector<double> latencies;
+    for (uint32_t c=0;c<num_clients;c++) {
+        latencies.insert(latencies.end(), client_latencies[c].begin(), client_latencies[c].end());
+        if (client_errors[c] > *max_error) *max_error=client_errors[c];
+    }
+    std::sort(latencies.begin(), latencies.end());
+    size_t num_requests=latencies.size();
+    printf("  %s: %.0f transforms/sec, %.2f frames per launch, latency p50 %.1f us, p99 %.1f us, max %.1f us\n", name,
+            num_requests / elapsed_time, (double) scheduler->num_frames / scheduler->num_launches, latencies[num_requests / 2] * 1e6,
+            latencies[(num_requests * 99) / 100] * 1e6, latencies[num_requests - 1] * 1e6);
+    destroyFFTScheduler(scheduler);
+}
+
+/*
+ * A client submitting one transform at a time and waiting on it, recording the latency of each in latencies. The
+ * random numbers are drawn with rand_r, seeded by the client, as rand is not safe to call from many threads
+ */
+static void runSchedulerClient(FFTScheduler * scheduler, uint32_t client, uint32_t max_domain_size, uint32_t num_requests,
+                                std::vector<double> * latencies, float * max_error) {
+    unsigned int seed=client + 1;
+    uint32_t min_domain_size=max_domain_size < SCHEDULER_MIN_DOMAIN_SIZE ? max_domain_size : SCHEDULER_MIN_DOMAIN_SIZE;
+    uint32_t min_log=0, max_log=0;
+    while ((1u << min_log) < min_domain_size) min_log++;
+    while ((1u << max_log) < max_domain_size) max_log++;
+
+    float * input_r=(float*) malloc(sizeof(float) * max_domain_size);
+    float * input_i=(float*) malloc(sizeof(float) * max_domain_size);
+    float * result_r=(float*) malloc(sizeof(float) * max_domain_size);
+    float * result_i=(float*) malloc(sizeof(float) * max_domain_size);
+    for (uint32_t r=0;r<num_requests;r++) {
+        uint32_t domain_size=1 << (min_log + (rand_r(&seed) % (max_log - min_log + 1)));
+        enum FFTDirection direction=r == 0 || rand_r(&seed) % 2 == 0 ? FFT_FORWARD : FFT_BACKWARD;
+        for (uint32_t i=0;i<domain_size;i++) {
+            input_r[i]=(float) rand_r(&seed)/(float) RAND_MAX;
+            input_i[i]=(float) rand_r(&seed)/(float) RAND_MAX;
+        }
+
+        std::chrono::steady_clock::time_point submit_time=std::chrono::steady_clock::now();
+        submitFFT(scheduler, input_r, input_i, result_r, result_i, domain_size, direction).get();
+        latencies->push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - submit_time).count());
+
+        if (r > 0) continue;
+        double * reference_r=(double*) malloc(sizeof(double) * domain_size);
+        double * reference_i=(double*) malloc(sizeof(double) * domain_size);
+        for (uint32_t i=0;i<domain_size;i++) {
+            reference_r[i]=input_r[i];
+            reference_i[i]=input_i[i];
+        }
+        referenceFFTDouble(reference_r, reference_i, domain_size);
+        float error=0.0f, magnitude=0.0f;
+        for (uint32_t i=0;i<domain_size;i++) {
+            error=fmaxf(error, fmaxf(fabsf(result_r[i] - (float) reference_r[i]), fabsf(result_i[i] - (float) reference_i[i])));
+            magnitude=fmaxf(magnitude, fmaxf(fabsf((float) reference_r[i]), fabsf((float) reference_i[i])));
+        }
+        *max_error=magnitude > 0.0f ? error / magnitude : error;
+        free(reference_r);
+        free(reference_i);
+    }
+    free(input_r);
+    free(input_i);
+    free(result_r);
+    free(result_i);
+}
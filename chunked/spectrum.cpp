@@ -0,0 +1,168 @@
+#include "fft.h"
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+// Indexed by FFTPostStage
+static const char * post_stage_names[]={"none", "power", "db"};
+
+/*
+ * Creates the device buffers for the spectrum of signal_length points, which are windowed and zero padded to
+ * domain_size by the reader as they are gathered. The post stage, which must be set, reduces each point of the spectrum
+ * to a real value in the final compute stage, so the spectrum buffer holds just these and the imaginary result is never written
+ */
+SpectrumPlan* createSpectrumPlan(IDevice* device, CommandQueue& cq, TTExecution * device_descriptor, float * window, uint32_t domain_size,
+                                    uint32_t signal_length, enum FFTPostStage post_stage) {
+    SpectrumPlan * plan=new SpectrumPlan();
+    plan->device_descriptor=device_descriptor;
+    plan->domain_size=domain_size;
+    plan->signal_length=signal_length;
+
+    tt_metal::InterleavedBufferConfig signal_dram_config{
+        .device = device,
+        .size = signal_length * 4,
+        .page_size = signal_length * 4,
+        .buffer_type = tt_metal::BufferType::DRAM};
+    tt_metal::InterleavedBufferConfig spectrum_dram_config{
+        .device = device,
+        .size = domain_size * 4,
+        .page_size = domain_size * 4,
+        .buffer_type = tt_metal::BufferType::DRAM};
+    tt::tt_metal::InterleavedBufferConfig l1_window_buffer_config{
+        .device= device,
+        .size = signal_length * 4,
+        .page_size = signal_length * 4,
+        .buffer_type = tt::tt_metal::BufferType::L1};
+
+    plan->signal_r_dram_buffer=CreateBuffer(signal_dram_config);
+    plan->signal_i_dram_buffer=CreateBuffer(signal_dram_config);
+    plan->spectrum_dram_buffer=CreateBuffer(spectrum_dram_config);
+
+    plan->batch.num_frames=1;
+    plan->batch.frame_stride=0;
+    plan->batch.input_length=signal_length;
+    plan->batch.post_stage=post_stage;
+    if (window != NULL) {
+        // The window is the same length as the signal, so shares its DRAM layout
+        plan->batch.window_dram_buffer=CreateBuffer(signal_dram_config);
+        plan->batch.window_buffer=CreateBuffer(l1_window_buffer_config);
+        EnqueueWriteBuffer(cq, plan->batch.window_dram_buffer, window, true);
+    }
+    return plan;
+}
+
+/*
+ * The spectrum of domain_size real points is returned. As the launch only writes the real output, the spectrum
+ * buffer is given as both result buffers and just the one is downloaded
+ */
+void spectrum(CommandQueue& cq, SpectrumPlan * plan, float * signal_r, float * signal_i, float * twiddle_factors, float * result) {
+    TTExecution * device_descriptor=plan->device_descriptor;
+    struct timeval start_time;
+
+    gettimeofday(&start_time, NULL);
+    EnqueueWriteBuffer(cq, plan->signal_r_dram_buffer, signal_r, false);
+    EnqueueWriteBuffer(cq, plan->signal_i_dram_buffer, signal_i, false);
+    if (device_descriptor->twiddle_seed_stride == 0) {
+        EnqueueWriteBuffer(cq, device_descriptor->twiddle_dram_buffer, twiddle_factors, false);
+    }
+    Finish(cq);
+    double xfer_on_time=getElapsedTime(start_time);
+
+    gettimeofday(&start_time, NULL);
+    enqueueFFT(cq, device_descriptor, plan->signal_r_dram_buffer, plan->signal_i_dram_buffer,
+                plan->spectrum_dram_buffer, plan->spectrum_dram_buffer, plan->domain_size, FFT_FORWARD, false, &plan->batch);
+    Finish(cq);
+    double exec_time=getElapsedTime(start_time);
+
+    gettimeofday(&start_time, NULL);
+    EnqueueReadBuffer(cq, plan->spectrum_dram_buffer, result, true);
+    double xfer_off_time=getElapsedTime(start_time);
+
+    double total_time=xfer_on_time+exec_time+xfer_off_time;
+    printf("Spectrum (%s) of %d points padded to %d: total time %.6f sec. %.6f sec transfer on, %.6f sec execution, %.6f sec transfer off\n",
+            post_stage_names[plan->batch.post_stage], plan->signal_length, plan->domain_size, total_time, xfer_on_time, exec_time, xfer_off_time);
+}
+
+void destroySpectrumPlan(SpectrumPlan * plan) {
+    delete plan;
+}
+
+// Returns the post stage named, or -1 if there is no such post stage
+int parsePostStage(const char * name) {
+    for (int i=0;i<(int) (sizeof(post_stage_names) / sizeof(post_stage_names[0]));i++) {
+        if (strcmp(name, post_stage_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/*
+ * The windowed signal zero padded to domain_size, transformed by a reference DFT and reduced by the post stage.
+ * Without a post stage the result is the real part of the spectrum
+ */
+void referenceSpectrum(float * signal_r, float * signal_i, float * window, float * result, uint32_t domain_size, uint32_t signal_length,
+                        enum FFTPostStage post_stage) {
+    float * padded_r=(float*) calloc(domain_size, sizeof(float));
+    float * padded_i=(float*) calloc(domain_size, sizeof(float));
+    float * spectrum_r=(float*) malloc(sizeof(float) * domain_size);
+    float * spectrum_i=(float*) malloc(sizeof(float) * domain_size);
+    for (uint32_t i=0;i<signal_length;i++) {
+        padded_r[i]=window != NULL ? signal_r[i] * window[i] : signal_r[i];
+        padded_i[i]=window != NULL ? signal_i[i] * window[i] : signal_i[i];
+    }
+    referenceDFT(padded_r, padded_i, spectrum_r, spectrum_i, domain_size);
+    for (uint32_t i=0;i<domain_size;i++) {
+        float power=(spectrum_r[i] * spectrum_r[i]) + (spectrum_i[i] * spectrum_i[i]);
+        if (post_stage == POWER_POST_STAGE) {
+            result[i]=power;
+        } else if (post_stage == DECIBEL_POST_STAGE) {
+            result[i]=10.0f * log10f(fmaxf(power, SPECTRUM_POWER_FLOOR));
+        } else {
+            result[i]=spectrum_r[i];
+        }
+    }
+    free(padded_r);
+    free(padded_i);
+    free(spectrum_r);
+    free(spectrum_i);
+}
+
+/*
+ * Blackman windowed spectrum of a random signal of signal_length points, checked against the reference. Decibels
+ * are compared directly, as an absolute error in dB is already relative to the power
+ */
+void runSpectrum(IDevice* device, CommandQueue& cq, TTExecution * device_descriptor, float * twiddle_factors, uint32_t domain_size,
+                    uint32_t signal_length, enum FFTPostStage post_stage) {
+    float * signal_r=(float*) malloc(sizeof(float) * signal_length);
+    float * signal_i=(float*) malloc(sizeof(float) * signal_length);
+    for (uint32_t i=0;i<signal_length;i++) {
+        signal_r[i]=(float) rand()/(float) RAND_MAX;
+        signal_i[i]=(float) rand()/(float) RAND_MAX;
+    }
+    float * window=computeBlackmanWindow(signal_length);
+
+    SpectrumPlan * plan=createSpectrumPlan(device, cq, device_descriptor, window, domain_size, signal_length, post_stage);
+    float * result=(float*) malloc(sizeof(float) * domain_size);
+    spectrum(cq, plan, signal_r, signal_i, twiddle_factors, result);
+
+    float * reference=(float*) malloc(sizeof(float) * domain_size);
+    referenceSpectrum(signal_r, signal_i, window, reference, domain_size, signal_length, post_stage);
+    float max_error=0.0f, max_magnitude=0.0f;
+    for (uint32_t i=0;i<domain_size;i++) {
+        float error=fabsf(result[i] - reference[i]);
+        if (error > max_error) max_error=error;
+        if (fabsf(reference[i]) > max_magnitude) max_magnitude=fabsf(reference[i]);
+    }
+    if (post_stage == DECIBEL_POST_STAGE) {
+        printf("Checked %d elements against reference DFT: maximum error %f dB\n", domain_size, max_error);
+    } else {
+        printf("Checked %d elements against reference DFT: maximum error %e, relative to largest magnitude %e\n",
+                domain_size, max_error, max_magnitude > 0.0f ? max_error / max_magnitude : max_error);
+    }
+
+    destroySpectrumPlan(plan);
+    free(signal_r);
+    free(signal_i);
+    free(window);
+    free(result);
+    free(reference);
+}
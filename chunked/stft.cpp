@@ -0,0 +1,151 @@
+#include "fft.h"
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+/*
+ * Creates the device buffers for a signal of signal_length points, split into frames of domain_size points
+ * that start hop points apart. The window is uploaded once here, and the reader multiplies each frame by it
+ * as the frame is gathered from the signal, so overlapping points are only ever uploaded once. Returns NULL if the
+ * signal is shorter than one frame or the hop is zero, as there would then be no frames to transform
+ */
+STFTPlan* createSTFTPlan(IDevice* device, CommandQueue& cq, TTExecution * device_descriptor, float * window, uint32_t domain_size,
+                            uint32_t signal_length, uint32_t hop) {
+    if (signal_length < domain_size || hop == 0) return NULL;
+    STFTPlan * plan=new STFTPlan();
+    plan->device_descriptor=device_descriptor;
+    plan->domain_size=domain_size;
+    plan->signal_length=signal_length;
+    plan->num_frames=((signal_length - domain_size) / hop) + 1;
+
+    tt_metal::InterleavedBufferConfig signal_dram_config{
+        .device = device,
+        .size = signal_length * 4,
+        .page_size = signal_length * 4,
+        .buffer_type = tt_metal::BufferType::DRAM};
+    tt_metal::InterleavedBufferConfig spectra_dram_config{
+        .device = device,
+        .size = plan->num_frames * domain_size * 4,
+        .page_size = plan->num_frames * domain_size * 4,
+        .buffer_type = tt_metal::BufferType::DRAM};
+    tt_metal::InterleavedBufferConfig window_dram_config{
+        .device = device,
+        .size = domain_size * 4,
+        .page_size = domain_size * 4,
+        .buffer_type = tt_metal::BufferType::DRAM};
+    tt::tt_metal::InterleavedBufferConfig l1_window_buffer_config{
+        .device= device,
+        .size = domain_size * 4,
+        .page_size = domain_size * 4,
+        .buffer_type = tt::tt_metal::BufferType::L1};
+
+    plan->signal_r_dram_buffer=CreateBuffer(signal_dram_config);
+    plan->signal_i_dram_buffer=CreateBuffer(signal_dram_config);
+    plan->spectra_r_dram_buffer=CreateBuffer(spectra_dram_config);
+    plan->spectra_i_dram_buffer=CreateBuffer(spectra_dram_config);
+
+    plan->batch.num_frames=plan->num_frames;
+    plan->batch.frame_stride=hop;
+    plan->batch.window_dram_buffer=CreateBuffer(window_dram_config);
+    plan->batch.window_buffer=CreateBuffer(l1_window_buffer_config);
+    EnqueueWriteBuffer(cq, plan->batch.window_dram_buffer, window, true);
+    return plan;
+}
+
+// Spectra are returned frame after frame, each of domain_size points
+void stft(CommandQueue& cq, STFTPlan * plan, float * signal_r, float * signal_i, float * twiddle_factors, float * spectra_r, float * spectra_i) {
+    TTExecution * device_descriptor=plan->device_descriptor;
+    struct timeval start_time;
+
+    gettimeofday(&start_time, NULL);
+    EnqueueWriteBuffer(cq, plan->signal_r_dram_buffer, signal_r, false);
+    EnqueueWriteBuffer(cq, plan->signal_i_dram_buffer, signal_i, false);
+    if (device_descriptor->twiddle_seed_stride == 0) {
+        EnqueueWriteBuffer(cq, device_descriptor->twiddle_dram_buffer, twiddle_factors, false);
+    }
+    Finish(cq);
+    double xfer_on_time=getElapsedTime(start_time);
+
+    gettimeofday(&start_time, NULL);
+    enqueueFFT(cq, device_descriptor, plan->signal_r_dram_buffer, plan->signal_i_dram_buffer,
+                plan->spectra_r_dram_buffer, plan->spectra_i_dram_buffer, plan->domain_size, FFT_FORWARD, false, &plan->batch);
+    Finish(cq);
+    double exec_time=getElapsedTime(start_time);
+
+    gettimeofday(&start_time, NULL);
+    EnqueueReadBuffer(cq, plan->spectra_r_dram_buffer, spectra_r, false);
+    EnqueueReadBuffer(cq, plan->spectra_i_dram_buffer, spectra_i, false);
+    Finish(cq);
+    double xfer_off_time=getElapsedTime(start_time);
+
+    double total_time=xfer_on_time+exec_time+xfer_off_time;
+    printf("STFT of %d frames of size %d: total time %.6f sec. %.6f sec transfer on, %.6f sec execution, %.6f sec transfer off\n",
+            plan->num_frames, plan->domain_size, total_time, xfer_on_time, exec_time, xfer_off_time);
+}
+
+void destroySTFTPlan(STFTPlan * plan) {
+    delete plan;
+}
+
+// Periodic Hann window, as used for spectral analysis
+float* computeHannWindow(uint32_t n) {
+    float * window=(float*) malloc(sizeof(float) * n);
+    for (uint32_t i=0;i<n;i++) {
+        window[i]=(float) (0.5 - (0.5 * cos((2.0 * PI * i)/(double) n)));
+    }
+    return window;
+}
+
+// Periodic Blackman window, with lower sidelobes than Hann at the cost of a wider main lobe
+float* computeBlackmanWindow(uint32_t n) {
+    float * window=(float*) malloc(sizeof(float) * n);
+    for (uint32_t i=0;i<n;i++) {
+        double phase=(2.0 * PI * i)/(double) n;
+        window[i]=(float) (0.42 - (0.5 * cos(phase)) + (0.08 * cos(2.0 * phase)));
+    }
+    return window;
+}
+
+/*
+ * STFT of a random signal eight frames long with a Hann window, each frame is checked against a reference
+ * DFT of the windowed frame on the host
+ */
+void runSTFT(IDevice* device, CommandQueue& cq, TTExecution * device_descriptor, float * twiddle_factors, uint32_t domain_size, uint32_t hop) {
+    uint32_t signal_length=domain_size * 8;
+    float * signal_r=(float*) malloc(sizeof(float) * signal_length);
+    float * signal_i=(float*) malloc(sizeof(float) * signal_length);
+    for (uint32_t i=0;i<signal_length;i++) {
+        signal_r[i]=(float) rand()/(float) RAND_MAX;
+        signal_i[i]=(float) rand()/(float) RAND_MAX;
+    }
+    float * window=computeHannWindow(domain_size);
+
+    STFTPlan * plan=createSTFTPlan(device, cq, device_descriptor, window, domain_size, signal_length, hop);
+    float * spectra_r=(float*) malloc(sizeof(float) * plan->num_frames * domain_size);
+    float * spectra_i=(float*) malloc(sizeof(float) * plan->num_frames * domain_size);
+    stft(cq, plan, signal_r, signal_i, twiddle_factors, spectra_r, spectra_i);
+
+    float * frame_r=(float*) malloc(sizeof(float) * domain_size);
+    float * frame_i=(float*) malloc(sizeof(float) * domain_size);
+    float * reference_r=(float*) malloc(sizeof(float) * plan->num_frames * domain_size);
+    float * reference_i=(float*) malloc(sizeof(float) * plan->num_frames * domain_size);
+    for (uint32_t frame=0;frame<plan->num_frames;frame++) {
+        for (uint32_t i=0;i<domain_size;i++) {
+            frame_r[i]=signal_r[(frame*hop)+i] * window[i];
+            frame_i[i]=signal_i[(frame*hop)+i] * window[i];
+        }
+        referenceDFT(frame_r, frame_i, &reference_r[frame*domain_size], &reference_i[frame*domain_size], domain_size);
+    }
+    checkAgainstReference(spectra_r, spectra_i, reference_r, reference_i, plan->num_frames * domain_size);
+
+    destroySTFTPlan(plan);
+    free(signal_r);
+    free(signal_i);
+    free(window);
+    free(spectra_r);
+    free(spectra_i);
+    free(frame_r);
+    free(frame_i);
+    free(reference_r);
+    free(reference_i);
+}
@@ -0,0 +1,194 @@
+#include "fft.h"
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+// The whole domain is held in one tile per circular buffer, so it is limited to the points that fit in a tile
+#define WHOLE_DOMAIN_MAX_SIZE 1024
+// Timed launches of each strategy when choosing between them, after an untimed launch that compiles the kernels
+#define STRATEGY_BENCHMARK_RUNS 5
+
+static bool chunkedSupports(TTExecution*, uint32_t, bool, FFTBatch*);
+static bool wholeDomainSupports(TTExecution*, uint32_t, bool, FFTBatch*);
+static void createWholeDomainProgram(Program&, CoreCoord&, uint32_t, bool, bool, enum FFTComputeBackend, std::shared_ptr<Buffer>, std::shared_ptr<Buffer>,
+                                        std::vector<uint32_t>, KernelHandle*, KernelHandle*, KernelHandle*, uint32_t*);
+static void setWholeDomainRuntimeArgs(TTExecution*, Program&, KernelHandle, KernelHandle, KernelHandle, uint32_t, std::shared_ptr<Buffer>,
+                                        std::shared_ptr<Buffer>, std::shared_ptr<Buffer>, std::shared_ptr<Buffer>, uint32_t, enum FFTDirection, bool, FFTBatch*);
+static enum FFTStrategy benchmarkStrategies(CommandQueue&, TTExecution*, std::shared_ptr<Buffer>, std::shared_ptr<Buffer>, std::shared_ptr<Buffer>,
+                                                std::shared_ptr<Buffer>, uint32_t, enum FFTDirection);
+
+/*
+ * Indexed by FFTStrategy. The chunked pipeline streams the domain through the core a chunk at a time so handles every
+ * size and option, whereas the whole domain pipeline holds all the points in one tile and transforms real and imaginary
+ * parts as whole tiles, with less overhead per stage but only up to a tile of points. Further pipelines, such as a
+ * Stockham or radix-4 variant, are added here along with their kernels
+ */
+static const FFTStrategyDescriptor fft_strategies[]={
+    {"chunked", chunkedSupports, createFFTProgram, setChunkedRuntimeArgs},
+    {"whole-domain", wholeDomainSupports, createWholeDomainProgram, setWholeDomainRuntimeArgs}
+};
+
+const FFTStrategyDescriptor* getFFTStrategy(enum FFTStrategy strategy) {
+    return &fft_strategies[strategy];
+}
+
+// Returns the strategy named, or -1 if there is no such strategy
+int parseFFTStrategy(const char * name) {
+    if (strcmp(name, "auto") == 0) return AUTO_STRATEGY;
+    for (int i=0;i<(int) (sizeof(fft_strategies) / sizeof(fft_strategies[0]));i++) {
+        if (strcmp(name, fft_strategies[i].name) == 0) return i;
+    }
+    return -1;
+}
+
+/*
+ * The strategy that a launch runs with. A requested strategy that does not support the launch falls back to chunked,
+ * and with auto the supported strategies are timed against each other on the first transform of each domain size,
+ * with the fastest recorded in the execution and used from then on
+ */
+enum FFTStrategy selectFFTStrategy(CommandQueue& cq, TTExecution * device_descriptor, std::shared_ptr<Buffer> in_data_r_dram_buffer,
+                                    std::shared_ptr<Buffer> in_data_i_dram_buffer, std::shared_ptr<Buffer> result_data_r_dram_buffer,
+                                    std::shared_ptr<Buffer> result_data_i_dram_buffer, uint32_t domain_size, enum FFTDirection direction,
+                                    bool pointwise_multiply, FFTBatch * batch) {
+    if (device_descriptor->strategy != AUTO_STRATEGY) {
+        return getFFTStrategy(device_descriptor->strategy)->supports(device_descriptor, domain_size, pointwise_multiply, batch) ?
+                    device_descriptor->strategy : CHUNKED_STRATEGY;
+    }
+    if (!wholeDomainSupports(device_descriptor, domain_size, pointwise_multiply, batch)) return CHUNKED_STRATEGY;
+
+    for (std::pair<uint32_t, enum FFTStrategy> & choice : device_descriptor->strategy_choices) {
+        if (choice.first == domain_size) return choice.second;
+    }
+    // The benchmark launches overwrite the result, so it can only be run when this is not also the input
+    enum FFTStrategy strategy=WHOLE_DOMAIN_STRATEGY;
+    if (in_data_r_dram_buffer != result_data_r_dram_buffer && in_data_i_dram_buffer != result_data_i_dram_buffer &&
+            in_data_r_dram_buffer != result_data_i_dram_buffer && in_data_i_dram_buffer != result_data_r_dram_buffer) {
+        strategy=benchmarkStrategies(cq, device_descriptor, in_data_r_dram_buffer, in_data_i_dram_buffer, result_data_r_dram_buffer,
+                                        result_data_i_dram_buffer, domain_size, direction);
+    }
+    device_descriptor->strategy_choices.push_back({domain_size, strategy});
+    return strategy;
+}
+
+// The generic chunked program is used unless kernels are specialised, every other strategy runs from a plan
+FFTPlan* getStrategyPlan(TTExecution * device_descriptor, uint32_t domain_size, enum FFTDirection direction, enum FFTStrategy strategy) {
+    if (strategy == CHUNKED_STRATEGY && !device_descriptor->specialise_kernels) return NULL;
+    return getFFTPlan(device_descriptor, domain_size, direction, strategy, device_descriptor->compute_backend);
+}
+
+/*
+ * Times the chunked and whole domain strategies on the provided buffers, both are launched once first so that
+ * kernel compilation is not included. The direction does not change the work done, so the choice holds for both
+ */
+static enum FFTStrategy benchmarkStrategies(CommandQueue& cq, TTExecution * device_descriptor, std::shared_ptr<Buffer> in_data_r_dram_buffer,
+                                                std::shared_ptr<Buffer> in_data_i_dram_buffer, std::shared_ptr<Buffer> result_data_r_dram_buffer,
+                                                std::shared_ptr<Buffer> result_data_i_dram_buffer, uint32_t domain_size, enum FFTDirection direction) {
+    enum FFTStrategy candidates[]={CHUNKED_STRATEGY, WHOLE_DOMAIN_STRATEGY};
+    double times[2];
+    for (int i=0;i<2;i++) {
+        FFTPlan * plan=getStrategyPlan(device_descriptor, domain_size, direction, candidates[i]);
+        enqueuePlannedFFT(cq, device_descriptor, plan, in_data_r_dram_buffer, in_data_i_dram_buffer, result_data_r_dram_buffer,
+                            result_data_i_dram_buffer, domain_size, direction, false, NULL);
+        Finish(cq);
+
+        struct timeval start_time;
+        gettimeofday(&start_time, NULL);
+        for (int j=0;j<STRATEGY_BENCHMARK_RUNS;j++) {
+            enqueuePlannedFFT(cq, device_descriptor, plan, in_data_r_dram_buffer, in_data_i_dram_buffer, result_data_r_dram_buffer,
+                                result_data_i_dram_buffer, domain_size, direction, false, NULL);
+        }
+        Finish(cq);
+        times[i]=getElapsedTime(start_time) / STRATEGY_BENCHMARK_RUNS;
+    }
+
+    int fastest=times[1] < times[0] ? 1 : 0;
+    printf("Strategy for domain size %d: %s at %.6f sec per transform, %s at %.6f sec\n", domain_size,
+            getFFTStrategy(candidates[fastest])->name, times[fastest], getFFTStrategy(candidates[1-fastest])->name, times[1-fastest]);
+    return candidates[fastest];
+}
+
+static bool chunkedSupports(TTExecution * device_descriptor, uint32_t domain_size, bool pointwise_multiply, FFTBatch * batch) {
+    return true;
+}
+
+// A single frame with the full twiddle table, the whole domain kernels have no filter multiply, batching or generated twiddles
+static bool wholeDomainSupports(TTExecution * device_descriptor, uint32_t domain_size, bool pointwise_multiply, FFTBatch * batch) {
+    return domain_size <= WHOLE_DOMAIN_MAX_SIZE && !pointwise_multiply && batch == NULL &&
+            device_descriptor->twiddle_seed_stride == 0 && !device_descriptor->compact_twiddles;
+}
+
+/*
+ * Every circular buffer is a single tile holding the whole domain, with the same index map as the chunked program. The
+ * kernels take everything as runtime arguments and stage pipelining is not used, but the compile arguments are still
+ * passed as constants.h reads them, which the compute kernel includes for the backend defines. The staging buffers of
+ * the arena are only used by the reader as its scratch space rather than backing any CBs
+ */
+static void createWholeDomainProgram(Program & program, CoreCoord & core, uint32_t domain_size, bool convolve, bool pipeline_stages,
+                                        enum FFTComputeBackend compute_backend, std::shared_ptr<Buffer> staging_r_buffer, std::shared_ptr<Buffer> staging_i_buffer,
+                                        std::vector<uint32_t> compile_args, KernelHandle * reader_kernel_id, KernelHandle * writer_kernel_id,
+                                        KernelHandle * compute_kernel_id, uint32_t * stage_progress_semaphore) {
+    uint32_t cb_tile_size=WHOLE_DOMAIN_MAX_SIZE * 4;
+    // Data 0 and data 1 into compute, then the twiddle factors
+    for (uint32_t cb=CBIndex::c_0; cb <= CBIndex::c_5; cb++) createCB(program, core, cb, 1, cb_tile_size);
+    // Data 0 and data 1 out from compute
+    for (uint32_t cb=CBIndex::c_6; cb <= CBIndex::c_9; cb++) createCB(program, core, cb, 1, cb_tile_size);
+    // Real and imaginary rearranged from writer
+    createCB(program, core, CBIndex::c_10, 1, cb_tile_size);
+    createCB(program, core, CBIndex::c_11, 1, cb_tile_size);
+    // Intermediate results, then f0 and f1
+    for (uint32_t cb=CBIndex::c_12; cb <= CBIndex::c_16; cb++) createCB(program, core, cb, 1, cb_tile_size);
+
+    *reader_kernel_id = CreateKernel(
+        program,
+        "kernels/dataflow/whole_domain_reader.cpp",
+        core,
+        DataMovementConfig{.processor = DataMovementProcessor::RISCV_1, .noc = NOC::RISCV_1_default, .compile_args = compile_args});
+
+    *writer_kernel_id = CreateKernel(
+        program,
+        "kernels/dataflow/whole_domain_writer.cpp",
+        core,
+        DataMovementConfig{.processor = DataMovementProcessor::RISCV_0, .noc = NOC::RISCV_0_default, .compile_args = compile_args});
+
+    *compute_kernel_id = CreateKernel(
+        program,
+        "kernels/compute/whole_domain_compute.cpp",
+        core,
+        ComputeConfig{
+            .math_fidelity = MathFidelity::HiFi4,
+            .fp32_dest_acc_en = false,
+            .math_approx_mode = false,
+            .compile_args = compile_args,
+            .defines = {{"COMPUTE_BACKEND", std::to_string(compute_backend)}},
+        });
+}
+
+// The real and imaginary parts are read in turn into the first staging buffer, which is otherwise unused by this program
+static void setWholeDomainRuntimeArgs(TTExecution * device_descriptor, Program & program, KernelHandle read_kernel, KernelHandle write_kernel,
+                                        KernelHandle compute_kernel, uint32_t stage_progress_semaphore, std::shared_ptr<Buffer> in_data_r_dram_buffer,
+                                        std::shared_ptr<Buffer> in_data_i_dram_buffer, std::shared_ptr<Buffer> result_data_r_dram_buffer,
+                                        std::shared_ptr<Buffer> result_data_i_dram_buffer, uint32_t domain_size, enum FFTDirection direction,
+                                        bool pointwise_multiply, FFTBatch * batch) {
+    // Since all interleaved buffers have size == page_size, they are entirely contained in the first DRAM bank
+    const std::vector<uint32_t> read_kernel_runtime_args = {
+            in_data_r_dram_buffer->address(),
+            in_data_i_dram_buffer->address(),
+            device_descriptor->twiddle_dram_buffer->address(),
+            0,
+            0,
+            0,
+            device_descriptor->staging_r_buffer->address(),
+            device_descriptor->twiddle_buffer->address(),
+            domain_size};
+
+    const std::vector<uint32_t> write_kernel_runtime_args = {
+            result_data_r_dram_buffer->address(),
+            result_data_i_dram_buffer->address(),
+            0,
+            0,
+            domain_size};
+
+    SetRuntimeArgs(program, read_kernel, *(device_descriptor->core), read_kernel_runtime_args);
+    SetRuntimeArgs(program, compute_kernel, *(device_descriptor->core), {direction, domain_size});
+    SetRuntimeArgs(program, write_kernel, *(device_descriptor->core), write_kernel_runtime_args);
+}
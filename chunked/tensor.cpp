@@ -0,0 +1,89 @@
+#include "fft.h"
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+// Complex data of domain_size points held in DRAM, contents are undefined until uploaded or written by a transform
+DeviceTensor* createDeviceTensor(IDevice* device, uint32_t domain_size) {
+    tt_metal::InterleavedBufferConfig dram_config{
+        .device = device,
+        .size = domain_size * 4,
+        .page_size = domain_size * 4,
+        .buffer_type = tt_metal::BufferType::DRAM};
+
+    DeviceTensor * tensor=new DeviceTensor();
+    tensor->domain_size=domain_size;
+    tensor->r_dram_buffer=CreateBuffer(dram_config);
+    tensor->i_dram_buffer=CreateBuffer(dram_config);
+    return tensor;
+}
+
+void destroyDeviceTensor(DeviceTensor * tensor) {
+    delete tensor;
+}
+
+// Does not wait, so the host arrays must stay valid until the queue is next finished
+void uploadDeviceTensor(CommandQueue& cq, DeviceTensor * tensor, float * data_r, float * data_i) {
+    EnqueueWriteBuffer(cq, tensor->r_dram_buffer, data_r, false);
+    EnqueueWriteBuffer(cq, tensor->i_dram_buffer, data_i, false);
+}
+
+// Waits for all preceding work on the queue, so the data is in the host arrays on return
+void downloadDeviceTensor(CommandQueue& cq, DeviceTensor * tensor, float * data_r, float * data_i) {
+    EnqueueReadBuffer(cq, tensor->r_dram_buffer, data_r, false);
+    EnqueueReadBuffer(cq, tensor->i_dram_buffer, data_i, false);
+    Finish(cq);
+}
+
+// Twiddles are uploaded once for a chain of tensor transforms, they are not needed if generated on the device
+void uploadTwiddleFactors(CommandQueue& cq, TTExecution * device_descriptor, float * twiddle_factors) {
+    if (device_descriptor->twiddle_seed_stride == 0) {
+        EnqueueWriteBuffer(cq, device_descriptor->twiddle_dram_buffer, twiddle_factors, false);
+    }
+}
+
+/*
+ * Enqueues the transform of one tensor into another without waiting or moving any data to the host, so
+ * transforms can be chained on the device with only the final result read back. If multiply_filter is
+ * set the spectrum is multiplied by the resident convolution filter in the final stage. The input and
+ * result must be different tensors
+ */
+void fftDeviceTensor(CommandQueue& cq, TTExecution * device_descriptor, DeviceTensor * input, DeviceTensor * result,
+                        enum FFTDirection direction, bool multiply_filter) {
+    enqueueFFT(cq, device_descriptor, input->r_dram_buffer, input->i_dram_buffer, result->r_dram_buffer, result->i_dram_buffer,
+                input->domain_size, direction, multiply_filter, NULL);
+}
+
+/*
+ * Forward then backward transform with the data resident on the device in between, so there is a single
+ * upload and download rather than a round trip per transform
+ */
+void fftRoundTrip(IDevice* device, CommandQueue& cq, TTExecution * device_descriptor, float * data_r, float * data_i,
+                    float * twiddle_factors, uint32_t domain_size) {
+    DeviceTensor * signal=createDeviceTensor(device, domain_size);
+    DeviceTensor * spectrum=createDeviceTensor(device, domain_size);
+    struct timeval start_time;
+
+    gettimeofday(&start_time, NULL);
+    uploadDeviceTensor(cq, signal, data_r, data_i);
+    uploadTwiddleFactors(cq, device_descriptor, twiddle_factors);
+    Finish(cq);
+    double xfer_on_time=getElapsedTime(start_time);
+
+    gettimeofday(&start_time, NULL);
+    fftDeviceTensor(cq, device_descriptor, signal, spectrum, FFT_FORWARD, false);
+    fftDeviceTensor(cq, device_descriptor, spectrum, signal, FFT_BACKWARD, false);
+    Finish(cq);
+    double exec_time=getElapsedTime(start_time);
+
+    gettimeofday(&start_time, NULL);
+    downloadDeviceTensor(cq, signal, data_r, data_i);
+    double xfer_off_time=getElapsedTime(start_time);
+
+    double total_time=xfer_on_time+exec_time+xfer_off_time;
+    printf("Round trip FFT of size %d: total time %.6f sec. %.6f sec transfer on, %.6f sec execution, %.6f sec transfer off\n",
+            domain_size, total_time, xfer_on_time, exec_time, xfer_off_time);
+
+    destroyDeviceTensor(signal);
+    destroyDeviceTensor(spectrum);
+}
@@ -0,0 +1,154 @@
+#include "fft.h"
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+// The traces are captured on and replayed to the device's first command queue, which all launches are enqueued on
+#define TRACE_CQ_ID 0
+
+static void traceInputs(CommandQueue&, FFTTrace*, float*, float*);
+
+/*
+ * Captures the device commands of one transform of domain_size points in direction, from the execution's input
+ * buffers to its result buffers. A transform is first run untraced, which compiles the program and makes any
+ * strategy choice, as neither can happen during capture. Only commands on the device can be held in a trace, so
+ * the data transfers are enqueued around each replay rather than recorded. The twiddles are uploaded here once
+ */
+FFTTrace* createFFTTrace(IDevice* device, CommandQueue& cq, TTExecution * device_descriptor, float * twiddle_factors, uint32_t domain_size,
+                            enum FFTDirection direction) {
+    FFTTrace * trace=new FFTTrace();
+    trace->device=device;
+    trace->cq=&cq;
+    trace->device_descriptor=device_descriptor;
+    trace->domain_size=domain_size;
+    trace->direction=direction;
+    trace->emulated=false;
+
+    uploadTwiddleFactors(cq, device_descriptor, twiddle_factors);
+    enqueueFFT(cq, device_descriptor, device_descriptor->in_data_r_dram_buffer, device_descriptor->in_data_i_dram_buffer,
+                device_descriptor->result_data_r_dram_buffer, device_descriptor->result_data_i_dram_buffer, domain_size, direction, false, NULL);
+    Finish(cq);
+
+    trace->trace_id=BeginTraceCapture(device, TRACE_CQ_ID);
+    enqueueFFT(cq, device_descriptor, device_descriptor->in_data_r_dram_buffer, device_descriptor->in_data_i_dram_buffer,
+                device_descriptor->result_data_r_dram_buffer, device_descriptor->result_data_i_dram_buffer, domain_size, direction, false, NULL);
+    EndTraceCapture(device, TRACE_CQ_ID, trace->trace_id);
+    return trace;
+}
+
+/*
+ * A trace without a device, each replay runs the chunked kernels on the host through emulateFFT. twiddle_data is the
+ * table as it would be uploaded (see emulateFFT), which must stay valid until the trace is destroyed
+ */
+FFTTrace* createEmulatedFFTTrace(float * twiddle_data, uint32_t domain_size, enum FFTDirection direction, uint32_t twiddle_seed_stride,
+                                    bool compact_twiddles, bool local_substages) {
+    FFTTrace * trace=new FFTTrace();
+    trace->domain_size=domain_size;
+    trace->direction=direction;
+    trace->emulated=true;
+    trace->twiddle_data=twiddle_data;
+    trace->twiddle_seed_stride=twiddle_seed_stride;
+    trace->compact_twiddles=compact_twiddles;
+    trace->local_substages=local_substages;
+    return trace;
+}
+
+/*
+ * Transforms the input through the captured commands, so nothing is dispatched for the program itself. The input and
+ * result are host arrays of domain_size points, as for fft
+ */
+void replayFFTTrace(FFTTrace * trace, float * input_r, float * input_i, float * result_r, float * result_i) {
+    if (trace->emulated) {
+        emulateFFT(input_r, input_i, trace->twiddle_data, result_r, result_i, trace->domain_size, trace->direction, trace->twiddle_seed_stride,
+                    trace->compact_twiddles, trace->local_substages);
+        return;
+    }
+    CommandQueue& cq=*trace->cq;
+    traceInputs(cq, trace, input_r, input_i);
+    ReplayTrace(trace->device, TRACE_CQ_ID, trace->trace_id, false);
+    EnqueueReadBuffer(cq, trace->device_descriptor->result_data_r_dram_buffer, result_r, false);
+    EnqueueReadBuffer(cq, trace->device_descriptor->result_data_i_dram_buffer, result_i, false);
+    Finish(cq);
+}
+
+void destroyFFTTrace(FFTTrace * trace) {
+    if (!trace->emulated) ReleaseTrace(trace->device, trace->trace_id);
+    delete trace;
+}
+
+/*
+ * Times num_replays transforms of a random signal dispatched as usual through fft's launch path, then the same
+ * through the trace, and checks the first replay against a double precision reference. With no device the trace
+ * is emulated on the host, which exercises the same capture and replay path without the timing comparison
+ */
+void runTrace(IDevice* device, CommandQueue * cq, TTExecution * device_descriptor, float * twiddle_data, uint32_t domain_size,
+                uint32_t twiddle_seed_stride, bool compact_twiddles, bool local_substages, uint32_t num_replays) {
+    float * signal_r=allocateHostBuffer(domain_size);
+    float * signal_i=allocateHostBuffer(domain_size);
+    float * result_r=allocateHostBuffer(domain_size);
+    float * result_i=allocateHostBuffer(domain_size);
+    double * reference_r=(double*) malloc(sizeof(double) * domain_size);
+    double * reference_i=(double*) malloc(sizeof(double) * domain_size);
+    for (uint32_t i=0;i<domain_size;i++) {
+        signal_r[i]=(float) rand()/(float) RAND_MAX;
+        signal_i[i]=(float) rand()/(float) RAND_MAX;
+        reference_r[i]=signal_r[i];
+        reference_i[i]=signal_i[i];
+    }
+    referenceFFTDouble(reference_r, reference_i, domain_size);
+
+    FFTTrace * trace;
+    struct timeval start_time;
+    double untraced_time=0.0;
+    if (device != NULL) {
+        trace=createFFTTrace(device, *cq, device_descriptor, twiddle_data, domain_size, FFT_FORWARD);
+        gettimeofday(&start_time, NULL);
+        for (uint32_t run=0;run<num_replays;run++) {
+            traceInputs(*cq, trace, signal_r, signal_i);
+            enqueueFFT(*cq, device_descriptor, device_descriptor->in_data_r_dram_buffer, device_descriptor->in_data_i_dram_buffer,
+                        device_descriptor->result_data_r_dram_buffer, device_descriptor->result_data_i_dram_buffer, domain_size, FFT_FORWARD, false, NULL);
+            EnqueueReadBuffer(*cq, device_descriptor->result_data_r_dram_buffer, result_r, false);
+            EnqueueReadBuffer(*cq, device_descriptor->result_data_i_dram_buffer, result_i, false);
+            Finish(*cq);
+        }
+        untraced_time=getElapsedTime(start_time) / num_replays;
+    } else {
+        trace=createEmulatedFFTTrace(twiddle_data, domain_size, FFT_FORWARD, twiddle_seed_stride, compact_twiddles, local_substages);
+    }
+
+    float max_error=0.0f, max_magnitude=0.0f;
+    gettimeofday(&start_time, NULL);
+    for (uint32_t run=0;run<num_replays;run++) {
+        replayFFTTrace(trace, signal_r, signal_i, result_r, result_i);
+        if (run > 0) continue;
+        for (uint32_t i=0;i<domain_size;i++) {
+            float error=fmaxf(fabsf(result_r[i] - (float) reference_r[i]), fabsf(result_i[i] - (float) reference_i[i]));
+            float magnitude=fmaxf(fabsf((float) reference_r[i]), fabsf((float) reference_i[i]));
+            if (error > max_error) max_error=error;
+            if (magnitude > max_magnitude) max_magnitude=magnitude;
+        }
+    }
+    double traced_time=getElapsedTime(start_time) / num_replays;
+
+    if (trace->emulated) {
+        printf("Emulated trace of size %d: %d replays, %.6f sec per replay\n", domain_size, num_replays, traced_time);
+    } else {
+        printf("Trace of size %d: %d replays, %.6f sec per transform traced, %.6f sec untraced\n", domain_size, num_replays, traced_time, untraced_time);
+    }
+    printf("Checked %d elements against reference FFT: maximum error %e, relative to largest magnitude %e\n",
+            domain_size, max_error, max_magnitude > 0.0f ? max_error / max_magnitude : max_error);
+
+    destroyFFTTrace(trace);
+    releaseHostBuffer(signal_r);
+    releaseHostBuffer(signal_i);
+    releaseHostBuffer(result_r);
+    releaseHostBuffer(result_i);
+    free(reference_r);
+    free(reference_i);
+}
+
+// Uploads the input that the traced program reads, without waiting
+static void traceInputs(CommandQueue& cq, FFTTrace * trace, float * input_r, float * input_i) {
+    EnqueueWriteBuffer(cq, trace->device_descriptor->in_data_r_dram_buffer, input_r, false);
+    EnqueueWriteBuffer(cq, trace->device_descriptor->in_data_i_dram_buffer, input_i, false);
+}
@@ -0,0 +1,178 @@
+#include "fft.h"
+#include "ttfft.h"
+#include <exception>
+#include <string>
+
+using namespace tt;
+using namespace tt::tt_metal;
+
+// The data is held in device tensors sized for the last batch transformed, and re-created when this changes
+struct ttfft_plan {
+    uint32_t domain_size, num_frames;
+    // The execution's L1 buffers, which stay allocated on the shared core for the life of the plan
+    uint64_t l1_buffer_bytes;
+    TTExecution * device_descriptor;
+    DeviceTensor *input, *result;
+};
+
+// Shared by all plans, opened by the first plan created and closed with the last one destroyed
+static IDevice* library_device=NULL;
+static uint32_t num_library_plans=0;
+static uint64_t library_l1_buffer_bytes=0;
+static std::string last_error;
+
+static int failWith(int, const char*);
+static void releaseLibraryDevice();
+
+uint32_t ttfft_abi_version(void) {
+    return TTFFT_ABI_VERSION;
+}
+
+/*
+ * Twiddles are uploaded here once, as nothing else writes the execution's twiddle buffer. Exceptions from the
+ * runtime are caught at this boundary and turned into error codes, as they can not be thrown across the C ABI
+ */
+ttfft_plan* ttfft_plan_create(uint32_t domain_size, uint32_t flags) {
+    bool compact_twiddles=(flags & TTFFT_COMPACT_TWIDDLES) != 0;
+    bool generate_twiddles=(flags & TTFFT_GENERATE_TWIDDLES) != 0;
+    if (domain_size < 2 || !checkIfPowerOfTwo(domain_size) || ((compact_twiddles || generate_twiddles) && domain_size < 8) ||
+            (compact_twiddles && generate_twiddles)) {
+        failWith(TTFFT_ERROR_INVALID_ARGUMENT, "The domain size must be a power of two, of at least eight with compact or generated twiddles, "
+                                                "and these can not be combined");
+        return NULL;
+    }
+
+    if ((flags & TTFFT_SFPU_BACKEND) != 0 && (flags & TTFFT_HYBRID_BACKEND) != 0) {
+        failWith(TTFFT_ERROR_INVALID_ARGUMENT, "Only one compute backend can be selected");
+        return NULL;
+    }
+    enum FFTComputeBackend compute_backend=FPU_BACKEND;
+    if ((flags & TTFFT_SFPU_BACKEND) != 0) compute_backend=SFPU_BACKEND;
+    if ((flags & TTFFT_HYBRID_BACKEND) != 0) compute_backend=HYBRID_BACKEND;
+
+    try {
+        if (library_device == NULL) library_device=CreateDevice(0);
+        uint32_t twiddle_seed_stride=generate_twiddles ? getTwiddleSeedStride(domain_size) : 0;
+        // Configurations that would over-allocate L1 are switched to compact twiddles, or rejected if that is not enough. Every
+        // plan's execution is on the same core, so the L1 buffers of the existing plans are not available to this one
+        FFTFootprint footprint;
+        if (!planFFTFootprint(&footprint, library_device, domain_size, &compact_twiddles, generate_twiddles, false, 0, library_l1_buffer_bytes)) {
+            if (num_library_plans == 0) {
+                CloseDevice(library_device);
+                library_device=NULL;
+            }
+            failWith(TTFFT_ERROR_INVALID_ARGUMENT, "The domain size does not fit in the L1 of a core, alongside the existing plans");
+            return NULL;
+        }
+        TTExecution * device_descriptor=createTTExecution(library_device, domain_size, twiddle_seed_stride, compact_twiddles, false,
+                                                            (flags & TTFFT_PIPELINE_STAGES) != 0, (flags & TTFFT_SPECIALISE_KERNELS) != 0,
+                                                            (flags & TTFFT_LOCAL_SUBSTAGES) != 0, compute_backend);
+        if ((flags & TTFFT_AUTO_STRATEGY) != 0) device_descriptor->strategy=AUTO_STRATEGY;
+        ttfft_plan * plan=new ttfft_plan();
+        plan->domain_size=domain_size;
+        plan->num_frames=0;
+        plan->input=plan->result=NULL;
+        plan->device_descriptor=device_descriptor;
+        plan->l1_buffer_bytes=footprint.l1_buffer_bytes;
+        library_l1_buffer_bytes+=plan->l1_buffer_bytes;
+        num_library_plans++;
+
+        if (twiddle_seed_stride == 0) {
+            float * twiddle_factors=compact_twiddles ? computeCompactTwiddleFactors(domain_size) : computeTwiddleFactors(domain_size);
+            CommandQueue& cq=library_device->command_queue();
+            uploadTwiddleFactors(cq, plan->device_descriptor, twiddle_factors);
+            Finish(cq);
+            free(twiddle_factors);
+        }
+        return plan;
+    } catch (const std::exception& e) {
+        if (num_library_plans == 0 && library_device != NULL) {
+            CloseDevice(library_device);
+            library_device=NULL;
+        }
+        failWith(TTFFT_ERROR_DEVICE, e.what());
+        return NULL;
+    }
+}
+
+int ttfft_execute(ttfft_plan* plan, int direction, const float* in_r, const float* in_i, float* out_r, float* out_i) {
+    return ttfft_execute_batch(plan, direction, in_r, in_i, out_r, out_i, 1);
+}
+
+/*
+ * The caller's arrays are transferred from and to directly, without being staged in further host copies. The
+ * whole buffer is transferred, so the tensors must match the batch exactly rather than just be large enough
+ */
+int ttfft_execute_batch(ttfft_plan* plan, int direction, const float* in_r, const float* in_i, float* out_r, float* out_i,
+                        uint32_t num_frames) {
+    if (plan == NULL || in_r == NULL || in_i == NULL || out_r == NULL || out_i == NULL || num_frames == 0 ||
+            (direction != TTFFT_FORWARD && direction != TTFFT_BACKWARD)) {
+        return failWith(TTFFT_ERROR_INVALID_ARGUMENT, "A plan, the data arrays, a direction and at least one frame are required");
+    }
+    if (num_frames > 1 && plan->domain_size < 16) {
+        return failWith(TTFFT_ERROR_INVALID_ARGUMENT, "Batches require a domain size of at least 16 points");
+    }
+
+    try {
+        CommandQueue& cq=library_device->command_queue();
+        if (plan->num_frames != num_frames) {
+            if (plan->input != NULL) destroyDeviceTensor(plan->input);
+            if (plan->result != NULL) destroyDeviceTensor(plan->result);
+            plan->input=createDeviceTensor(library_device, plan->domain_size * num_frames);
+            plan->result=createDeviceTensor(library_device, plan->domain_size * num_frames);
+            plan->num_frames=num_frames;
+        }
+
+        FFTBatch batch={num_frames, plan->domain_size, nullptr, nullptr};
+        uploadDeviceTensor(cq, plan->input, (float*) in_r, (float*) in_i);
+        enqueueFFT(cq, plan->device_descriptor, plan->input->r_dram_buffer, plan->input->i_dram_buffer, plan->result->r_dram_buffer,
+                    plan->result->i_dram_buffer, plan->domain_size, direction == TTFFT_BACKWARD ? FFT_BACKWARD : FFT_FORWARD, false,
+                    num_frames > 1 ? &batch : NULL);
+        downloadDeviceTensor(cq, plan->result, out_r, out_i);
+    } catch (const std::exception& e) {
+        return failWith(TTFFT_ERROR_DEVICE, e.what());
+    }
+
+    // The device gives the forward transform of the conjugated input, which descaling turns into the inverse
+    if (direction == TTFFT_BACKWARD) {
+        for (uint32_t frame=0;frame<num_frames;frame++) {
+            descale(&out_r[frame*plan->domain_size], &out_i[frame*plan->domain_size], plan->domain_size);
+        }
+    }
+    return TTFFT_SUCCESS;
+}
+
+void ttfft_plan_destroy(ttfft_plan* plan) {
+    if (plan == NULL) return;
+    if (plan->input != NULL) destroyDeviceTensor(plan->input);
+    if (plan->result != NULL) destroyDeviceTensor(plan->result);
+    destroyTTExecution(plan->device_descriptor);
+    library_l1_buffer_bytes-=plan->l1_buffer_bytes;
+    delete plan;
+    releaseLibraryDevice();
+}
+
+float* ttfft_alloc_buffer(size_t num_points) {
+    return allocateHostBuffer(num_points);
+}
+
+void ttfft_free_buffer(float* buffer) {
+    releaseHostBuffer(buffer);
+}
+
+const char* ttfft_last_error(void) {
+    return last_error.c_str();
+}
+
+static int failWith(int error_code, const char * message) {
+    last_error=message;
+    return error_code;
+}
+
+static void releaseLibraryDevice() {
+    num_library_plans--;
+    if (num_library_plans == 0) {
+        CloseDevice(library_device);
+        library_device=NULL;
+    }
+}
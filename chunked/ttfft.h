@@ -0,0 +1,87 @@
+#ifndef TTFFT_H
+#define TTFFT_H
+
+/*
+ * C ABI of libttfft.so, for use from C or through ctypes. The device is opened when the first plan is created
+ * and closed when the last is destroyed, so the setup cost is paid once per process rather than per transform.
+ * Complex data is held as separate real and imaginary arrays of contiguous float32, which NumPy arrays are
+ * used as directly without being copied, for instance from Python
+ *
+ *   lib=ctypes.CDLL("libttfft.so")
+ *   lib.ttfft_plan_create.restype=ctypes.c_void_p
+ *   plan=lib.ttfft_plan_create(1024, 0)
+ *   x_r=np.ascontiguousarray(x.real, dtype=np.float32)
+ *   lib.ttfft_execute(ctypes.c_void_p(plan), 0, x_r.ctypes.data, x_i.ctypes.data, y_r.ctypes.data, y_i.ctypes.data)
+ *
+ * The functions are not thread safe, plans on the one device must be used from one thread at a time
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Incremented whenever a function signature or the meaning of an argument changes
+#define TTFFT_ABI_VERSION 1
+
+#define TTFFT_FORWARD 0
+#define TTFFT_BACKWARD 1
+
+// Flags for ttfft_plan_create, which match the options of the fft executable
+#define TTFFT_COMPACT_TWIDDLES 0x1
+#define TTFFT_GENERATE_TWIDDLES 0x2
+#define TTFFT_PIPELINE_STAGES 0x4
+#define TTFFT_SPECIALISE_KERNELS 0x8
+// The reader's core emulates float in software, so check the local row of fft's --benchmark-backends before setting this
+#define TTFFT_LOCAL_SUBSTAGES 0x10
+// Single frames of up to 1024 points may run the whole domain pipeline, if it is timed as faster on first use
+#define TTFFT_AUTO_STRATEGY 0x20
+// The compute kernel's element-wise ops run on the FPU unless one of these is set
+#define TTFFT_SFPU_BACKEND 0x40
+#define TTFFT_HYBRID_BACKEND 0x80
+
+#define TTFFT_SUCCESS 0
+#define TTFFT_ERROR_INVALID_ARGUMENT -1
+#define TTFFT_ERROR_DEVICE -2
+
+typedef struct ttfft_plan ttfft_plan;
+
+uint32_t ttfft_abi_version(void);
+
+// Plan for transforms of domain_size points, which must be a power of two. Returns NULL on failure, including when the
+// plan would not fit in the L1 of the core alongside the plans that already exist, as every plan shares one core
+ttfft_plan* ttfft_plan_create(uint32_t domain_size, uint32_t flags);
+
+/*
+ * Transforms one domain of points. The backward transform is the inverse, so is scaled by 1/domain_size.
+ * The input and output may be the same arrays
+ */
+int ttfft_execute(ttfft_plan* plan, int direction, const float* in_r, const float* in_i, float* out_r, float* out_i);
+
+/*
+ * Transforms num_frames domains held one after another in the arrays, in one launch on the device. The
+ * domain size must be at least 16 points when batching, so that each frame starts DRAM read aligned
+ */
+int ttfft_execute_batch(ttfft_plan* plan, int direction, const float* in_r, const float* in_i, float* out_r, float* out_i,
+                        uint32_t num_frames);
+
+void ttfft_plan_destroy(ttfft_plan* plan);
+
+/*
+ * Page aligned host buffers of num_points float32 that are locked in memory, so the transfers to and from
+ * the device never fault on them. NumPy can wrap these with np.ctypeslib.as_array to fill and read in place.
+ * Freed buffers are kept for reuse by later allocations rather than returned to the system
+ */
+float* ttfft_alloc_buffer(size_t num_points);
+void ttfft_free_buffer(float* buffer);
+
+// Description of the last error, which stays valid until the next call
+const char* ttfft_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,28 +5,60 @@
 #include <math.h>
 
 #define PI 3.14159265358979323846264338327950288
+// Non power of two sizes are not exact after a round trip, so allow for rounding
+#define COMPARE_TOLERANCE 1e-3f
+
+// As FFTReduction of the device code, top-K keeps the largest powers and threshold the lowest bins at or over a power
+#define NO_REDUCTION 0
+#define TOP_K_REDUCTION 1
+#define THRESHOLD_REDUCTION 2
 
 void calc(float*, int);
 void fft(float*, float*, int);
+void fft_any(float*, int);
+void mixed_radix(float*, int, float*, int);
+void bluestein(float*, int, float*, int);
 void bitreverse(float*, int);
 float* computeTwiddleFactors(int);
 void fillData(float*, int);
-void moveorigin(float*, int);
 void descale(float*, int);
 void invert(float*, int);
 void compare(float*, float*, int);
 int checkIfPowerOfTwo(int);
+int getSmallestRadix(int);
 int getLog(int);
+int reduce(float*, int, int, float, int, int*, float*);
+void printPeaks(float*, int, int, float, int);
 
 int main(int argc, char * argv[]) {
-  if (argc != 2) {
+  if (argc < 2) {
     fprintf(stderr, "You must provide the size of the domain as an argument\n");
     return -1;
   }
 
+  int reduction=NO_REDUCTION, capacity=0;
+  float threshold=0.0f;
+  for (int i=2;i<argc;i++) {
+    if (strcmp(argv[i], "--top-k") == 0 && i+1 < argc) {
+      reduction=TOP_K_REDUCTION;
+      capacity=atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--threshold") == 0 && i+2 < argc) {
+      reduction=THRESHOLD_REDUCTION;
+      threshold=(float) atof(argv[++i]);
+      capacity=atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown option '%s'\n", argv[i]);
+      return -1;
+    }
+  }
+  if (reduction != NO_REDUCTION && capacity < 1) {
+    fprintf(stderr, "A reduction requires a capacity of at least one\n");
+    return -1;
+  }
+
   int domain_size=atoi(argv[1]);
-  if (!checkIfPowerOfTwo(domain_size)) {
-    fprintf(stderr, "%d provided as domain size, but this must be a power of two\n", domain_size);
+  if (domain_size <= 0) {
+    fprintf(stderr, "%d provided as domain size, but this must be a positive integer\n", domain_size);
     return -1;
   }
 
@@ -38,9 +70,9 @@ int main(int argc, char * argv[]) {
   memcpy(data, orig_data, sizeof(float) * domain_size * 2);
 
   calc(data, domain_size);
+  if (reduction != NO_REDUCTION) printPeaks(data, domain_size, reduction, threshold, capacity);
   invert(data, domain_size);
   calc(data, domain_size);
-  moveorigin(data, domain_size);
   descale(data, domain_size);
   compare(data, orig_data, domain_size);
   free(data);
@@ -48,6 +80,10 @@ int main(int argc, char * argv[]) {
 }
 
 void calc(float * data, int domain_size) {
+  if (!checkIfPowerOfTwo(domain_size) || domain_size < 2) {
+    fft_any(data, domain_size);
+    return;
+  }
   float * twiddle_factors=computeTwiddleFactors(domain_size);
   bitreverse(data, domain_size);
   fft(data, twiddle_factors, domain_size);
@@ -74,7 +110,7 @@ void fft(float * data, float * twiddle_factors, int domain_size) {
         float f0=(data[d1_data_index] * twiddle_factors[twiddle_index*2]) - (data[d1_data_index+1] * twiddle_factors[(twiddle_index*2)+1]);
         float f1=(data[d1_data_index] * twiddle_factors[(twiddle_index*2)+1]) + (data[d1_data_index+1] * twiddle_factors[(twiddle_index*2)]);
         
-        printf("[step %d, spectra %d, point %d] Twiddle index %d, D0 index %d, D1 index %d\n", step, spectra, point, twiddle_index, d0_data_index/2, d1_data_index/2);
+        //printf("[step %d, spectra %d, point %d] Twiddle index %d, D0 index %d, D1 index %d\n", step, spectra, point, twiddle_index, d0_data_index/2, d1_data_index/2);
 
         data[d1_data_index]=data[d0_data_index] - f0;
         data[d1_data_index+1]=data[d0_data_index+1] - f1;
@@ -85,6 +121,102 @@ void fft(float * data, float * twiddle_factors, int domain_size) {
   }
 }
 
+// Forward FFT of any size, in place. The domain is split by radix 2, 3, 5 and 7 (mixed radix,
+// decimation in time) and any remaining prime factor is handled by Bluestein's algorithm
+void fft_any(float * data, int domain_size) {
+  float * result=(float*) malloc(sizeof(float) * domain_size * 2);
+  mixed_radix(data, 1, result, domain_size);
+  memcpy(data, result, sizeof(float) * domain_size * 2);
+  free(result);
+}
+
+void mixed_radix(float * in_data, int stride, float * out_data, int n) {
+  if (n == 1) {
+    out_data[0]=in_data[0];
+    out_data[1]=in_data[1];
+    return;
+  }
+  int radix=getSmallestRadix(n);
+  if (radix == 0) {
+    bluestein(in_data, stride, out_data, n);
+    return;
+  }
+  int sub_size=n/radix;
+  // Transform each of the decimated sub sequences, sub sequence r is stored at out_data[r*sub_size]
+  for (int r=0;r<radix;r++) {
+    mixed_radix(&in_data[r*stride*2], stride*radix, &out_data[r*sub_size*2], sub_size);
+  }
+  // Combine the sub sequences with a radix point DFT, applying the twiddle factor for each
+  float * sub_results=(float*) malloc(sizeof(float) * n * 2);
+  memcpy(sub_results, out_data, sizeof(float) * n * 2);
+  for (int k1=0;k1<sub_size;k1++) {
+    for (int k2=0;k2<radix;k2++) {
+      int k=k1 + (sub_size*k2);
+      double sum_r=0.0, sum_i=0.0;
+      for (int r=0;r<radix;r++) {
+        // Keep the exponent modulo n so the angle is exact for large domains
+        double base_factor=(2.0 * PI * (double) (((long) r * k) % n))/(double) n;
+        double w_r=cos(base_factor), w_i=-sin(base_factor);
+        double d_r=sub_results[(r*sub_size + k1)*2], d_i=sub_results[((r*sub_size + k1)*2)+1];
+        sum_r+=(d_r * w_r) - (d_i * w_i);
+        sum_i+=(d_r * w_i) + (d_i * w_r);
+      }
+      out_data[k*2]=(float) sum_r;
+      out_data[(k*2)+1]=(float) sum_i;
+    }
+  }
+  free(sub_results);
+}
+
+// Bluestein (chirp-z) FFT for sizes with no small radix, built on the power of two FFT
+// with a domain of at least 2n-1 so the circular convolution does not wrap
+void bluestein(float * in_data, int stride, float * out_data, int n) {
+  int m=1;
+  while (m < (2*n)-1) m <<= 1;
+
+  float * chirp=(float*) malloc(sizeof(float) * n * 2);
+  float * a_data=(float*) calloc(m * 2, sizeof(float));
+  float * b_data=(float*) calloc(m * 2, sizeof(float));
+  for (int k=0;k<n;k++) {
+    // The chirp is exp(-j*pi*k^2/n), reduce k^2 modulo 2n before converting to an angle
+    double base_factor=(PI * (double) (((long) k * k) % (2 * (long) n)))/(double) n;
+    chirp[k*2]=(float) cos(base_factor);
+    chirp[(k*2)+1]=(float) -sin(base_factor);
+
+    float x_r=in_data[k*stride*2], x_i=in_data[(k*stride*2)+1];
+    a_data[k*2]=(x_r * chirp[k*2]) - (x_i * chirp[(k*2)+1]);
+    a_data[(k*2)+1]=(x_r * chirp[(k*2)+1]) + (x_i * chirp[k*2]);
+
+    // Filter is the conjugate chirp, mirrored so that negative indices wrap around
+    b_data[k*2]=chirp[k*2];
+    b_data[(k*2)+1]=-chirp[(k*2)+1];
+    if (k > 0) {
+      b_data[(m-k)*2]=b_data[k*2];
+      b_data[((m-k)*2)+1]=b_data[(k*2)+1];
+    }
+  }
+
+  calc(a_data, m);
+  calc(b_data, m);
+  for (int i=0;i<m;i++) {
+    float a_r=a_data[i*2], a_i=a_data[(i*2)+1];
+    float b_r=b_data[i*2], b_i=b_data[(i*2)+1];
+    // Multiply and conjugate, so the forward FFT below acts as the inverse
+    a_data[i*2]=(a_r * b_r) - (a_i * b_i);
+    a_data[(i*2)+1]=-((a_r * b_i) + (a_i * b_r));
+  }
+  calc(a_data, m);
+
+  for (int k=0;k<n;k++) {
+    float c_r=a_data[k*2] / m, c_i=-a_data[(k*2)+1] / m;
+    out_data[k*2]=(c_r * chirp[k*2]) - (c_i * chirp[(k*2)+1]);
+    out_data[(k*2)+1]=(c_r * chirp[(k*2)+1]) + (c_i * chirp[k*2]);
+  }
+  free(chirp);
+  free(a_data);
+  free(b_data);
+}
+
 void bitreverse(float * data, int n) {
   int j=0;
   for (int i=0;i<n-1;i++) {
@@ -134,13 +266,6 @@ void invert(float * data, int domain_size) {
   }
 }
 
-void moveorigin(float* data, int domain_size) {
-  for (int i=0;i<domain_size;i++) {
-    data[i*2]=data[i*2] * pow(-1, i);
-    data[(i*2)+1]=data[(i*2)+1] * pow(-1, i);
-  }
-}
-
 void descale(float* data, int domain_size) {
   for (int i=0;i<domain_size;i++) {
     data[i*2]=data[i*2] / domain_size;
@@ -157,7 +282,7 @@ void compare(float * a_data, float * b_data, int domain_size) {
     float b_r=b_data[i*2];
     float b_i=b_data[(i*2)+1];
 
-    if (a_r != b_r || a_i != b_i) {
+    if (fabsf(a_r - b_r) > COMPARE_TOLERANCE || fabsf(a_i - b_i) > COMPARE_TOLERANCE) {
       printf("Miss match index %d: (%.2f, %.2f) vs (%.2f, %.2f)\n", i, a_r, a_i, b_r, b_i);
       missmatching++;
     } else {
@@ -167,10 +292,67 @@ void compare(float * a_data, float * b_data, int domain_size) {
   printf("Checked %d elements: %d match and %d missmatched\n", domain_size, matching, missmatching);
 }
 
+/*
+ * Reduces the spectrum to at most capacity (bin, power) peaks, the CPU equivalent of the device reduction for validating
+ * its records. Top-K holds the largest powers with ties to the lower bin, and threshold the lowest bins whose power is
+ * at least the threshold. Returns the number held for top-K, and the number over the threshold (which may be more than
+ * are held) for threshold
+ */
+int reduce(float * data, int domain_size, int reduction, float threshold, int capacity, int * bins, float * powers) {
+  int count=0;
+  for (int i=0;i<domain_size;i++) {
+    float power=(data[i*2] * data[i*2]) + (data[(i*2)+1] * data[(i*2)+1]);
+    if (reduction == THRESHOLD_REDUCTION) {
+      if (!(power >= threshold)) continue;
+      // Bins arrive in order, so the first capacity over the threshold are the ones held
+      if (count < capacity) {
+        bins[count]=i;
+        powers[count]=power;
+      }
+      count++;
+      continue;
+    }
+    // Insert into the held peaks, which are ordered largest first, dropping the smallest once full
+    int position=count < capacity ? count : capacity;
+    while (position > 0 && power > powers[position-1]) position--;
+    if (position >= capacity) continue;
+    for (int j=(count < capacity ? count : capacity - 1);j>position;j--) {
+      bins[j]=bins[j-1];
+      powers[j]=powers[j-1];
+    }
+    bins[position]=i;
+    powers[position]=power;
+    if (count < capacity) count++;
+  }
+  return count;
+}
+
+void printPeaks(float * data, int domain_size, int reduction, float threshold, int capacity) {
+  int * bins=(int*) malloc(sizeof(int) * capacity);
+  float * powers=(float*) malloc(sizeof(float) * capacity);
+  int count=reduce(data, domain_size, reduction, threshold, capacity, bins, powers);
+  int held=count < capacity ? count : capacity;
+  printf("%d peaks, %d held\n", count, held);
+  for (int i=0;i<held;i++) {
+    printf("Bin %d: power %e\n", bins[i], powers[i]);
+  }
+  free(bins);
+  free(powers);
+}
+
 int checkIfPowerOfTwo(int v) {
   return (v != 0) && ((v & (v - 1)) == 0);
 }
 
+// Returns the smallest of the supported radices (2, 3, 5, 7) that divides n, or zero if there is none
+int getSmallestRadix(int n) {
+  int radices[]={2, 3, 5, 7};
+  for (int i=0;i<4;i++) {
+    if (n % radices[i] == 0) return radices[i];
+  }
+  return 0;
+}
+
 int getLog(int n) {
    int logn=0;
    n >>= 1;
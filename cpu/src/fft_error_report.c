@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define PI 3.14159265358979323846264338327950288L
+// Histogram buckets are decades of relative error from 1e-9 up to 1e-2, with one either side for anything outside
+#define NUM_BUCKETS 9
+#define SMALLEST_BUCKET_EXPONENT -9
+
+/*
+ * Error report for the precision options of the radix 2 FFT, against a long double reference that is run
+ * stage for stage alongside it. The backends all follow the stage structure of fft.c (and the chunked device
+ * kernels), differing in the twiddle table and arithmetic:
+ *   cpu       - the twiddle table and single precision arithmetic of fft.c
+ *   compact   - first octant of twiddles, the rest reconstructed by symmetry
+ *   generated - each twiddle the product of a coarse and a fine seed
+ *   bf16      - twiddles, data and every intermediate rounded to bfloat16
+ */
+enum Backend {
+  CPU_BACKEND = 0,
+  COMPACT_BACKEND = 1,
+  GENERATED_BACKEND = 2,
+  BF16_BACKEND = 3,
+};
+
+static const char * backend_names[]={"cpu", "compact", "generated", "bf16"};
+
+float* computeBackendTwiddles(enum Backend, int);
+void bitreverseFloat(float*, int);
+void bitreverseReference(long double*, int);
+void stageFloat(float*, float*, int, int, int, int);
+void stageReference(long double*, int, int, int);
+void reportStage(float*, long double*, int, int, int*);
+void reportBins(float*, long double*, int, int, double*, double*);
+float roundToBF16(float);
+float ulpOf(float);
+int checkIfPowerOfTwo(int);
+int getLog(int);
+
+int main(int argc, char * argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s domain_size [--backend cpu|compact|generated|bf16] [--budget relative_error] [--bins]\n", argv[0]);
+    return -1;
+  }
+
+  enum Backend backend=CPU_BACKEND;
+  double budget=0.0;
+  int print_bins=0;
+  for (int i=2;i<argc;i++) {
+    if (strcmp(argv[i], "--backend") == 0 && i+1 < argc) {
+      i++;
+      int found=0;
+      for (int b=0;b<4;b++) {
+        if (strcmp(argv[i], backend_names[b]) == 0) {
+          backend=(enum Backend) b;
+          found=1;
+        }
+      }
+      if (!found) {
+        fprintf(stderr, "Unknown backend '%s'\n", argv[i]);
+        return -1;
+      }
+    } else if (strcmp(argv[i], "--budget") == 0 && i+1 < argc) {
+      budget=atof(argv[++i]);
+    } else if (strcmp(argv[i], "--bins") == 0) {
+      print_bins=1;
+    } else {
+      fprintf(stderr, "Unknown option '%s'\n", argv[i]);
+      return -1;
+    }
+  }
+
+  int domain_size=atoi(argv[1]);
+  // The compact and seed tables divide the domain into eighths
+  if (!checkIfPowerOfTwo(domain_size) || domain_size < 8) {
+    fprintf(stderr, "%d provided as domain size, but this must be a power of two of at least eight\n", domain_size);
+    return -1;
+  }
+
+  // Fixed so that reports of different backends are of the same signal
+  srand(1);
+  float * data=(float*) malloc(sizeof(float) * domain_size * 2);
+  long double * reference=(long double*) malloc(sizeof(long double) * domain_size * 2);
+  for (int i=0;i<domain_size*2;i++) {
+    data[i]=(float)rand()/(float)(RAND_MAX);
+    if (backend == BF16_BACKEND) data[i]=roundToBF16(data[i]);
+    reference[i]=data[i];
+  }
+  float * twiddle_factors=computeBackendTwiddles(backend, domain_size);
+
+  printf("Error growth per stage of the %s backend for %d points, as counts of points by relative error\n", backend_names[backend], domain_size);
+  printf("stage   rms rel err  <1e-9");
+  for (int b=1;b<NUM_BUCKETS-1;b++) printf("  <1e%d", SMALLEST_BUCKET_EXPONENT+b);
+  printf(" >=1e-2\n");
+
+  bitreverseFloat(data, domain_size);
+  bitreverseReference(reference, domain_size);
+  int num_steps=getLog(domain_size);
+  for (int step=0; step <= num_steps; step++) {
+    int histogram[NUM_BUCKETS];
+    stageFloat(data, twiddle_factors, domain_size, num_steps, step, backend == BF16_BACKEND);
+    stageReference(reference, domain_size, num_steps, step);
+    reportStage(data, reference, domain_size, step, histogram);
+  }
+
+  double max_ulp, rms_relative;
+  reportBins(data, reference, domain_size, print_bins, &max_ulp, &rms_relative);
+  printf("Result of %d bins: max error %.1f ULP, relative L2 error %.3e\n", domain_size, max_ulp, rms_relative);
+
+  free(data);
+  free(reference);
+  free(twiddle_factors);
+  if (budget > 0.0 && rms_relative > budget) {
+    printf("Relative L2 error of %.3e exceeds the budget of %.3e\n", rms_relative, budget);
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * The n/2 twiddles as the backend would hold them, with real and imaginary interleaved. The compact and
+ * generated tables are expanded here exactly as the device reader expands them
+ */
+float* computeBackendTwiddles(enum Backend backend, int n) {
+  int num_twiddle_factors=n/2;
+  float * twiddle_factors=(float*) malloc(sizeof(float) * num_twiddle_factors * 2);
+
+  if (backend == COMPACT_BACKEND) {
+    int eighth=n/8, quarter=n/4;
+    for (int i=0;i<num_twiddle_factors;i++) {
+      // The octant entry and whether cos and sin are swapped and negated, as get_compact_twiddle
+      int idx=i <= eighth ? i : i <= quarter ? quarter-i : i <= quarter+eighth ? i-quarter : num_twiddle_factors-i;
+      double base_factor=(2.0 * PI * idx)/(double) n;
+      float c=(float) cos(base_factor), s=(float) -sin(base_factor);
+      if (i <= eighth) {
+        twiddle_factors[i*2]=c;
+        twiddle_factors[(i*2)+1]=s;
+      } else if (i <= quarter) {
+        twiddle_factors[i*2]=-s;
+        twiddle_factors[(i*2)+1]=-c;
+      } else if (i <= quarter+eighth) {
+        twiddle_factors[i*2]=s;
+        twiddle_factors[(i*2)+1]=-c;
+      } else {
+        twiddle_factors[i*2]=-c;
+        twiddle_factors[(i*2)+1]=s;
+      }
+    }
+  } else if (backend == GENERATED_BACKEND) {
+    // The stride is the power of two closest to the square root of n/2, as getTwiddleSeedStride
+    int stride=1;
+    while (stride * stride < n/2) stride <<= 1;
+    for (int i=0;i<num_twiddle_factors;i++) {
+      double fine_factor=(2.0 * PI * (i % stride))/(double) n;
+      double coarse_factor=(2.0 * PI * (i - (i % stride)))/(double) n;
+      float fine_r=(float) cos(fine_factor), fine_i=(float) -sin(fine_factor);
+      float coarse_r=(float) cos(coarse_factor), coarse_i=(float) -sin(coarse_factor);
+      twiddle_factors[i*2]=(coarse_r * fine_r) - (coarse_i * fine_i);
+      twiddle_factors[(i*2)+1]=(coarse_r * fine_i) + (coarse_i * fine_r);
+    }
+  } else {
+    for (int i=0;i<num_twiddle_factors;i++) {
+      float base_factor=(2.0 * PI * i)/(float) n;
+      twiddle_factors[i*2]=(float) cos((double) base_factor);
+      twiddle_factors[(i*2)+1]=(float) -sin((double) base_factor);
+      if (backend == BF16_BACKEND) {
+        twiddle_factors[i*2]=roundToBF16(twiddle_factors[i*2]);
+        twiddle_factors[(i*2)+1]=roundToBF16(twiddle_factors[(i*2)+1]);
+      }
+    }
+  }
+  return twiddle_factors;
+}
+
+// One step of the fft in fft.c, if bf16 is set then each intermediate is rounded as the FPU would in bfloat16
+void stageFloat(float * data, float * twiddle_factors, int domain_size, int num_steps, int step, int bf16) {
+  int num_spectra_in_step=step == 0 ? 1 : 2 << (step-1);
+  int increment_next_point_in_step=2 << step;
+  int matching_second_point=increment_next_point_in_step/2;
+  for (int spectra=0; spectra < num_spectra_in_step; spectra++) {
+    int twiddle_index=spectra << (num_steps-step);
+    float w_r=twiddle_factors[twiddle_index*2], w_i=twiddle_factors[(twiddle_index*2)+1];
+    for (int point=0; point < domain_size; point+=increment_next_point_in_step) {
+      int d0_data_index=(spectra + point)*2;
+      int d1_data_index=(spectra + point + matching_second_point)*2;
+      float f0, f1;
+      if (bf16) {
+        f0=roundToBF16(roundToBF16(data[d1_data_index] * w_r) - roundToBF16(data[d1_data_index+1] * w_i));
+        f1=roundToBF16(roundToBF16(data[d1_data_index] * w_i) + roundToBF16(data[d1_data_index+1] * w_r));
+      } else {
+        f0=(data[d1_data_index] * w_r) - (data[d1_data_index+1] * w_i);
+        f1=(data[d1_data_index] * w_i) + (data[d1_data_index+1] * w_r);
+      }
+      data[d1_data_index]=data[d0_data_index] - f0;
+      data[d1_data_index+1]=data[d0_data_index+1] - f1;
+      data[d0_data_index]=data[d0_data_index] + f0;
+      data[d0_data_index+1]=data[d0_data_index+1] + f1;
+      if (bf16) {
+        for (int j=0;j<2;j++) {
+          data[d0_data_index+j]=roundToBF16(data[d0_data_index+j]);
+          data[d1_data_index+j]=roundToBF16(data[d1_data_index+j]);
+        }
+      }
+    }
+  }
+}
+
+// The same step in long double with exactly rounded twiddles
+void stageReference(long double * data, int domain_size, int num_steps, int step) {
+  int num_spectra_in_step=step == 0 ? 1 : 2 << (step-1);
+  int increment_next_point_in_step=2 << step;
+  int matching_second_point=increment_next_point_in_step/2;
+  for (int spectra=0; spectra < num_spectra_in_step; spectra++) {
+    int twiddle_index=spectra << (num_steps-step);
+    long double base_factor=(2.0L * PI * twiddle_index)/(long double) domain_size;
+    long double w_r=cosl(base_factor), w_i=-sinl(base_factor);
+    for (int point=0; point < domain_size; point+=increment_next_point_in_step) {
+      int d0_data_index=(spectra + point)*2;
+      int d1_data_index=(spectra + point + matching_second_point)*2;
+      long double f0=(data[d1_data_index] * w_r) - (data[d1_data_index+1] * w_i);
+      long double f1=(data[d1_data_index] * w_i) + (data[d1_data_index+1] * w_r);
+      data[d1_data_index]=data[d0_data_index] - f0;
+      data[d1_data_index+1]=data[d0_data_index+1] - f1;
+      data[d0_data_index]=data[d0_data_index] + f0;
+      data[d0_data_index+1]=data[d0_data_index+1] + f1;
+    }
+  }
+}
+
+// Prints the relative L2 error of the stage and the histogram of each point's error relative to the RMS of the stage
+void reportStage(float * data, long double * reference, int domain_size, int step, int * histogram) {
+  long double error_energy=0.0L, reference_energy=0.0L;
+  for (int i=0;i<domain_size*2;i++) {
+    long double error=(long double) data[i] - reference[i];
+    error_energy+=error * error;
+    reference_energy+=reference[i] * reference[i];
+  }
+  long double rms=sqrtl(reference_energy / domain_size);
+
+  for (int b=0;b<NUM_BUCKETS;b++) histogram[b]=0;
+  for (int i=0;i<domain_size;i++) {
+    long double error_r=(long double) data[i*2] - reference[i*2], error_i=(long double) data[(i*2)+1] - reference[(i*2)+1];
+    double relative=(double) (sqrtl((error_r * error_r) + (error_i * error_i)) / rms);
+    int bucket=relative <= 0.0 ? 0 : (int) floor(log10(relative)) - SMALLEST_BUCKET_EXPONENT + 1;
+    if (bucket < 0) bucket=0;
+    if (bucket >= NUM_BUCKETS) bucket=NUM_BUCKETS-1;
+    histogram[bucket]++;
+  }
+
+  printf("%5d   %.3e  ", step, (double) sqrtl(error_energy / reference_energy));
+  for (int b=0;b<NUM_BUCKETS;b++) printf(" %6d", histogram[b]);
+  printf("\n");
+}
+
+/*
+ * The error of each result bin in ULP of the exactly rounded result, the largest of the real and imaginary
+ * parts, and relative to the magnitude of the bin. Printed per bin if print_bins is set
+ */
+void reportBins(float * data, long double * reference, int domain_size, int print_bins, double * max_ulp, double * rms_relative) {
+  long double error_energy=0.0L, reference_energy=0.0L;
+  *max_ulp=0.0;
+  for (int i=0;i<domain_size;i++) {
+    double bin_ulp=0.0;
+    long double error_energy_bin=0.0L, magnitude=0.0L;
+    for (int j=0;j<2;j++) {
+      long double error=(long double) data[(i*2)+j] - reference[(i*2)+j];
+      double ulp=(double) (fabsl(error) / ulpOf((float) reference[(i*2)+j]));
+      if (ulp > bin_ulp) bin_ulp=ulp;
+      error_energy_bin+=error * error;
+      magnitude+=reference[(i*2)+j] * reference[(i*2)+j];
+    }
+    if (bin_ulp > *max_ulp) *max_ulp=bin_ulp;
+    error_energy+=error_energy_bin;
+    reference_energy+=magnitude;
+    if (print_bins) {
+      printf("Bin %d: (%.6e, %.6e) error %.1f ULP, relative %.3e\n", i, data[i*2], data[(i*2)+1], bin_ulp,
+              magnitude > 0.0L ? (double) sqrtl(error_energy_bin / magnitude) : 0.0);
+    }
+  }
+  *rms_relative=(double) sqrtl(error_energy / reference_energy);
+}
+
+// Round to nearest even on the upper 16 bits, which are the bfloat16 value
+float roundToBF16(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  bits+=0x7FFF + ((bits >> 16) & 1);
+  bits&=0xFFFF0000;
+  memcpy(&value, &bits, sizeof(bits));
+  return value;
+}
+
+// Spacing of single precision values at this magnitude, the smallest subnormal for zero
+float ulpOf(float value) {
+  float magnitude=fabsf(value);
+  return nextafterf(magnitude, INFINITY) - magnitude;
+}
+
+void bitreverseFloat(float * data, int n) {
+  int j=0;
+  for (int i=0;i<n-1;i++) {
+    if (i < j) {
+      for (int k=0;k<2;k++) {
+        float temp=data[(i*2)+k];
+        data[(i*2)+k]=data[(j*2)+k];
+        data[(j*2)+k]=temp;
+      }
+    }
+    int k=n >> 1;
+    while (k <= j) {
+      j -= k;
+      k >>= 1;
+    }
+    j+=k;
+  }
+}
+
+void bitreverseReference(long double * data, int n) {
+  int j=0;
+  for (int i=0;i<n-1;i++) {
+    if (i < j) {
+      for (int k=0;k<2;k++) {
+        long double temp=data[(i*2)+k];
+        data[(i*2)+k]=data[(j*2)+k];
+        data[(j*2)+k]=temp;
+      }
+    }
+    int k=n >> 1;
+    while (k <= j) {
+      j -= k;
+      k >>= 1;
+    }
+    j+=k;
+  }
+}
+
+int checkIfPowerOfTwo(int v) {
+  return (v != 0) && ((v & (v - 1)) == 0);
+}
+
+int getLog(int n) {
+   int logn=0;
+   n >>= 1;
+   while ((n >>=1) > 0) {
+      logn++;
+   }
+   return logn;
+}